@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Build time capacity of the converter states. The defaults hold the largest
+ * epoch SBP can carry; lower values shrink every state and stack buffer sized
+ * from them. They are set with the CMake options of the same name, code using
+ * the library must be built with the same values as the structs change size.
+ * gnssc_sizes prints the resulting state sizes. */
+
+#ifndef GNSS_CONVERTERS_CAPACITY_H
+#define GNSS_CONVERTERS_CAPACITY_H
+
+/* Observations per epoch, at most 15 SBP messages of 14 observations */
+#ifndef GNSSC_MAX_OBS_PER_EPOCH
+#define GNSSC_MAX_OBS_PER_EPOCH 210
+#endif
+
+/* Satellites used in the navigation solution tracked by sbp2nmea, between 2
+ * and 256 */
+#ifndef GNSSC_MAX_SATS
+#define GNSSC_MAX_SATS 256
+#endif
+
+/* Reference stations whose epochs rtcm2sbp assembles in parallel, the least
+ * recently used station gives up its buffer to a new one. Between 1 and 255,
+ * each takes a full observation buffer. */
+#ifndef RTCM3_MAX_STATIONS
+#define RTCM3_MAX_STATIONS 4
+#endif
+
+/* Epoch slots of the rtcm2sbp reorder window, shared by all stations, see
+ * rtcm2sbp_set_reorder_window(). At most 255, each takes a full observation
+ * buffer; 0 leaves the reorder window out of rtcm3_sbp_state. */
+#ifndef RTCM3_REORDER_MAX_EPOCHS
+#define RTCM3_REORDER_MAX_EPOCHS 8
+#endif
+
+#endif /* GNSS_CONVERTERS_CAPACITY_H */
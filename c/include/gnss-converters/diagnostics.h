@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef GNSS_CONVERTERS_DIAGNOSTICS_H
+#define GNSS_CONVERTERS_DIAGNOSTICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <swiftnav/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GNSSC_DIAG_MAX_ARGS 4
+
+/* By default each event type is delivered to the sink at most once per
+ * second, the occurrences in between are only counted. The limits only apply
+ * once the embedder has given a time with gnssc_diag_set_time(). */
+#define GNSSC_DIAG_DEFAULT_INTERVAL_MS 1000
+#define GNSSC_DIAG_DEFAULT_BURST 1
+
+/* Diagnostic events raised by the converters. The comment lists the meaning
+ * of the numeric arguments in gnssc_diag_t.args */
+typedef enum gnssc_diag_event_e {
+  /* message type */
+  GNSSC_DIAG_RTCM_ENCODE_FAILED = 0,
+  /* SBP FCN */
+  GNSSC_DIAG_INVALID_GLO_FCN,
+  /* PRN */
+  GNSSC_DIAG_INVALID_GLO_PRN,
+  /* original length, truncated length */
+  GNSSC_DIAG_LOG_TRUNCATED,
+  /* satellite index, signal index */
+  GNSSC_DIAG_MSM_CELL_NOT_SET,
+  /* code, RTCM constellation */
+  GNSSC_DIAG_MSM_UNSUPPORTED_CODE,
+  /* code, PRN */
+  GNSSC_DIAG_MSM_INVALID_CODE,
+  /* code, PRN */
+  GNSSC_DIAG_MSM_INVALID_PRN,
+  /* code, PRN */
+  GNSSC_DIAG_MSM_SAT_LIMIT,
+  /* code, PRN */
+  GNSSC_DIAG_MSM_SIGNAL_LIMIT,
+  /* code, PRN */
+  GNSSC_DIAG_MSM_NOT_IN_SAT_MASK,
+  /* code, PRN */
+  GNSSC_DIAG_MSM_NOT_IN_SIGNAL_MASK,
+  /* time difference in ms */
+  GNSSC_DIAG_OBS_IN_PAST,
+  /* time difference in ms */
+  GNSSC_DIAG_OBS_SEQ_ENDED,
+  /* expected counter, expected size, received counter, received size */
+  GNSSC_DIAG_OBS_SEQ_INVALID,
+  /* expected counter, expected size, received counter, received size */
+  GNSSC_DIAG_OBS_SEQ_MISSED,
+  /* max observations per epoch, number of dropped observations */
+  GNSSC_DIAG_OBS_BUFFER_FULL,
+  GNSSC_DIAG_COUNT
+} gnssc_diag_event_t;
+
+/* A single diagnostic as delivered to the sink. Formatting into text is left
+ * to the sink, see gnssc_diag_to_str() */
+typedef struct {
+  gnssc_diag_event_t event;
+  /* RTCM station id the event relates to, 0 if not known */
+  u16 stn_id;
+  s32 args[GNSSC_DIAG_MAX_ARGS];
+  /* number of events of this type dropped by the rate limit since the
+   * previous delivery */
+  u32 suppressed;
+} gnssc_diag_t;
+
+typedef void (*gnssc_diag_cb_t)(const gnssc_diag_t *diag, void *context);
+
+typedef struct {
+  /* total number of occurrences */
+  u32 count;
+  /* occurrences not delivered since the last delivery */
+  u32 suppressed;
+  u32 interval_ms;
+  u16 burst;
+  u16 window_count;
+  u64 window_start_ms;
+} gnssc_diag_counter_t;
+
+struct gnssc_diag {
+  gnssc_diag_cb_t cb;
+  void *context;
+  /* monotonic time used for the rate limiting, pushed by the embedder.
+   * Without one every event is delivered. */
+  u64 now_ms;
+  bool time_set;
+  gnssc_diag_counter_t counters[GNSSC_DIAG_COUNT];
+};
+
+void gnssc_diag_init(struct gnssc_diag *diag);
+
+/* Clear the counters, the rate limit windows and the time, keeping the sink
+ * and limits */
+void gnssc_diag_reset_counters(struct gnssc_diag *diag);
+
+void gnssc_diag_set_sink(struct gnssc_diag *diag,
+                         gnssc_diag_cb_t cb,
+                         void *context);
+
+/* Allow at most burst deliveries of the given event per interval_ms, an
+ * interval of 0 disables rate limiting. Passing GNSSC_DIAG_COUNT as the event
+ * applies the limit to all events. */
+void gnssc_diag_set_rate_limit(struct gnssc_diag *diag,
+                               gnssc_diag_event_t event,
+                               u32 interval_ms,
+                               u16 burst);
+
+/* Set the monotonic time of the rate limits, which are not enforced before
+ * the first call */
+void gnssc_diag_set_time(struct gnssc_diag *diag, u64 now_ms);
+
+u32 gnssc_diag_count(const struct gnssc_diag *diag, gnssc_diag_event_t event);
+
+void gnssc_diag_report(struct gnssc_diag *diag,
+                       gnssc_diag_event_t event,
+                       u16 stn_id,
+                       s32 arg0,
+                       s32 arg1,
+                       s32 arg2,
+                       s32 arg3);
+
+const char *gnssc_diag_event_name(gnssc_diag_event_t event);
+
+/* Format the diagnostic into a human readable string, returns the snprintf
+ * result */
+int gnssc_diag_to_str(const gnssc_diag_t *diag, char *buf, size_t len);
+
+/* Sink printing the diagnostics to stderr, context is unused */
+void gnssc_diag_stderr_sink(const gnssc_diag_t *diag, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_CONVERTERS_DIAGNOSTICS_H */
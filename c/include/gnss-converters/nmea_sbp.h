@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* NMEA to SBP converter for receivers that only speak NMEA. GGA sentences
+ * become MSG_POS_LLH, RMC sentences MSG_UTC_TIME, RMC and VTG MSG_VEL_NED and
+ * GSA MSG_DOPS, at most one of each per epoch. The sentences are framed, split
+ * into fields and checksummed in a single pass over the input, and the
+ * numbers are parsed without strtod(). Nothing is allocated.
+ *
+ * NMEA only carries the UTC time of day, the GPS time of week of the messages
+ * needs the date of an RMC sentence and the leap second. Sentences before the
+ * first RMC are dropped. */
+
+#ifndef GNSS_CONVERTERS_NMEA_SBP_H
+#define GNSS_CONVERTERS_NMEA_SBP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libsbp/navigation.h>
+#include <swiftnav/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest sentence accepted, from the address to the checksum. The standard
+ * allows 79 characters, the rest is room for proprietary extensions. */
+#define NMEA2SBP_MAX_SENTENCE_LEN 128
+/* Fields recorded per sentence, GSA has the most with 19 */
+#define NMEA2SBP_MAX_FIELDS 24
+/* GPS - UTC offset in s until nmea2sbp_set_leap_second() */
+#define NMEA2SBP_DEFAULT_LEAP_SECONDS 18
+
+typedef struct nmea2sbp_state {
+  /* sentence being received without the '$', the checksum and CR LF */
+  char sentence[NMEA2SBP_MAX_SENTENCE_LEN];
+  u8 len;
+  /* offsets of the fields in sentence, the address is field 0 */
+  u8 field[NMEA2SBP_MAX_FIELDS];
+  u8 n_fields;
+  /* XOR of the characters of sentence */
+  u8 checksum;
+  /* the checksum received after the '*' */
+  u8 sentence_checksum;
+  /* position in the framing, see nmea_sbp.c */
+  u8 framing;
+
+  /* date of the last RMC sentence as days since the GPS epoch, negative
+   * until the first one */
+  s32 gps_days;
+  /* UTC time of day in ms of the last sentence with a time, to detect the
+   * date change before the next RMC sentence */
+  u32 last_tod_ms;
+  /* GPS time of week in ms of the current epoch, TOW_INVALID if unknown */
+  u32 tow;
+  s8 leap_seconds;
+
+  /* the position mode of the epoch from GGA, for the DOPS flags */
+  u8 pos_flags;
+  u32 pos_tow;
+  /* epochs of the last MSG_VEL_NED and MSG_DOPS, which several sentences
+   * can produce */
+  u32 vel_tow;
+  u32 dops_tow;
+
+  u16 sender_id;
+  void (*cb_nmea_to_sbp)(u16 msg_id,
+                         u8 length,
+                         u8 *buffer,
+                         u16 sender_id,
+                         void *context);
+  void *context;
+
+  /* sentences dropped for a wrong checksum, for a framing or field error,
+   * and for lack of a date */
+  u32 n_checksum_errors;
+  u32 n_invalid;
+  u32 n_no_date;
+} nmea2sbp_t;
+
+void nmea2sbp_init(nmea2sbp_t *state,
+                   void (*cb_nmea_to_sbp)(u16 msg_id,
+                                          u8 length,
+                                          u8 *buffer,
+                                          u16 sender_id,
+                                          void *context),
+                   void *context);
+
+void nmea2sbp_set_leap_second(nmea2sbp_t *state, s8 leap_seconds);
+
+/* Sender id of the SBP messages, 0 by default */
+void nmea2sbp_set_sender_id(nmea2sbp_t *state, u16 sender_id);
+
+/* Convert len bytes of NMEA. The data can be split anywhere, a sentence is
+ * converted as soon as its checksum is in. Sentences without a time (VTG and
+ * GSA) belong to the epoch of the last sentence with one. */
+void nmea2sbp_decode(nmea2sbp_t *state, const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_CONVERTERS_NMEA_SBP_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* SBP to RTCM front-end serving several RTCM observation formats from one
+ * input stream. The SBP observations are accumulated once, and each output
+ * format is encoded on its first request and cached until the next epoch
+ * completes. */
+
+#ifndef GNSS_CONVERTERS_RTCM3_FANOUT_H
+#define GNSS_CONVERTERS_RTCM3_FANOUT_H
+
+#include <gnss-converters/rtcm3_sbp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* legacy 1004/1012, MSM4 and MSM5 */
+#define RTCM3_FANOUT_PROFILE_COUNT 3
+#define RTCM3_FANOUT_MAX_FRAMES 16
+#define RTCM3_FANOUT_BUFFER_SIZE \
+  (RTCM3_FANOUT_MAX_FRAMES * (RTCM3_MAX_MSG_LEN + RTCM3_MSG_OVERHEAD))
+
+struct rtcm3_fanout_cache {
+  /* epoch counter value the frames were encoded for */
+  u32 epoch;
+  bool valid;
+  u16 length;
+  u8 frames[RTCM3_FANOUT_BUFFER_SIZE];
+};
+
+struct rtcm3_fanout {
+  /* accumulates the incoming SBP messages, use the sbp2rtcm_set_* functions
+   * on this state to configure leap seconds, GLO FCNs and antenna info */
+  struct rtcm3_out_state in;
+  /* copy of the last complete epoch, used for encoding */
+  struct rtcm3_out_state out;
+  /* number of complete epochs received */
+  u32 epoch;
+  /* number of observation encodes done, at most one per profile and epoch */
+  u32 n_encodes;
+  /* number of frames that did not fit in the cache */
+  u32 n_dropped_frames;
+  struct rtcm3_fanout_cache *encoding;
+  struct rtcm3_fanout_cache cache[RTCM3_FANOUT_PROFILE_COUNT];
+  /* receives the station messages (1005, 1006, 1008, 1033, 1230) which are
+   * shared between all profiles */
+  void (*cb_sbp_to_rtcm)(u8 *buffer, u16 length, void *context);
+  void *context;
+};
+
+void rtcm3_fanout_init(struct rtcm3_fanout *fanout,
+                       void (*cb_sbp_to_rtcm)(u8 *buffer,
+                                              u16 length,
+                                              void *context),
+                       void *context);
+
+void rtcm3_fanout_base_pos_ecef_cb(const u16 sender_id,
+                                   const u8 len,
+                                   const u8 msg[],
+                                   struct rtcm3_fanout *fanout);
+
+void rtcm3_fanout_glo_biases_cb(const u16 sender_id,
+                                const u8 len,
+                                const u8 msg[],
+                                struct rtcm3_fanout *fanout);
+
+void rtcm3_fanout_sbp_obs_cb(const u16 sender_id,
+                             const u8 len,
+                             const u8 msg[],
+                             struct rtcm3_fanout *fanout);
+
+/* Number of the last complete epoch, changes when new frames are available */
+u32 rtcm3_fanout_epoch(const struct rtcm3_fanout *fanout);
+
+/* Get the RTCM frames of the last complete epoch. msm_type selects the format
+ * as in sbp2rtcm_set_rtcm_out_mode(): MSM_UNKNOWN gives legacy 1004/1012,
+ * MSM4 and MSM5 give MSM output. The frames are encoded on the first request
+ * of each epoch and stay valid until the next epoch completes.
+ * Returns the total length of the frames, 0 if there is nothing to send or
+ * the format is not supported. */
+u16 rtcm3_fanout_get(struct rtcm3_fanout *fanout,
+                     msm_enum msm_type,
+                     const u8 **frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_CONVERTERS_RTCM3_FANOUT_H */
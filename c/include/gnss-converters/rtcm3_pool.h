@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Pools of converter states for servers with many short lived connections.
+ * The states are supplied by the caller and initialised once by the pool,
+ * handing one out only resets its stream state and copies the configuration
+ * of the pool template into it, see rtcm2sbp_reset() and sbp2rtcm_reset(). */
+
+#ifndef GNSS_CONVERTERS_RTCM3_POOL_H
+#define GNSS_CONVERTERS_RTCM3_POOL_H
+
+#include <gnss-converters/rtcm3_sbp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RTCM3_POOL_MAX_STATES 1024
+
+struct rtcm2sbp_pool {
+  /* configuration of the states handed out, set it up with the rtcm2sbp_set_*
+   * functions after rtcm2sbp_pool_init() */
+  struct rtcm3_sbp_state config;
+  struct rtcm3_sbp_state *states;
+  u16 n_states;
+  /* indices of the free states, used as a stack */
+  u16 n_free;
+  u16 free_list[RTCM3_POOL_MAX_STATES];
+};
+
+struct sbp2rtcm_pool {
+  /* configuration of the states handed out, set it up with the sbp2rtcm_set_*
+   * functions after sbp2rtcm_pool_init() */
+  struct rtcm3_out_state config;
+  struct rtcm3_out_state *states;
+  u16 n_states;
+  /* indices of the free states, used as a stack */
+  u16 n_free;
+  u16 free_list[RTCM3_POOL_MAX_STATES];
+};
+
+/* Initialise the pool and all n_states states. Returns false if n_states is
+ * above RTCM3_POOL_MAX_STATES. */
+bool rtcm2sbp_pool_init(struct rtcm2sbp_pool *pool,
+                        struct rtcm3_sbp_state states[],
+                        u16 n_states,
+                        void (*cb_rtcm_to_sbp)(u16 msg_id,
+                                               u8 length,
+                                               u8 *buffer,
+                                               u16 sender_id,
+                                               void *context),
+                        void (*cb_base_obs_invalid)(double time_diff,
+                                                    void *context));
+
+/* Take a state configured as the pool template, with context passed to its
+ * callbacks and no statistics block or trace ring. Returns NULL if all states
+ * are in use. */
+struct rtcm3_sbp_state *rtcm2sbp_pool_acquire(struct rtcm2sbp_pool *pool,
+                                              void *context);
+
+/* Return a state to the pool, anything it still buffers is dropped */
+void rtcm2sbp_pool_release(struct rtcm2sbp_pool *pool,
+                           struct rtcm3_sbp_state *state);
+
+bool sbp2rtcm_pool_init(struct sbp2rtcm_pool *pool,
+                        struct rtcm3_out_state states[],
+                        u16 n_states,
+                        void (*cb_sbp_to_rtcm)(u8 *buffer,
+                                               u16 length,
+                                               void *context));
+
+struct rtcm3_out_state *sbp2rtcm_pool_acquire(struct sbp2rtcm_pool *pool,
+                                              void *context);
+
+void sbp2rtcm_pool_release(struct sbp2rtcm_pool *pool,
+                           struct rtcm3_out_state *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_CONVERTERS_RTCM3_POOL_H */
@@ -13,6 +13,10 @@
 #ifndef GNSS_CONVERTERS_RTCM3_SBP_INTERFACE_H
 #define GNSS_CONVERTERS_RTCM3_SBP_INTERFACE_H
 
+#include <gnss-converters/capacity.h>
+#include <gnss-converters/diagnostics.h>
+#include <gnss-converters/stats.h>
+#include <gnss-converters/trace.h>
 #include <libsbp/observation.h>
 #include <rtcm3/messages.h>
 #include <swiftnav/gnss_time.h>
@@ -27,6 +31,8 @@ extern "C" {
      sequence count in header.n_obs
    - The number of observations per message comes from the max 255 byte
      message length
+   The buffers hold MAX_OBS_PER_EPOCH observations, which is this maximum
+   unless lowered with GNSSC_MAX_OBS_PER_EPOCH.
 */
 #define SBP_FRAMING_MAX_PAYLOAD_SIZE (255u)
 #define SBP_HDR_SIZE (sizeof(observation_header_t))
@@ -34,7 +40,10 @@ extern "C" {
 #define SBP_MAX_OBS_SEQ (15u)
 #define MAX_OBS_IN_SBP \
   ((SBP_FRAMING_MAX_PAYLOAD_SIZE - SBP_HDR_SIZE) / SBP_OBS_SIZE)
-#define MAX_OBS_PER_EPOCH (SBP_MAX_OBS_SEQ * MAX_OBS_IN_SBP)
+#define MAX_OBS_PER_EPOCH (GNSSC_MAX_OBS_PER_EPOCH)
+/* number of SBP messages of a full epoch */
+#define MAX_OBS_MSGS_PER_EPOCH \
+  ((MAX_OBS_PER_EPOCH + MAX_OBS_IN_SBP - 1) / MAX_OBS_IN_SBP)
 #define OBS_BUFFER_SIZE (SBP_HDR_SIZE + MAX_OBS_PER_EPOCH * SBP_OBS_SIZE)
 
 #define INVALID_TIME 0xFFFF
@@ -47,6 +56,137 @@ extern "C" {
 #define RTCM3_MSG_OVERHEAD 6
 #define RTCM3_MAX_MSG_LEN 0x3FF
 
+/* Flush timeout of incomplete epochs, see rtcm2sbp_tick() and
+ * sbp2rtcm_tick(). The automatic timeout is half the epoch period observed
+ * on the stream, or RTCM3_EPOCH_TIMEOUT_DEFAULT_MS until it is known. */
+#define RTCM3_EPOCH_TIMEOUT_AUTO 0u
+#define RTCM3_EPOCH_TIMEOUT_DEFAULT_MS 500u
+
+/* Epoch timer state of a single observation stream */
+struct rtcm3_epoch_stream {
+  /* monotonic time the pending epoch last received observations */
+  u64 last_input_ms;
+  /* time stamp of the last epoch sent */
+  sbp_gps_time_t last_epoch;
+  bool last_epoch_valid;
+  /* the last epoch was flushed on timeout, so late observations of that
+   * epoch are dropped instead of being sent as a second epoch */
+  bool last_epoch_forced;
+  /* period between the last two epochs sent, 0 if not known */
+  u32 epoch_period_ms;
+};
+
+struct rtcm3_epoch_timer {
+  /* monotonic time of the last tick */
+  u64 now_ms;
+  /* fixed timeout, or RTCM3_EPOCH_TIMEOUT_AUTO */
+  u32 timeout_ms;
+  /* number of epochs flushed on timeout */
+  u32 n_forced_flushes;
+  /* number of messages dropped because their epoch was already flushed */
+  u32 n_late_msgs;
+  /* used by the SBP to RTCM direction, RTCM to SBP keeps one per station */
+  struct rtcm3_epoch_stream stream;
+};
+
+/* Observation epoch being assembled for one reference station */
+struct rtcm3_station_buffer {
+  bool in_use;
+  u16 sender_id;
+  /* value of rtcm3_sbp_state.station_use_count on the last use */
+  u32 last_used;
+  gps_time_t last_gps_time;
+  gps_time_t last_glo_time;
+  struct rtcm3_epoch_stream epoch;
+  u8 obs_buffer[OBS_BUFFER_SIZE];
+};
+
+/* Observation epoch held back by the reorder window */
+struct rtcm3_reorder_slot {
+  bool in_use;
+  u16 sender_id;
+  /* monotonic time the epoch last received observations */
+  u64 last_input_ms;
+  u8 obs_buffer[OBS_BUFFER_SIZE];
+};
+
+/* Output queue of the pull interface, see rtcm2sbp_push(). Each entry is a
+ * message id, sender id and length header followed by the SBP payload, the
+ * queue holds at least two full observation epochs. */
+#define RTCM3_SBP_QUEUE_HDR_SIZE 5
+#define RTCM3_SBP_QUEUE_SIZE   \
+  (2 * MAX_OBS_MSGS_PER_EPOCH * \
+   (RTCM3_SBP_QUEUE_HDR_SIZE + SBP_FRAMING_MAX_PAYLOAD_SIZE))
+
+struct rtcm3_sbp_queue {
+  /* read and write offsets into data, the write offset is below the read
+   * offset after it wrapped to the start */
+  u16 head;
+  u16 tail;
+  /* end of the entries before the write offset wrapped */
+  u16 wrap;
+  u16 count;
+  /* number of messages lost because the queue was full */
+  u32 n_dropped;
+  u8 data[RTCM3_SBP_QUEUE_SIZE];
+};
+
+/* SBP message returned by rtcm2sbp_next(), payload points into the queue */
+struct rtcm2sbp_msg {
+  u16 msg_id;
+  u16 sender_id;
+  u8 length;
+  const u8 *payload;
+};
+
+/* Last raw epoch time to GPS time mapping of one time system, so that the
+ * messages of the other constellations in the same epoch can reuse it */
+struct rtcm3_time_cache {
+  bool valid;
+  /* raw time of week or GLO time of day in ms */
+  u32 raw_ms;
+  /* reference time and leap second the mapping was computed with */
+  gps_time_t ref_time;
+  s8 leap_seconds;
+  gps_time_t obs_time;
+};
+
+/* Station message output intervals, see sbp2rtcm_set_station_msg_interval() */
+#define RTCM3_STN_MSG_INTERVAL_IMMEDIATE 0u
+#define RTCM3_STN_MSG_INTERVAL_OFF UINT32_MAX
+/* largest encoded station message frame, 1033 with full length strings */
+#define RTCM3_STN_MSG_MAX_FRAME_LEN 256
+
+typedef enum {
+  RTCM3_STN_MSG_1005 = 0u,
+  RTCM3_STN_MSG_1006,
+  RTCM3_STN_MSG_1008,
+  RTCM3_STN_MSG_1033,
+  RTCM3_STN_MSG_1230,
+  RTCM3_STN_MSG_COUNT
+} rtcm3_stn_msg_t;
+
+struct rtcm3_stn_msg {
+  u32 interval_ms;
+  /* content has been received */
+  bool valid;
+  /* content changed since the frame was encoded */
+  bool dirty;
+  /* next_due_ms is set */
+  bool scheduled;
+  /* GPS time of the next transmission, ms since the GPS epoch */
+  s64 next_due_ms;
+  union {
+    rtcm_msg_1005 msg_1005;
+    rtcm_msg_1006 msg_1006;
+    rtcm_msg_1008 msg_1008;
+    rtcm_msg_1033 msg_1033;
+    rtcm_msg_1230 msg_1230;
+  } msg;
+  u16 frame_length;
+  u8 frame[RTCM3_STN_MSG_MAX_FRAME_LEN];
+};
+
 typedef enum {
   UNSUPPORTED_CODE_UNKNOWN = 0u,
   UNSUPPORTED_CODE_GLO_L1P,
@@ -58,20 +198,47 @@ struct rtcm3_sbp_state {
   gps_time_t time_from_rover_obs;
   s8 leap_seconds;
   bool leap_second_known;
+  /* sender of the last observation message */
   u16 sender_id;
-  gps_time_t last_gps_time;
-  gps_time_t last_glo_time;
   gps_time_t last_1230_received;
   gps_time_t last_msm_received;
   void (*cb_rtcm_to_sbp)(
       u16 msg_id, u8 len, u8 *buff, u16 sender_id, void *context);
   void (*cb_base_obs_invalid)(double time_diff, void *context);
   void *context;
-  u8 obs_buffer[OBS_BUFFER_SIZE];
+  /* epochs being assembled, one per reference station */
+  struct rtcm3_station_buffer stations[RTCM3_MAX_STATIONS];
+  u32 station_use_count;
+  /* number of epochs held back per station for reordering, 0 if disabled */
+  u8 reorder_window;
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+  struct rtcm3_reorder_slot reorder_slots[RTCM3_REORDER_MAX_EPOCHS];
+#endif
+  /* number of messages merged into an epoch older than the newest one */
+  u32 n_reordered_msgs;
+  /* output epoch interval in ms, observation frames off this grid are
+   * skipped before decoding, 0 if disabled */
+  u32 decimation_ms;
+  /* number of observation frames skipped by the decimation */
+  u32 n_decimated_frames;
+  /* GPS time mappings of the GPS (also used by GAL, QZS, SBAS and BDS) and the
+   * GLO epoch times */
+  struct rtcm3_time_cache gps_time_cache;
+  struct rtcm3_time_cache glo_time_cache;
   bool sent_msm_warning;
   bool sent_code_warning[UNSUPPORTED_CODE_MAX];
   /* GLO FCN map, indexed by 1-based PRN */
   u8 glo_sv_id_fcn_map[NUM_SATS_GLO + 1];
+  /* timeout flushing of incomplete epochs */
+  struct rtcm3_epoch_timer epoch_timer;
+  /* diagnostics sink, counters and rate limits */
+  struct gnssc_diag diag;
+  /* optional statistics, NULL if disabled */
+  struct gnssc_stats *stats;
+  /* optional stage tracing, only recorded in GNSSC_TRACE builds */
+  struct gnssc_trace *trace;
+  /* converted messages when there is no cb_rtcm_to_sbp */
+  struct rtcm3_sbp_queue queue;
 };
 
 struct rtcm3_out_state {
@@ -79,6 +246,9 @@ struct rtcm3_out_state {
   bool leap_second_known;
   bool ant_known;
   void (*cb_sbp_to_rtcm)(u8 *buffer, u16 length, void *context);
+  /* optional, called with the complete epoch in sbp_obs_buffer before it is
+   * encoded and cleared */
+  void (*cb_sbp_obs_epoch)(const struct rtcm3_out_state *state, void *context);
   u16 sender_id;
   observation_header_t sbp_header;
   packed_obs_content_t sbp_obs_buffer[MAX_OBS_PER_EPOCH];
@@ -98,6 +268,17 @@ struct rtcm3_out_state {
   double ant_height; /* Antenna height above ARP, meters */
   char ant_descriptor[RTCM_MAX_STRING_LEN];
   char rcv_descriptor[RTCM_MAX_STRING_LEN];
+
+  /* station messages (1005, 1006, 1008, 1033, 1230) with their intervals */
+  struct rtcm3_stn_msg stn_msgs[RTCM3_STN_MSG_COUNT];
+
+  /* timeout flushing of incomplete epochs */
+  struct rtcm3_epoch_timer epoch_timer;
+
+  /* diagnostics sink, counters and rate limits */
+  struct gnssc_diag diag;
+  /* optional statistics, NULL if disabled */
+  struct gnssc_stats *stats;
 };
 
 void rtcm2sbp_decode_frame(const uint8_t *frame,
@@ -117,6 +298,47 @@ void rtcm2sbp_set_glo_fcn(sbp_gnss_signal_t sid,
                           u8 sbp_fcn,
                           struct rtcm3_sbp_state *state);
 
+/* Pass the current monotonic time in ms to the converter. An epoch whose
+ * last message has not arrived within the flush timeout of its previous
+ * message is sent out as it is. The time is also used for the diagnostics
+ * rate limiting. Without ticks epochs are only sent when complete. */
+void rtcm2sbp_tick(u64 now_ms, struct rtcm3_sbp_state *state);
+
+/* Set the flush timeout in ms, RTCM3_EPOCH_TIMEOUT_AUTO (the default)
+ * derives it from the epoch rate */
+void rtcm2sbp_set_flush_timeout(u32 timeout_ms, struct rtcm3_sbp_state *state);
+
+/* Hold back up to n_epochs epochs per station, so that messages arriving out
+ * of order (e.g. over UDP) are merged into their epoch instead of being
+ * dropped. Epochs are sent strictly in time order once the station has more
+ * than n_epochs pending, or on the flush timeout of rtcm2sbp_tick(), so the
+ * window adds up to n_epochs epochs of latency. 0 (the default) disables the
+ * window. Returns false if n_epochs is not below RTCM3_REORDER_MAX_EPOCHS,
+ * which with RTCM3_REORDER_MAX_EPOCHS 0 leaves only disabling it. */
+bool rtcm2sbp_set_reorder_window(u8 n_epochs, struct rtcm3_sbp_state *state);
+
+/* Only convert observation epochs on a grid of interval_ms in GPS time, e.g.
+ * 1000 to get 1 Hz output from a 10 Hz base. Frames of the other epochs are
+ * dropped after reading just their epoch time, without decoding them. GLONASS
+ * epochs are decimated only once the leap second is known and interval_ms
+ * divides a day. 0 (the default) disables the decimation. */
+void rtcm2sbp_set_decimation(u32 interval_ms, struct rtcm3_sbp_state *state);
+
+/* Record statistics of the conversion into the block, which must outlive its
+ * use by the state. A block has a single writer, so it must not be shared
+ * between states. NULL (the default) disables the statistics. */
+void rtcm2sbp_set_stats(struct gnssc_stats *stats,
+                        struct rtcm3_sbp_state *state);
+
+/* Record the entry and exit of the decode, convert, send and callback stages
+ * into the ring, see trace.h. Only has an effect if the library is built with
+ * GNSSC_TRACE. Like the statistics block the ring is kept by
+ * rtcm2sbp_reset(). NULL (the default) disables the tracing. */
+void rtcm2sbp_set_trace(struct gnssc_trace *trace,
+                        struct rtcm3_sbp_state *state);
+
+/* Initialise the state. When cb_rtcm_to_sbp is NULL the converted messages
+ * are queued in the state instead, to be read with rtcm2sbp_next(). */
 void rtcm2sbp_init(struct rtcm3_sbp_state *state,
                    void (*cb_rtcm_to_sbp)(u16 msg_id,
                                           u8 length,
@@ -126,14 +348,54 @@ void rtcm2sbp_init(struct rtcm3_sbp_state *state,
                    void (*cb_base_obs_invalid)(double time_diff, void *context),
                    void *context);
 
+/* Prepare the state for a new stream without a full rtcm2sbp_init(): the
+ * buffered epochs, warnings and counters are dropped while the callbacks,
+ * leap second, GLO FCN map, diagnostics sink and the reorder, decimation and
+ * flush settings are kept. With a config state these are copied from it
+ * instead. The statistics block and trace ring are kept as they are, they
+ * are never copied from the config as they may only have one writer. */
+void rtcm2sbp_reset(const struct rtcm3_sbp_state *config,
+                    struct rtcm3_sbp_state *state);
+
+/* Pull interface: decode an RTCM frame into the output queue of a state
+ * initialised without cb_rtcm_to_sbp. Messages that do not fit in the queue
+ * are dropped and counted in queue.n_dropped. Returns the number of queued
+ * messages. */
+u16 rtcm2sbp_push(const uint8_t *frame,
+                  uint32_t frame_length,
+                  struct rtcm3_sbp_state *state);
+
+/* Take the oldest message from the output queue, messages flushed by
+ * rtcm2sbp_tick() are queued as well. The payload stays valid until the next
+ * call on the state. Returns false if the queue is empty. */
+bool rtcm2sbp_next(struct rtcm2sbp_msg *msg, struct rtcm3_sbp_state *state);
+
 void sbp2rtcm_init(struct rtcm3_out_state *state,
                    void (*cb_sbp_to_rtcm)(u8 *buffer,
                                           u16 length,
                                           void *context),
                    void *context);
 
+/* Prepare the state for a new stream without a full sbp2rtcm_init(): the
+ * pending epoch and the station message content are dropped while the
+ * callbacks, leap second, GLO FCN map, output format, antenna and receiver
+ * info, station message intervals, diagnostics sink and flush timeout are
+ * kept. With a config state these are copied from it instead, except for the
+ * statistics block which is always kept. */
+void sbp2rtcm_reset(const struct rtcm3_out_state *config,
+                    struct rtcm3_out_state *state);
+
 void sbp2rtcm_set_leap_second(s8 leap_seconds, struct rtcm3_out_state *state);
 
+/* Same as rtcm2sbp_tick() for the SBP observation sequences */
+void sbp2rtcm_tick(u64 now_ms, struct rtcm3_out_state *state);
+
+void sbp2rtcm_set_flush_timeout(u32 timeout_ms, struct rtcm3_out_state *state);
+
+/* Same as rtcm2sbp_set_stats(), counting the SBP messages by message id */
+void sbp2rtcm_set_stats(struct gnssc_stats *stats,
+                        struct rtcm3_out_state *state);
+
 void sbp2rtcm_set_rtcm_out_mode(msm_enum value, struct rtcm3_out_state *state);
 
 void sbp2rtcm_set_glo_fcn(sbp_gnss_signal_t sid,
@@ -146,6 +408,18 @@ void sbp2rtcm_set_rcv_ant_descriptors(const char *ant_descriptor,
                                       const char *rcv_descriptor,
                                       struct rtcm3_out_state *state);
 
+/* Set the output interval of a station message (1005, 1006, 1008, 1033 or
+ * 1230).
+ * RTCM3_STN_MSG_INTERVAL_IMMEDIATE (the default, except for 1005 which is off)
+ * sends the message every time the SBP input arrives. Any other interval
+ * caches the encoded message and sends it with the observation epochs, at
+ * most one station message per epoch so that the load on the link stays even.
+ * RTCM3_STN_MSG_INTERVAL_OFF disables the message.
+ * Returns false if the message number is not a station message. */
+bool sbp2rtcm_set_station_msg_interval(u16 msg_num,
+                                       u32 interval_ms,
+                                       struct rtcm3_out_state *state);
+
 void sbp2rtcm_base_pos_ecef_cb(const u16 sender_id,
                                const u8 len,
                                const u8 msg[],
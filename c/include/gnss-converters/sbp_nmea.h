@@ -13,13 +13,28 @@
 #ifndef GNSS_CONVERTERS_SBP_NMEA_INTERFACE_H
 #define GNSS_CONVERTERS_SBP_NMEA_INTERFACE_H
 
+#include <stddef.h>
+
+#include <gnss-converters/capacity.h>
 #include <libsbp/gnss.h>
 #include <libsbp/navigation.h>
 #include <libsbp/observation.h>
 #include <libsbp/orientation.h>
 
 /* Max number of sats visible in an epoch */
-#define MAX_SATS 256
+#define MAX_SATS (GNSSC_MAX_SATS)
+
+/* Talker ids the satellites are grouped by: GP (GPS, SBAS and QZSS), GL, GA
+ * and GB */
+#define SBP2NMEA_TALKER_CNT 4
+
+/* NMEA satellite ids are below the BeiDou offset of 400 plus 256 */
+#define SBP2NMEA_SV_ID_CNT 656
+#define SBP2NMEA_SV_SET_WORDS ((SBP2NMEA_SV_ID_CNT + 63) / 64)
+
+/* Longest UTC time or date field with its NUL, for messages with values of
+ * up to 255 in the two digit fields as well */
+#define SBP2NMEA_UTC_FIELD_SIZE 16
 
 typedef enum sbp2nmea_nmea_id {
   SBP2NMEA_NMEA_GGA = 0,
@@ -59,25 +74,70 @@ typedef union sbp2nmea_msg {
   msg_baseline_heading_t sbp_heading;
 } sbp2nmea_msg_t;
 
+/* Set of satellites, bit n of words[n / 64] for NMEA satellite id n */
+typedef struct sbp2nmea_sv_set {
+  uint64_t words[SBP2NMEA_SV_SET_WORDS];
+} sbp2nmea_sv_set_t;
+
+/* Time and date fields of the UTC time of the current epoch, see
+ * sbp2nmea_t.utc_fields */
+typedef struct sbp2nmea_utc_fields {
+  /* the UTC time rounded to the resolution of the time field, flags 0 for
+   * empty fields */
+  msg_utc_time_t rounded;
+  /* "hhmmss.ss", "ddmmyy" and "dd,mm,yyyy", NUL terminated */
+  char time[SBP2NMEA_UTC_FIELD_SIZE];
+  char date[SBP2NMEA_UTC_FIELD_SIZE];
+  char date_long[SBP2NMEA_UTC_FIELD_SIZE];
+} sbp2nmea_utc_fields_t;
+
 typedef struct sbp_state_entry {
   sbp2nmea_msg_t msg;
 } sbp_state_entry_t;
 
+/* Batch mode output, see sbp2nmea_set_batch() */
+typedef struct sbp2nmea_batch {
+  char *buf;
+  size_t size;
+  /* characters of the pending epoch in buf */
+  size_t len;
+  /* UTC time of week of the pending epoch */
+  uint32_t tow;
+  void (*cb_batch)(const char *batch, size_t len, void *context);
+} sbp2nmea_batch_t;
+
 typedef struct sbp2nmea_state {
   uint8_t num_obs;
   uint8_t obs_seq_count;
   uint8_t obs_seq_total;
   sbp_gnss_signal_t nav_sids[MAX_SATS];
+  /* satellites of nav_sids by talker id, each listed once however many of
+   * its signals are tracked */
+  sbp2nmea_sv_set_t nav_svs[SBP2NMEA_TALKER_CNT];
   sbp_gps_time_t obs_time;
 
   uint16_t base_sender_id;
 
   nmea_state_entry_t nmea_state[SBP2NMEA_NMEA_CNT];
   sbp_state_entry_t sbp_state[SBP2NMEA_SBP_CNT];
+  /* inputs with the time of week of the UTC time, i.e. those of the current
+   * epoch, one bit per sbp2nmea_sbp_id_t */
+  uint8_t epoch_mask;
+  /* the UTC time fields of the sentences, formatted once per UTC time
+   * message instead of once per sentence. Only the digits that changed since
+   * the previous message are rewritten. */
+  sbp2nmea_utc_fields_t utc_fields;
 
   float soln_freq;
 
   void (*cb_sbp_to_nmea)();
+  void (*cb_sentence)(const char *sentence,
+                      size_t len,
+                      sbp2nmea_nmea_id_t id,
+                      void *context);
+  void *context;
+  /* optional batch mode, NULL if disabled */
+  sbp2nmea_batch_t *batch;
 } sbp2nmea_t;
 
 #ifdef __cplusplus
@@ -86,6 +146,39 @@ extern "C" {
 
 void sbp2nmea_init(sbp2nmea_t *state, void (*cb_sbp_to_nmea)(u8 msg_id[]));
 
+/* Initialise the state with a callback that is given the length and type of
+ * each sentence together with the context, so that a process can run any
+ * number of states. The sentence is len characters including the trailing
+ * CR LF, and is NUL terminated as well. */
+void sbp2nmea_init_v2(sbp2nmea_t *state,
+                      void (*cb_sentence)(const char *sentence,
+                                          size_t len,
+                                          sbp2nmea_nmea_id_t id,
+                                          void *context),
+                      void *context);
+
+/* Set up a batch of size characters in buf. cb_batch is given the context of
+ * the state it is attached to. */
+void sbp2nmea_batch_init(sbp2nmea_batch_t *batch,
+                         char buf[],
+                         size_t size,
+                         void (*cb_batch)(const char *batch,
+                                          size_t len,
+                                          void *context));
+
+/* Batch mode: collect the sentences of each epoch in the batch and hand them
+ * to its callback in one piece instead of calling the sentence callback, e.g.
+ * to write an epoch with a single system call. An epoch is handed over once
+ * all the sentences due at its time with sbp2nmea_rate_set() are out, or when
+ * the next epoch starts if some of them never became ready. A full batch is
+ * handed over early, a sentence longer than the whole batch on its own. The
+ * batch must outlive its use by the state and not be shared between states.
+ * NULL (the default) disables the batch mode. */
+void sbp2nmea_set_batch(sbp2nmea_t *state, sbp2nmea_batch_t *batch);
+
+/* Hand over the pending sentences of the batch, e.g. at the end of a stream */
+void sbp2nmea_flush(sbp2nmea_t *state);
+
 void sbp2nmea(sbp2nmea_t *state, const void *sbp_msg, sbp2nmea_sbp_id_t sbp_id);
 void sbp2nmea_obs(sbp2nmea_t *state, const msg_obs_t *sbp_obs, uint8_t num_obs);
 
@@ -94,7 +187,10 @@ uint16_t sbp2nmea_base_id_get(const sbp2nmea_t *state);
 
 uint8_t sbp2nmea_num_obs_get(const sbp2nmea_t *state);
 const sbp_gnss_signal_t *sbp2nmea_nav_sids_get(const sbp2nmea_t *state);
+/* The SBP2NMEA_TALKER_CNT satellite sets of the observations */
+const sbp2nmea_sv_set_t *sbp2nmea_nav_svs_get(const sbp2nmea_t *state);
 
+/* Output a NUL terminated sentence through the callbacks of the state */
 void sbp2nmea_to_str(const sbp2nmea_t *state, char *sentence);
 
 void *sbp2nmea_msg_get(const sbp2nmea_t *state, sbp2nmea_sbp_id_t id);
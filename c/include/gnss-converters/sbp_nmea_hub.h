@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* SBP to NMEA front-end serving several output profiles from one input
+ * stream. The SBP messages are stored once, each sentence type is formatted
+ * at most once per epoch, and the bytes are handed to every subscriber whose
+ * rate includes the epoch. The sentences of the current epoch are also kept
+ * in a cache. */
+
+#ifndef GNSS_CONVERTERS_SBP_NMEA_HUB_H
+#define GNSS_CONVERTERS_SBP_NMEA_HUB_H
+
+#include <gnss-converters/sbp_nmea.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SBP2NMEA_HUB_MAX_SUBSCRIBERS 16
+/* enough for one sentence of each type and a GSA sentence per talker */
+#define SBP2NMEA_HUB_CACHE_SIZE 2048
+
+typedef struct sbp2nmea_hub_subscriber {
+  /* NULL for a free slot */
+  void (*cb_sentence)(const char *sentence,
+                      size_t len,
+                      sbp2nmea_nmea_id_t id,
+                      void *context);
+  void *context;
+  /* as in sbp2nmea_rate_set(), 0 disables the sentence */
+  int rate[SBP2NMEA_NMEA_CNT];
+} sbp2nmea_hub_subscriber_t;
+
+typedef struct sbp2nmea_hub {
+  /* holds the incoming SBP messages and formats the sentences, use
+   * sbp2nmea_base_id_set() and sbp2nmea_soln_freq_set() on this state. Its
+   * sentence rates are managed by the hub. */
+  sbp2nmea_t in;
+  /* UTC time of week of the cached sentences */
+  uint32_t cache_tow;
+  uint16_t cache_len;
+  /* position and length of the sentences of each type in cache, GSA may have
+   * several. A length of 0 means none this epoch. */
+  uint16_t cache_offset[SBP2NMEA_NMEA_CNT];
+  uint16_t cache_sentence_len[SBP2NMEA_NMEA_CNT];
+  char cache[SBP2NMEA_HUB_CACHE_SIZE];
+  /* number of sentences formatted, at most one per type and epoch except
+   * for GSA */
+  uint32_t n_formatted;
+  /* sentences that were delivered but did not fit in the cache */
+  uint32_t n_uncached;
+  sbp2nmea_hub_subscriber_t subscribers[SBP2NMEA_HUB_MAX_SUBSCRIBERS];
+} sbp2nmea_hub_t;
+
+void sbp2nmea_hub_init(sbp2nmea_hub_t *hub);
+
+/* Add a subscriber with all sentences disabled. Returns its index for
+ * sbp2nmea_hub_rate_set(), or -1 if all slots are taken. */
+int sbp2nmea_hub_subscribe(sbp2nmea_hub_t *hub,
+                           void (*cb_sentence)(const char *sentence,
+                                               size_t len,
+                                               sbp2nmea_nmea_id_t id,
+                                               void *context),
+                           void *context);
+
+void sbp2nmea_hub_unsubscribe(sbp2nmea_hub_t *hub, int subscriber);
+
+/* Same as sbp2nmea_rate_set() for one subscriber. A sentence type is
+ * formatted at the greatest common divisor of the rates the subscribers
+ * have set for it. */
+void sbp2nmea_hub_rate_set(sbp2nmea_hub_t *hub,
+                           int subscriber,
+                           int rate,
+                           sbp2nmea_nmea_id_t id);
+
+/* Same as sbp2nmea() and sbp2nmea_obs() */
+void sbp2nmea_hub(sbp2nmea_hub_t *hub,
+                  const void *sbp_msg,
+                  sbp2nmea_sbp_id_t sbp_id);
+void sbp2nmea_hub_obs(sbp2nmea_hub_t *hub,
+                      const msg_obs_t *sbp_obs,
+                      uint8_t num_obs);
+
+/* Get the sentences of type id of the current epoch from the cache. They
+ * stay valid until the next epoch starts. Returns their total length, 0 if
+ * there are none or id is not a type the converter generates. */
+size_t sbp2nmea_hub_get(const sbp2nmea_hub_t *hub,
+                        sbp2nmea_nmea_id_t id,
+                        const char **sentences);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_CONVERTERS_SBP_NMEA_HUB_H */
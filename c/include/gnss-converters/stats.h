@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Optional conversion statistics of a converter state. The block is supplied
+ * by the caller and attached with rtcm2sbp_set_stats() or
+ * sbp2rtcm_set_stats(), the converter is its only writer. Other threads read
+ * it with gnssc_stats_snapshot(), which takes no lock and never blocks the
+ * converter: the writer bumps a sequence counter around every update and the
+ * reader retries the copy until it sees no update in between. */
+
+#ifndef GNSS_CONVERTERS_STATS_H
+#define GNSS_CONVERTERS_STATS_H
+
+#include <stdbool.h>
+
+#include <swiftnav/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Message numbers tracked individually, the rest is counted in n_other_msgs */
+#define GNSSC_STATS_MAX_MSG_TYPES 32
+
+/* Bin i of the conversion time histogram counts times in [2^i, 2^(i+1)) ns,
+ * bin 0 also holds 0 ns and the last bin everything above */
+#define GNSSC_STATS_HIST_BINS 32
+
+/* Times gnssc_stats_snapshot() retries a copy torn by an update */
+#define GNSSC_STATS_SNAPSHOT_RETRIES 16
+
+/* Reasons for input to be dropped. The comment lists the unit counted. */
+typedef enum gnssc_stats_drop_e {
+  /* messages, no time known to resolve the epoch */
+  GNSSC_STATS_DROP_NO_TIME = 0,
+  /* messages, epoch time out of range */
+  GNSSC_STATS_DROP_INVALID_TIME,
+  /* messages, legacy observations while MSM observations are received */
+  GNSSC_STATS_DROP_MSM_ACTIVE,
+  /* messages, off the decimation grid */
+  GNSSC_STATS_DROP_DECIMATED,
+  /* messages, epoch already flushed on timeout */
+  GNSSC_STATS_DROP_LATE,
+  /* messages, broken observation sequence */
+  GNSSC_STATS_DROP_SEQ_INVALID,
+  /* observations, epoch buffer full */
+  GNSSC_STATS_DROP_BUFFER_FULL,
+  /* observations, signal not representable in the output */
+  GNSSC_STATS_DROP_UNSUPPORTED_CODE,
+  /* messages, output queue of the pull interface full */
+  GNSSC_STATS_DROP_QUEUE_FULL,
+  GNSSC_STATS_DROP_COUNT
+} gnssc_stats_drop_t;
+
+typedef struct {
+  /* RTCM message number or SBP message id of the input */
+  u16 msg_num;
+  u32 count;
+  u32 decode_errors;
+  /* log2 histogram of the conversion time, see GNSSC_STATS_HIST_BINS */
+  u32 time_hist[GNSSC_STATS_HIST_BINS];
+} gnssc_msg_stats_t;
+
+struct gnssc_stats {
+  /* odd while the converter updates the block */
+  u32 seq;
+  /* optional monotonic clock in ns for the conversion times, the library
+   * has no clock of its own */
+  u64 (*clock_ns)(void *context);
+  void *clock_context;
+  u32 drops[GNSSC_STATS_DROP_COUNT];
+  /* observations decoded from the input and sent in the output */
+  u32 obs_in;
+  u32 obs_out;
+  /* messages of types beyond the first GNSSC_STATS_MAX_MSG_TYPES */
+  u32 n_other_msgs;
+  /* message types in order of first arrival */
+  u16 n_msg_types;
+  gnssc_msg_stats_t msgs[GNSSC_STATS_MAX_MSG_TYPES];
+};
+
+/* Clear the block and set the clock, clock_ns may be NULL to leave the time
+ * histograms empty */
+void gnssc_stats_init(struct gnssc_stats *stats,
+                      u64 (*clock_ns)(void *context),
+                      void *context);
+
+/* Clear the counters, keeping the clock. Must be called from the thread
+ * running the converter. */
+void gnssc_stats_clear(struct gnssc_stats *stats);
+
+/* Copy a consistent snapshot of the block into out, from any thread. Returns
+ * false if every attempt overlapped an update, out is then torn. */
+bool gnssc_stats_snapshot(const struct gnssc_stats *stats,
+                          struct gnssc_stats *out);
+
+/* Statistics of a message number in a block or snapshot, NULL if it has not
+ * been seen */
+const gnssc_msg_stats_t *gnssc_stats_msg(const struct gnssc_stats *stats,
+                                         u16 msg_num);
+
+const char *gnssc_stats_drop_name(gnssc_stats_drop_t drop);
+
+/* Writer side, used by the converters. All of them accept a NULL block. */
+
+/* Current time of the clock, 0 without one */
+u64 gnssc_stats_now(const struct gnssc_stats *stats);
+
+/* Count a converted message, with its decode result and its conversion time
+ * from start_ns (taken with gnssc_stats_now()) */
+void gnssc_stats_msg_done(struct gnssc_stats *stats,
+                          u16 msg_num,
+                          bool decode_error,
+                          u64 start_ns);
+
+void gnssc_stats_drop(struct gnssc_stats *stats,
+                      gnssc_stats_drop_t drop,
+                      u32 count);
+
+void gnssc_stats_obs(struct gnssc_stats *stats, u32 obs_in, u32 obs_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_CONVERTERS_STATS_H */
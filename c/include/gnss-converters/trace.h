@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Tracing of the conversion stages for latency analysis. The hooks in the
+ * converters are compiled in only when the library is built with the
+ * GNSSC_TRACE CMake option, otherwise the GNSSC_TRACE_* macros expand to
+ * nothing and attaching a ring has no effect. Each hook appends a record to a
+ * ring supplied by the caller, which drains it from the same thread, e.g.
+ * into gnssc_trace_write_json(). */
+
+#ifndef GNSS_CONVERTERS_TRACE_H
+#define GNSS_CONVERTERS_TRACE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <swiftnav/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum gnssc_trace_stage_e {
+  /* RTCM decoding and dispatch of the message, the message number is the
+   * RTCM one */
+  GNSSC_TRACE_DECODE = 0,
+  /* RTCM observations to SBP */
+  GNSSC_TRACE_CONVERT,
+  /* splitting an epoch into SBP observation messages */
+  GNSSC_TRACE_SEND_OBS,
+  /* user callback, the message number is the SBP message id */
+  GNSSC_TRACE_CALLBACK,
+  GNSSC_TRACE_STAGE_COUNT
+} gnssc_trace_stage_t;
+
+typedef enum gnssc_trace_phase_e {
+  GNSSC_TRACE_ENTRY = 0,
+  GNSSC_TRACE_EXIT,
+} gnssc_trace_phase_t;
+
+typedef struct {
+  u64 time_ns;
+  u16 msg_num;
+  u8 stage;
+  u8 phase;
+  /* nesting level, the same for an entry and its exit */
+  u8 depth;
+} gnssc_trace_record_t;
+
+struct gnssc_trace {
+  /* monotonic clock in ns, the library has no clock of its own */
+  u64 (*clock_ns)(void *context);
+  void *clock_context;
+  gnssc_trace_record_t *records;
+  /* a power of two, so the running counts below wrap with the ring */
+  u32 size;
+  /* running counts of the records written and read, the ring holds
+   * head - tail records */
+  u32 head;
+  u32 tail;
+  /* oldest records overwritten because the ring was full */
+  u32 n_overwritten;
+  /* nesting level of the next entry record */
+  u8 depth;
+  /* bit per nesting level whose entry has been read but not its exit */
+  u32 open_levels;
+};
+
+/* Set up the ring over the caller's array of size records, size must be a
+ * power of two */
+void gnssc_trace_init(struct gnssc_trace *trace,
+                      gnssc_trace_record_t records[],
+                      u32 size,
+                      u64 (*clock_ns)(void *context),
+                      void *context);
+
+/* Append a record, overwriting the oldest one if the ring is full so that the
+ * ring always holds the latest records. Accepts a NULL ring. */
+void gnssc_trace_record(struct gnssc_trace *trace,
+                        gnssc_trace_stage_t stage,
+                        gnssc_trace_phase_t phase,
+                        u16 msg_num);
+
+/* Take the oldest record, returns false if the ring is empty. Exit records
+ * whose entry was overwritten are skipped, so the records read always nest. */
+bool gnssc_trace_next(struct gnssc_trace *trace, gnssc_trace_record_t *record);
+
+const char *gnssc_trace_stage_name(gnssc_trace_stage_t stage);
+
+/* Reference sink writing the records as Chrome trace events (chrome://tracing
+ * or Perfetto). Call gnssc_trace_write_json() as often as needed between
+ * gnssc_trace_json_begin() and gnssc_trace_json_end(), each call drains the
+ * ring. Returns the number of records written. */
+void gnssc_trace_json_begin(FILE *file);
+u32 gnssc_trace_write_json(struct gnssc_trace *trace, FILE *file);
+void gnssc_trace_json_end(FILE *file);
+
+#ifdef GNSSC_TRACE
+#define GNSSC_TRACE_BEGIN(trace, stage, msg_num) \
+  gnssc_trace_record((trace), (stage), GNSSC_TRACE_ENTRY, (msg_num))
+#define GNSSC_TRACE_END(trace, stage, msg_num) \
+  gnssc_trace_record((trace), (stage), GNSSC_TRACE_EXIT, (msg_num))
+#else
+#define GNSSC_TRACE_BEGIN(trace, stage, msg_num) \
+  do {                                           \
+  } while (0)
+#define GNSSC_TRACE_END(trace, stage, msg_num) \
+  do {                                         \
+  } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_CONVERTERS_TRACE_H */
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "gnss-converters/diagnostics.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <swiftnav/signal.h>
+
+static const char *const event_names[GNSSC_DIAG_COUNT] = {
+    [GNSSC_DIAG_RTCM_ENCODE_FAILED] = "RTCM_ENCODE_FAILED",
+    [GNSSC_DIAG_INVALID_GLO_FCN] = "INVALID_GLO_FCN",
+    [GNSSC_DIAG_INVALID_GLO_PRN] = "INVALID_GLO_PRN",
+    [GNSSC_DIAG_LOG_TRUNCATED] = "LOG_TRUNCATED",
+    [GNSSC_DIAG_MSM_CELL_NOT_SET] = "MSM_CELL_NOT_SET",
+    [GNSSC_DIAG_MSM_UNSUPPORTED_CODE] = "MSM_UNSUPPORTED_CODE",
+    [GNSSC_DIAG_MSM_INVALID_CODE] = "MSM_INVALID_CODE",
+    [GNSSC_DIAG_MSM_INVALID_PRN] = "MSM_INVALID_PRN",
+    [GNSSC_DIAG_MSM_SAT_LIMIT] = "MSM_SAT_LIMIT",
+    [GNSSC_DIAG_MSM_SIGNAL_LIMIT] = "MSM_SIGNAL_LIMIT",
+    [GNSSC_DIAG_MSM_NOT_IN_SAT_MASK] = "MSM_NOT_IN_SAT_MASK",
+    [GNSSC_DIAG_MSM_NOT_IN_SIGNAL_MASK] = "MSM_NOT_IN_SIGNAL_MASK",
+    [GNSSC_DIAG_OBS_IN_PAST] = "OBS_IN_PAST",
+    [GNSSC_DIAG_OBS_SEQ_ENDED] = "OBS_SEQ_ENDED",
+    [GNSSC_DIAG_OBS_SEQ_INVALID] = "OBS_SEQ_INVALID",
+    [GNSSC_DIAG_OBS_SEQ_MISSED] = "OBS_SEQ_MISSED",
+    [GNSSC_DIAG_OBS_BUFFER_FULL] = "OBS_BUFFER_FULL",
+};
+
+void gnssc_diag_init(struct gnssc_diag *diag) {
+  memset(diag, 0, sizeof(*diag));
+  gnssc_diag_set_rate_limit(diag,
+                            GNSSC_DIAG_COUNT,
+                            GNSSC_DIAG_DEFAULT_INTERVAL_MS,
+                            GNSSC_DIAG_DEFAULT_BURST);
+}
+
+void gnssc_diag_reset_counters(struct gnssc_diag *diag) {
+  diag->now_ms = 0;
+  diag->time_set = false;
+  for (gnssc_diag_event_t i = 0; i < GNSSC_DIAG_COUNT; i++) {
+    diag->counters[i].count = 0;
+    diag->counters[i].suppressed = 0;
+    diag->counters[i].window_count = 0;
+    diag->counters[i].window_start_ms = 0;
+  }
+}
+
+void gnssc_diag_set_sink(struct gnssc_diag *diag,
+                         gnssc_diag_cb_t cb,
+                         void *context) {
+  diag->cb = cb;
+  diag->context = context;
+}
+
+void gnssc_diag_set_rate_limit(struct gnssc_diag *diag,
+                               gnssc_diag_event_t event,
+                               u32 interval_ms,
+                               u16 burst) {
+  for (gnssc_diag_event_t i = 0; i < GNSSC_DIAG_COUNT; i++) {
+    if (GNSSC_DIAG_COUNT == event || i == event) {
+      diag->counters[i].interval_ms = interval_ms;
+      diag->counters[i].burst = burst;
+    }
+  }
+}
+
+void gnssc_diag_set_time(struct gnssc_diag *diag, u64 now_ms) {
+  diag->now_ms = now_ms;
+  diag->time_set = true;
+}
+
+u32 gnssc_diag_count(const struct gnssc_diag *diag, gnssc_diag_event_t event) {
+  assert(event < GNSSC_DIAG_COUNT);
+  return diag->counters[event].count;
+}
+
+/* Returns true if the event may be delivered now, otherwise counts it as
+ * suppressed. Without a time the windows would never end, so nothing is
+ * limited until the embedder provides one. */
+static bool rate_limit_pass(const struct gnssc_diag *diag,
+                            gnssc_diag_counter_t *counter) {
+  const u64 now_ms = diag->now_ms;
+  if (0 == counter->interval_ms || !diag->time_set) {
+    return true;
+  }
+  if (0 == counter->window_count ||
+      now_ms - counter->window_start_ms >= counter->interval_ms) {
+    counter->window_start_ms = now_ms;
+    counter->window_count = 0;
+  }
+  if (counter->window_count >= counter->burst) {
+    counter->suppressed++;
+    return false;
+  }
+  counter->window_count++;
+  return true;
+}
+
+void gnssc_diag_report(struct gnssc_diag *diag,
+                       gnssc_diag_event_t event,
+                       u16 stn_id,
+                       s32 arg0,
+                       s32 arg1,
+                       s32 arg2,
+                       s32 arg3) {
+  if (NULL == diag) {
+    return;
+  }
+  assert(event < GNSSC_DIAG_COUNT);
+  gnssc_diag_counter_t *counter = &diag->counters[event];
+  counter->count++;
+
+  /* nothing is built or formatted unless somebody is listening */
+  if (NULL == diag->cb || !rate_limit_pass(diag, counter)) {
+    return;
+  }
+
+  gnssc_diag_t report = {.event = event,
+                         .stn_id = stn_id,
+                         .args = {arg0, arg1, arg2, arg3},
+                         .suppressed = counter->suppressed};
+  counter->suppressed = 0;
+  diag->cb(&report, diag->context);
+}
+
+const char *gnssc_diag_event_name(gnssc_diag_event_t event) {
+  if (event >= GNSSC_DIAG_COUNT) {
+    return "UNKNOWN";
+  }
+  return event_names[event];
+}
+
+static int msm_sid_to_str(const gnssc_diag_t *diag,
+                          const char *reason,
+                          char *buf,
+                          size_t len) {
+  char code_string[SID_STR_LEN_MAX];
+  gnss_signal_t sid = {(u16)diag->args[1], (code_t)diag->args[0]};
+  sid_to_string(code_string, SID_STR_LEN_MAX, sid);
+  return snprintf(
+      buf, len, "Cannot add %s to MSM message: %s", code_string, reason);
+}
+
+int gnssc_diag_to_str(const gnssc_diag_t *diag, char *buf, size_t len) {
+  const s32 *a = diag->args;
+  int n = 0;
+  switch (diag->event) {
+    case GNSSC_DIAG_RTCM_ENCODE_FAILED:
+      n = snprintf(buf, len, "Error encoding RTCM message %" PRId32, a[0]);
+      break;
+    case GNSSC_DIAG_INVALID_GLO_FCN:
+      n = snprintf(buf, len, "Ignoring invalid GLO FCN %" PRId32, a[0]);
+      break;
+    case GNSSC_DIAG_INVALID_GLO_PRN:
+      n = snprintf(buf, len, "Ignoring invalid GLO PRN %" PRId32, a[0]);
+      break;
+    case GNSSC_DIAG_LOG_TRUNCATED:
+      n = snprintf(buf,
+                   len,
+                   "Truncating too long log message from %" PRId32
+                   " to %" PRId32 " bytes",
+                   a[0],
+                   a[1]);
+      break;
+    case GNSSC_DIAG_MSM_CELL_NOT_SET:
+      n = snprintf(buf,
+                   len,
+                   "Cell mask not set for sat %" PRId32 " signal %" PRId32,
+                   a[0],
+                   a[1]);
+      break;
+    case GNSSC_DIAG_MSM_UNSUPPORTED_CODE:
+      n = snprintf(buf,
+                   len,
+                   "Code %" PRId32 " not found in RTCM constellation %" PRId32,
+                   a[0],
+                   a[1]);
+      break;
+    case GNSSC_DIAG_MSM_INVALID_CODE:
+      n = msm_sid_to_str(diag, "invalid code", buf, len);
+      break;
+    case GNSSC_DIAG_MSM_INVALID_PRN:
+      n = msm_sid_to_str(diag, "invalid PRN", buf, len);
+      break;
+    case GNSSC_DIAG_MSM_SAT_LIMIT:
+      n = msm_sid_to_str(
+          diag, "cell size limit for satellites reached", buf, len);
+      break;
+    case GNSSC_DIAG_MSM_SIGNAL_LIMIT:
+      n = msm_sid_to_str(diag, "cell size limit for signals reached", buf, len);
+      break;
+    case GNSSC_DIAG_MSM_NOT_IN_SAT_MASK:
+      n = msm_sid_to_str(diag, "not in satellite mask", buf, len);
+      break;
+    case GNSSC_DIAG_MSM_NOT_IN_SIGNAL_MASK:
+      n = msm_sid_to_str(diag, "not in signal mask", buf, len);
+      break;
+    case GNSSC_DIAG_OBS_IN_PAST:
+      n = snprintf(buf,
+                   len,
+                   "Discarding SBP obs with timestamp %" PRId32
+                   " ms in the past",
+                   a[0]);
+      break;
+    case GNSSC_DIAG_OBS_SEQ_ENDED:
+      n = snprintf(buf,
+                   len,
+                   "SBP obs sequence ended prematurely, starting new one at "
+                   "dt=%" PRId32 " ms",
+                   a[0]);
+      break;
+    case GNSSC_DIAG_OBS_SEQ_INVALID:
+      n = snprintf(buf,
+                   len,
+                   "Ignoring SBP obs with invalid obs sequence: expected "
+                   "%" PRId32 "/%" PRId32 " but got %" PRId32 "/%" PRId32,
+                   a[0],
+                   a[1],
+                   a[2],
+                   a[3]);
+      break;
+    case GNSSC_DIAG_OBS_SEQ_MISSED:
+      n = snprintf(buf,
+                   len,
+                   "Missed an SBP obs packet, expected seq %" PRId32 "/%" PRId32
+                   " but got %" PRId32 "/%" PRId32,
+                   a[0],
+                   a[1],
+                   a[2],
+                   a[3]);
+      break;
+    case GNSSC_DIAG_OBS_BUFFER_FULL:
+      n = snprintf(buf,
+                   len,
+                   "Reached max observations per epoch %" PRId32
+                   ", ignoring the remaining %" PRId32 " obs",
+                   a[0],
+                   a[1]);
+      break;
+    case GNSSC_DIAG_COUNT:
+    default:
+      n = snprintf(buf, len, "Unknown diagnostic %d", (int)diag->event);
+      break;
+  }
+  return n;
+}
+
+void gnssc_diag_stderr_sink(const gnssc_diag_t *diag, void *context) {
+  (void)context;
+  char buf[256];
+  gnssc_diag_to_str(diag, buf, sizeof(buf));
+  if (diag->suppressed > 0) {
+    fprintf(stderr,
+            "%s (%" PRIu32 " similar suppressed)\n",
+            buf,
+            diag->suppressed);
+  } else {
+    fprintf(stderr, "%s\n", buf);
+  }
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* This is a stand-alone tool that prints the capacity the library was built
+ * with and the resulting size of the converter states, see capacity.h. */
+
+#include <stdio.h>
+
+#include <gnss-converters/capacity.h>
+#include <gnss-converters/nmea_sbp.h>
+#include <gnss-converters/rtcm3_fanout.h>
+#include <gnss-converters/rtcm3_sbp.h>
+#include <gnss-converters/sbp_nmea.h>
+#include <gnss-converters/sbp_nmea_hub.h>
+
+#define PRINT_VALUE(name) printf("%-32s %8u\n", #name, (unsigned)(name))
+#define PRINT_SIZE(type) printf("%-32s %8zu\n", #type, sizeof(type))
+
+int main(void) {
+  PRINT_VALUE(GNSSC_MAX_OBS_PER_EPOCH);
+  PRINT_VALUE(GNSSC_MAX_SATS);
+  PRINT_VALUE(RTCM3_MAX_STATIONS);
+  PRINT_VALUE(RTCM3_REORDER_MAX_EPOCHS);
+  printf("\n");
+
+  PRINT_SIZE(struct rtcm3_sbp_state);
+  PRINT_SIZE(struct rtcm3_station_buffer);
+  PRINT_SIZE(struct rtcm3_reorder_slot);
+  PRINT_SIZE(struct rtcm3_sbp_queue);
+  PRINT_SIZE(struct rtcm3_out_state);
+  PRINT_SIZE(struct gnssc_stats);
+  PRINT_SIZE(struct rtcm3_fanout);
+  PRINT_SIZE(sbp2nmea_t);
+  PRINT_SIZE(sbp2nmea_hub_t);
+  PRINT_SIZE(nmea2sbp_t);
+  return 0;
+}
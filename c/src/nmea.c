@@ -14,18 +14,16 @@
 
 #include <assert.h>
 #include <math.h>
-#include <stdarg.h>
-#include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include <gnss-converters/nmea.h>
-#include <swiftnav/array_tools.h>
 #include <swiftnav/constants.h>
 #include <swiftnav/gnss_time.h>
 #include <swiftnav/pvt_result.h>
 #include <swiftnav/signal.h>
 
+#include "nmea_format.h"
+
 /** \addtogroup io
  * \{ */
 
@@ -53,15 +51,11 @@
 
 /* Number of decimals in NMEA time stamp (valid values 1-4) */
 #define NMEA_UTC_S_DECIMALS 2
-#define NMEA_UTC_S_FRAC_DIVISOR pow(10, NMEA_UTC_S_DECIMALS)
-
-/* Adequate until end of year 999999.
-   Worst case: "%02d%02d%05.2f,%02d,%02d,%lu" */
-#define NMEA_TS_MAX_LEN (21 + NMEA_UTC_S_DECIMALS)
+#define NMEA_UTC_S_FRAC_DIVISOR ((double)pow10_u16[NMEA_UTC_S_DECIMALS])
 
 /* Accuracy of Course Over Ground */
 #define NMEA_COG_DECIMALS 1
-#define NMEA_COG_FRAC_DIVISOR pow(10, NMEA_COG_DECIMALS)
+#define NMEA_COG_FRAC_DIVISOR ((double)pow10_u16[NMEA_COG_DECIMALS])
 
 /* Based on testing calculated Course Over Ground starts deviating noticeably
  * below this limit. */
@@ -69,112 +63,53 @@
 #define NMEA_COG_STATIC_LIMIT_KNOTS MS2KNOTS(NMEA_COG_STATIC_LIMIT_MS, 0, 0)
 #define NMEA_COG_STATIC_LIMIT_KPH MS2KMHR(NMEA_COG_STATIC_LIMIT_MS, 0, 0)
 
+static const u16 pow10_u16[] = {1, 10, 100, 1000, 10000};
+
 typedef enum talker_id_e {
   TALKER_ID_INVALID = -1,
   TALKER_ID_GP = 0,
   TALKER_ID_GL = 1,
   TALKER_ID_GA = 2,
   TALKER_ID_GB = 3,
-  TALKER_ID_COUNT = 4
+  TALKER_ID_COUNT = SBP2NMEA_TALKER_CNT
 } talker_id_t;
 
-#define NMEA_SUFFIX_LEN                    \
-  6 /* How much room to leave for the NMEA \
-       checksum, CRLF + null termination,  \
-       i.e. "*%02X\r\n\0" */
-
 /** Some helper macros for functions generating NMEA sentences. */
 
-/** NMEA_SENTENCE_START: declare a buffer and set up some pointers
+/** NMEA_SENTENCE_START: declare a buffer and the formatter writing into it,
+ * named sentence, see nmea_format.h
  * max_len = max possible length of the body of the message
  * (not including suffix)
  */
-#define NMEA_SENTENCE_START(max_len)              \
-  char sentence_buf[(max_len) + NMEA_SUFFIX_LEN]; \
-  char *sentence_bufp = sentence_buf;             \
-  char *const sentence_buf_end = sentence_buf + (max_len);
-
-/** NMEA_SENTENCE_PRINTF: use like printf, can use multiple times
-    within a sentence. */
-#define NMEA_SENTENCE_PRINTF(fmt, ...)                                        \
-  do {                                                                        \
-    sentence_bufp += snprintf(                                                \
-        sentence_bufp, sentence_buf_end - sentence_bufp, fmt, ##__VA_ARGS__); \
-    if (sentence_bufp >= sentence_buf_end) sentence_bufp = sentence_buf_end;  \
-  } while (0)
+#define NMEA_SENTENCE_START(max_len)                  \
+  char sentence_buf[(max_len) + NMEA_FMT_SUFFIX_LEN]; \
+  nmea_fmt_t sentence;                                \
+  nmea_fmt_init(&sentence, sentence_buf, (max_len))
 
-/** NMEA_SENTENCE_DONE: append checksum and dispatch.
+/** NMEA_SENTENCE_DONE: append checksum and dispatch as sentence type id.
  * \note According to section 5.3.1 of the NMEA 0183 spec, sentences are
  *       terminated with <CR><LF>. The sentence_buf is null_terminated.
  *       The call to nmea_output has been modified to remove the NULL.
  *       This will also affect all registered dispatchers
  */
-#define NMEA_SENTENCE_DONE(state)                             \
-  do {                                                        \
-    nmea_append_checksum(sentence_buf, sizeof(sentence_buf)); \
-    nmea_output(state, sentence_buf);                         \
+#define NMEA_SENTENCE_DONE(state, id)                     \
+  do {                                                    \
+    size_t sentence_len = nmea_fmt_finish(&sentence);     \
+    nmea_output(state, sentence_buf, sentence_len, (id)); \
   } while (0)
 
 /** Output NMEA sentence.
  *
  * \param state        sbp2nmea context.
  * \param sentence     The NMEA sentence to output.
+ * \param len          Length of the sentence, not counting the NULL.
+ * \param id           Type of the sentence.
  */
-static void nmea_output(const sbp2nmea_t *state, char *sentence) {
-  sbp2nmea_to_str(state, sentence);
-}
-
-/** Calculate and append the checksum of an NMEA sentence.
- * Calculates the bitwise XOR of the characters in a string until the end of
- * the string or a `*` is encountered. If the first character is `$` then it
- * is skipped.
- *
- * \param s A null-terminated NMEA sentence, up to and optionally
- * including the '*'
- *
- * \param size Length of the buffer.
- *
- */
-static void nmea_append_checksum(char *s, size_t size) {
-  u8 sum = 0;
-  char *p = s;
-
-  /* '$' header not included in checksum calculation */
-  if (*p == '$') {
-    p++;
-  }
-
-  /* '*'  not included in checksum calculation */
-  while (*p != '*' && *p && p + NMEA_SUFFIX_LEN < s + size) {
-    sum ^= *p;
-    p++;
-  }
-
-  sprintf(p, "*%02X\r\n", sum);
-}
-
-/** Wrapper function for vsnprintf to accommodate return value handling. Updates
- *  buf_ptr accordingly if there's no encoding error. If buffer is full, sets
- *  buf_ptr to buf_end.
- */
-__attribute__((format(printf, 3, 4))) static void vsnprintf_wrap(
-    char **buf_ptr, char *buf_end, const char *format, ...) {
-  va_list args;
-  va_start(args, format);
-
-  int res = vsnprintf(*buf_ptr, buf_end - *buf_ptr, format, args);
-
-  va_end(args);
-
-  if (res < 0) {
-    return;
-  }
-
-  *buf_ptr += res;
-
-  if (*buf_ptr >= buf_end) {
-    *buf_ptr = buf_end;
-  }
+static void nmea_output(const sbp2nmea_t *state,
+                        char *sentence,
+                        size_t len,
+                        sbp2nmea_nmea_id_t id) {
+  sbp2nmea_output(state, sentence, len, id);
 }
 
 /* Round the nanosecond part to NMEA_UTC_S_DECIMALS and roll the other fields
@@ -215,75 +150,181 @@ static void round_utc_time(msg_utc_time_t *utc_time) {
   }
 }
 
-/** Generate UTC date time string. Time field is before date field.
+/* Write value as width digits from p, zero padded */
+static void put_digits(char *p, u32 value, u8 width) {
+  for (u8 i = width; i > 0; i--) {
+    p[i - 1] = (char)('0' + value % 10);
+    value /= 10;
+  }
+}
+
+/* True if the fields of utc_time other than the year have at most two
+ * digits, i.e. are at the same place in the strings whatever their value */
+static bool utc_fields_fixed(const msg_utc_time_t *utc_time) {
+  return utc_time->hours < 100 && utc_time->minutes < 100 &&
+         utc_time->seconds < 100 && utc_time->day < 100 &&
+         utc_time->month < 100;
+}
+
+/* Format the fields from scratch */
+static void utc_fields_fmt(sbp2nmea_utc_fields_t *fields) {
+  const msg_utc_time_t *utc_time = &fields->rounded;
+  nmea_fmt_t fmt;
+
+  /* "%02u%02u%02u.%0*u" */
+  nmea_fmt_init(&fmt, fields->time, sizeof(fields->time) - 1);
+  nmea_fmt_uint(&fmt, utc_time->hours, 2);
+  nmea_fmt_uint(&fmt, utc_time->minutes, 2);
+  nmea_fmt_uint(&fmt, utc_time->seconds, 2);
+  nmea_fmt_char(&fmt, '.');
+  nmea_fmt_uint(&fmt, utc_time->ns, NMEA_UTC_S_DECIMALS);
+  *fmt.p = '\0';
+
+  /* "%02u%02u%02u" */
+  nmea_fmt_init(&fmt, fields->date, sizeof(fields->date) - 1);
+  nmea_fmt_uint(&fmt, utc_time->day, 2);
+  nmea_fmt_uint(&fmt, utc_time->month, 2);
+  nmea_fmt_uint(&fmt, utc_time->year % 100, 2);
+  *fmt.p = '\0';
+
+  /* "%02u,%02u,%u" */
+  nmea_fmt_init(&fmt, fields->date_long, sizeof(fields->date_long) - 1);
+  nmea_fmt_uint(&fmt, utc_time->day, 2);
+  nmea_fmt_char(&fmt, ',');
+  nmea_fmt_uint(&fmt, utc_time->month, 2);
+  nmea_fmt_char(&fmt, ',');
+  nmea_fmt_uint(&fmt, utc_time->year, 0);
+  *fmt.p = '\0';
+}
+
+/** Update the UTC time and date fields for a new UTC time. Only the digits
+ * of the values that differ from the previous time are written, which for
+ * consecutive epochs is usually just the fraction of the second.
+ *
+ * \param[inout] fields Fields of the previous time to update.
+ * \param[in] sbp_utc_time Time and date to create the fields from.
+ */
+void nmea_utc_fields_update(sbp2nmea_utc_fields_t *fields,
+                            const msg_utc_time_t *sbp_utc_time) {
+  msg_utc_time_t *prev = &fields->rounded;
+  msg_utc_time_t rounded = *sbp_utc_time;
+  if (0 == rounded.flags) {
+    prev->flags = 0;
+    return;
+  }
+  round_utc_time(&rounded);
+
+  /* after empty fields the strings hold nothing, and a year change may
+   * change the length of the date */
+  if (0 == prev->flags || rounded.year != prev->year ||
+      !utc_fields_fixed(prev) || !utc_fields_fixed(&rounded)) {
+    *prev = rounded;
+    utc_fields_fmt(fields);
+    return;
+  }
+
+  if (rounded.hours != prev->hours) {
+    put_digits(&fields->time[0], rounded.hours, 2);
+  }
+  if (rounded.minutes != prev->minutes) {
+    put_digits(&fields->time[2], rounded.minutes, 2);
+  }
+  if (rounded.seconds != prev->seconds) {
+    put_digits(&fields->time[4], rounded.seconds, 2);
+  }
+  if (rounded.ns != prev->ns) {
+    put_digits(&fields->time[7], rounded.ns, NMEA_UTC_S_DECIMALS);
+  }
+  if (rounded.day != prev->day) {
+    put_digits(&fields->date[0], rounded.day, 2);
+    put_digits(&fields->date_long[0], rounded.day, 2);
+  }
+  if (rounded.month != prev->month) {
+    put_digits(&fields->date[2], rounded.month, 2);
+    put_digits(&fields->date_long[3], rounded.month, 2);
+  }
+  *prev = rounded;
+}
+
+/** Append the UTC date time fields. Time field is before date field.
  *
- * \param[in] sbp_msg_time Time and date to create the str from.
+ * \param[in] fmt Formatter to append to.
  * \param[in] time Time field is to be added.
  * \param[in] date Date field is to be added.
  * \param[in] trunc_date Truncate date field. No effect if param date is false.
- * \param[in] t UTC time structure
- * \param[out] utc_str Created date time string.
- * \param[in] size utc_str size.
+ * \param[in] fields Time and date fields from nmea_utc_fields_update().
  *
  */
-void get_utc_time_string(bool time,
+static void nmea_fmt_utc(nmea_fmt_t *fmt,
+                         bool time,
                          bool date,
                          bool trunc_date,
-                         const msg_utc_time_t *sbp_utc_time,
-                         char *utc_str,
-                         u8 size) {
-  char *buf_end = utc_str + size;
-
-  if (sbp_utc_time->flags == 0) {
+                         const sbp2nmea_utc_fields_t *fields) {
+  if (fields->rounded.flags == 0) {
     /* print empty fields */
     if (time) {
-      vsnprintf_wrap(&utc_str, buf_end, ",");
+      nmea_fmt_char(fmt, ',');
     }
     if (date) {
-      if (trunc_date) {
-        vsnprintf_wrap(&utc_str, buf_end, ",");
-      } else {
-        vsnprintf_wrap(&utc_str, buf_end, ",,,");
-      }
+      nmea_fmt_str(fmt, trunc_date ? "," : ",,,");
     }
     return;
   }
 
-  msg_utc_time_t rounded_utc_time = *sbp_utc_time;
-  round_utc_time(&rounded_utc_time);
-
   if (time) {
-    /* Time (UTC) */
-    vsnprintf_wrap(&utc_str,
-                   buf_end,
-                   "%02u%02u%02u.%0*u,",
-                   rounded_utc_time.hours,
-                   rounded_utc_time.minutes,
-                   rounded_utc_time.seconds,
-                   NMEA_UTC_S_DECIMALS,
-                   rounded_utc_time.ns);
+    nmea_fmt_str(fmt, fields->time);
+    nmea_fmt_char(fmt, ',');
   }
 
   if (date) {
     /* Date Stamp */
-    if (trunc_date) {
-      vsnprintf_wrap(&utc_str,
-                     buf_end,
-                     "%02u%02u%02u,",
-                     rounded_utc_time.day,
-                     rounded_utc_time.month,
-                     (u8)(rounded_utc_time.year % 100));
-    } else {
-      vsnprintf_wrap(&utc_str,
-                     buf_end,
-                     "%02u,%02u,%" PRIu16 ",",
-                     rounded_utc_time.day,
-                     rounded_utc_time.month,
-                     rounded_utc_time.year);
-    }
+    nmea_fmt_str(fmt, trunc_date ? fields->date : fields->date_long);
+    nmea_fmt_char(fmt, ',');
   }
 }
 
+/** Generate UTC date time string. Time field is before date field.
+ *
+ * \param[in] time Time field is to be added.
+ * \param[in] date Date field is to be added.
+ * \param[in] trunc_date Truncate date field. No effect if param date is false.
+ * \param[in] sbp_utc_time Time and date to create the str from.
+ * \param[out] utc_str Created date time string.
+ * \param[in] size utc_str size.
+ *
+ */
+void get_utc_time_string(bool time,
+                         bool date,
+                         bool trunc_date,
+                         const msg_utc_time_t *sbp_utc_time,
+                         char *utc_str,
+                         u8 size) {
+  if (0 == size) {
+    return;
+  }
+  sbp2nmea_utc_fields_t fields;
+  memset(&fields, 0, sizeof(fields));
+  nmea_utc_fields_update(&fields, sbp_utc_time);
+
+  nmea_fmt_t fmt;
+  nmea_fmt_init(&fmt, utc_str, size - 1);
+  nmea_fmt_utc(&fmt, time, date, trunc_date, &fields);
+  *fmt.p = '\0';
+}
+
+/** Append the latitude and longitude fields "DDMM.MMMMMMM,N,DDDMM.MMMMMMM,E,"
+ *
+ * \param[in] fmt Formatter to append to.
+ * \param[in] sbp_pos_llh Position to append.
+ */
+static void nmea_fmt_lat_lon(nmea_fmt_t *fmt,
+                             const msg_pos_llh_t *sbp_pos_llh) {
+  nmea_fmt_deg_min(fmt, sbp_pos_llh->lat, 2);
+  nmea_fmt_str(fmt, sbp_pos_llh->lat < 0.0 ? ",S," : ",N,");
+  nmea_fmt_deg_min(fmt, sbp_pos_llh->lon, 3);
+  nmea_fmt_str(fmt, sbp_pos_llh->lon < 0.0 ? ",W," : ",E,");
+}
+
 /* General note: the NMEA functions below mask the time source, position and
    velocity modes to ensure prevention of accidental bugs in the future.
 
@@ -300,85 +341,54 @@ void get_utc_time_string(bool time,
  * \param state Current SBP2NMEA state
  */
 void send_gpgga(const sbp2nmea_t *state) {
-  /* GGA sentence is formed by splitting latitude and longitude
-     into degrees and minutes parts and then printing them separately
-     using printf. Before doing the split we want to take care of
-     the proper rounding. Doing it after the split would lead to the need
-     of handling the case of minutes part overflow separately. Otherwise,
-     printf would do the rounding of the minutes part, which could result
-     in printing 60 minutes value.
-     E.g. doing this way lat = 15.9999999996 would be printed as
-     $GPGGA,hhmmss.ss,1600.000000,...
-     and NOT
-     $GPGGA,hhmmss.ss,1560.000000,...
-   */
   const msg_pos_llh_t *sbp_pos_llh =
       sbp2nmea_msg_get(state, SBP2NMEA_SBP_POS_LLH);
-  const msg_utc_time_t *sbp_utc_time =
-      sbp2nmea_msg_get(state, SBP2NMEA_SBP_UTC_TIME);
+  const sbp2nmea_utc_fields_t *utc_fields = &state->utc_fields;
   const msg_age_corrections_t *sbp_age =
       sbp2nmea_msg_get(state, SBP2NMEA_SBP_AGE_CORR);
   const msg_dops_t *sbp_dops = sbp2nmea_msg_get(state, SBP2NMEA_SBP_DOPS);
 
-  double lat = fabs(round(sbp_pos_llh->lat * 1e8) / 1e8);
-  double lon = fabs(round(sbp_pos_llh->lon * 1e8) / 1e8);
-
-  char lat_dir = sbp_pos_llh->lat < 0.0 ? 'S' : 'N';
-  assert(lat <= UINT16_MAX);
-  u16 lat_deg = (u16)lat; /* truncation towards zero */
-  double lat_min = (lat - (double)lat_deg) * 60.0;
-
-  char lon_dir = sbp_pos_llh->lon < 0.0 ? 'W' : 'E';
-  assert(lon <= UINT16_MAX);
-  u16 lon_deg = (u16)lon; /* truncation towards zero */
-  double lon_min = (lon - (double)lon_deg) * 60.0;
-
   u8 fix_type = NMEA_GGA_QI_INVALID;
   if ((sbp_pos_llh->flags & POSITION_MODE_MASK) != POSITION_MODE_NONE) {
     fix_type = get_nmea_quality_indicator(sbp_pos_llh->flags);
   }
 
   NMEA_SENTENCE_START(120);
-  NMEA_SENTENCE_PRINTF("$GPGGA,");
+  nmea_fmt_str(&sentence, "$GPGGA,");
 
-  char utc[NMEA_TS_MAX_LEN];
-  get_utc_time_string(true, false, false, sbp_utc_time, utc, NMEA_TS_MAX_LEN);
-  NMEA_SENTENCE_PRINTF("%s", utc);
+  nmea_fmt_utc(&sentence, true, false, false, utc_fields);
 
   if (fix_type != NMEA_GGA_QI_INVALID) {
-    NMEA_SENTENCE_PRINTF("%02u%010.7f,%c,%03u%010.7f,%c,",
-                         lat_deg,
-                         lat_min,
-                         lat_dir,
-                         lon_deg,
-                         lon_min,
-                         lon_dir);
+    nmea_fmt_lat_lon(&sentence, sbp_pos_llh);
   } else {
-    NMEA_SENTENCE_PRINTF(",,,,");
+    nmea_fmt_str(&sentence, ",,,,");
   }
-  NMEA_SENTENCE_PRINTF("%01d,", fix_type);
+  nmea_fmt_uint(&sentence, fix_type, 1);
+  nmea_fmt_char(&sentence, ',');
 
   if (fix_type != NMEA_GGA_QI_INVALID) {
-    NMEA_SENTENCE_PRINTF("%02d,%.1f,%.2f,M,0.0,M,",
-                         sbp_pos_llh->n_sats,
-                         round(10 * sbp_dops->hdop * 0.01) / 10,
-                         sbp_pos_llh->height);
+    nmea_fmt_uint(&sentence, sbp_pos_llh->n_sats, 2);
+    nmea_fmt_char(&sentence, ',');
+    nmea_fmt_fixed(&sentence, round(10 * sbp_dops->hdop * 0.01) / 10, 1, 0);
+    nmea_fmt_char(&sentence, ',');
+    nmea_fmt_fixed(&sentence, sbp_pos_llh->height, 2, 0);
+    nmea_fmt_str(&sentence, ",M,0.0,M,");
   } else {
-    NMEA_SENTENCE_PRINTF(",,,M,,M,");
+    nmea_fmt_str(&sentence, ",,,M,,M,");
   }
 
   if ((fix_type == NMEA_GGA_QI_DGPS &&
        ((sbp_pos_llh->flags & POSITION_MODE_MASK) != POSITION_MODE_SBAS)) ||
       (fix_type == NMEA_GGA_QI_FLOAT) || (fix_type == NMEA_GGA_QI_RTK)) {
-    NMEA_SENTENCE_PRINTF(
-        "%.1f,%04d",
-        sbp_age->age * 0.1,
-        sbp2nmea_base_id_get(state) & 0x3FF); /* ID range is 0000 to 1023 */
+    nmea_fmt_fixed(&sentence, sbp_age->age * 0.1, 1, 0);
+    nmea_fmt_char(&sentence, ',');
+    /* ID range is 0000 to 1023 */
+    nmea_fmt_uint(&sentence, sbp2nmea_base_id_get(state) & 0x3FF, 4);
   } else {
-    NMEA_SENTENCE_PRINTF(",");
+    nmea_fmt_char(&sentence, ',');
   }
 
-  NMEA_SENTENCE_DONE(state);
+  NMEA_SENTENCE_DONE(state, SBP2NMEA_NMEA_GGA);
 }
 
 gnss_signal_t sbp_to_gnss(sbp_gnss_signal_t sid) {
@@ -388,8 +398,6 @@ gnss_signal_t sbp_to_gnss(sbp_gnss_signal_t sid) {
   return other;
 }
 
-int gsa_cmp(const void *a, const void *b) { return (*(u16 *)a - *(u16 *)b); }
-
 static u16 nmea_get_id(const sbp_gnss_signal_t sid) {
   u16 id = -1;
 
@@ -460,20 +468,42 @@ static talker_id_t sid_to_talker_id(const sbp_gnss_signal_t sid) {
   }
 }
 
+void nmea_sv_set_add(sbp2nmea_sv_set_t svs[SBP2NMEA_TALKER_CNT],
+                     const sbp_gnss_signal_t sid) {
+  talker_id_t talker = sid_to_talker_id(sid);
+  if (TALKER_ID_INVALID == talker) {
+    /* Unsupported constellation */
+    return;
+  }
+  u16 sv_id = nmea_get_id(sid);
+  if (sv_id >= SBP2NMEA_SV_ID_CNT) {
+    /* PRN out of the range of the constellation */
+    return;
+  }
+  svs[talker].words[sv_id / 64] |= (u64)1 << (sv_id % 64);
+}
+
+static u16 sv_set_count(const sbp2nmea_sv_set_t *svs) {
+  u16 count = 0;
+  for (u8 i = 0; i < SBP2NMEA_SV_SET_WORDS; i++) {
+    count += (u16)__builtin_popcountll(svs->words[i]);
+  }
+  return count;
+}
+
 /** Print a NMEA GSA string and send it out NMEA USARTs.
  * NMEA GSA message contains GNSS DOP and Active Satellites.
  *
- * \param prns         Array of PRNs to output.
- * \param num_prns     Number of valid PRNs in array.
+ * \param svs          Satellites to output, at most GSA_MAX_SV with the
+ *                     lowest ids are listed.
  * \param sbp_dops     Pointer to SBP MSG DOP struct (PDOP, HDOP, VDOP).
  * \param talker       Talker ID to use.
  */
-void send_gsa_print(u16 *prns,
-                    const u8 num_prns,
-                    const msg_dops_t *sbp_dops,
-                    const char *talker,
-                    const sbp2nmea_t *state) {
-  assert(prns);
+static void send_gsa_print(const sbp2nmea_sv_set_t *svs,
+                           const msg_dops_t *sbp_dops,
+                           const char *talker,
+                           const sbp2nmea_t *state) {
+  assert(svs);
   assert(sbp_dops);
 
   bool fix = POSITION_MODE_NONE != (sbp_dops->flags & POSITION_MODE_MASK);
@@ -483,32 +513,41 @@ void send_gsa_print(u16 *prns,
 
   NMEA_SENTENCE_START(120);
   /* Always automatic mode */
-  NMEA_SENTENCE_PRINTF("$%sGSA,A,%c,", talker, fix_mode);
-
-  qsort(prns, num_prns, sizeof(u16), gsa_cmp);
-
-  for (u8 i = 0; i < GSA_MAX_SV; i++) {
-    if (i < num_prns) {
-      NMEA_SENTENCE_PRINTF("%02d,", prns[i]);
-    } else {
-      NMEA_SENTENCE_PRINTF(",");
+  nmea_fmt_char(&sentence, '$');
+  nmea_fmt_str(&sentence, talker);
+  nmea_fmt_str(&sentence, "GSA,A,");
+  nmea_fmt_char(&sentence, fix_mode);
+  nmea_fmt_char(&sentence, ',');
+
+  /* the set bits in ascending order, i.e. the satellites sorted by id */
+  u8 num_prns = 0;
+  for (u8 i = 0; i < SBP2NMEA_SV_SET_WORDS && num_prns < GSA_MAX_SV; i++) {
+    u64 bits = svs->words[i];
+    while (0 != bits && num_prns < GSA_MAX_SV) {
+      nmea_fmt_uint(&sentence, (u32)(i * 64 + __builtin_ctzll(bits)), 2);
+      nmea_fmt_char(&sentence, ',');
+      bits &= bits - 1;
+      num_prns++;
     }
   }
+  for (; num_prns < GSA_MAX_SV; num_prns++) {
+    nmea_fmt_char(&sentence, ',');
+  }
 
   if (fix && (NULL != sbp_dops)) {
-    NMEA_SENTENCE_PRINTF("%.1f,%.1f,%.1f",
-                         round(sbp_dops->pdop * 0.1) / 10,
-                         round(sbp_dops->hdop * 0.1) / 10,
-                         round(sbp_dops->vdop * 0.1) / 10);
+    nmea_fmt_fixed(&sentence, round(sbp_dops->pdop * 0.1) / 10, 1, 0);
+    nmea_fmt_char(&sentence, ',');
+    nmea_fmt_fixed(&sentence, round(sbp_dops->hdop * 0.1) / 10, 1, 0);
+    nmea_fmt_char(&sentence, ',');
+    nmea_fmt_fixed(&sentence, round(sbp_dops->vdop * 0.1) / 10, 1, 0);
   } else {
-    NMEA_SENTENCE_PRINTF(",,");
+    nmea_fmt_str(&sentence, ",,");
   }
 
-  NMEA_SENTENCE_DONE(state);
+  NMEA_SENTENCE_DONE(state, SBP2NMEA_NMEA_GSA);
 }
 
-/** Group measurements by constellation and forward information to GSA
- *  printing function.
+/** Forward the satellites grouped by talker ID to the GSA printing function.
  *
  * \note NMEA 0183 - Standard For Interfacing Marine Electronic Devices
  *       versions 2.30, 3.01 and 4.10 state following:
@@ -522,60 +561,28 @@ void send_gsa_print(u16 *prns,
  *       used in a combined solution and each shall have the PDOP, HDOP and VDOP
  *       for the combined satellites used in the position.
  *
+ * \note The satellites are grouped as the observations arrive, see
+ *       nmea_sv_set_add():
+ *       - GPS, QZSS and SBAS use GP, GLO uses GL, BDS uses GB, GAL uses GA
+ *       - a satellite tracked on several signals (eg. GPS L1CA vs L2C) is
+ *         listed once
+ *
  * \param sbp_nmea_state      Pointer to the converter state
  */
 void send_gsa(const sbp2nmea_t *state) {
   assert(state);
   const msg_dops_t *sbp_dops = sbp2nmea_msg_get(state, SBP2NMEA_SBP_DOPS);
-  const u8 n_obs = sbp2nmea_num_obs_get(state);
-  const sbp_gnss_signal_t *nav_sids = sbp2nmea_nav_sids_get(state);
-
-  u16 prns[TALKER_ID_COUNT][GSA_MAX_SV] = {{0}};
-  u8 num_prns[TALKER_ID_COUNT] = {0};
-
-  /* Assemble list of currently active SVs */
-  for (u8 i = 0; i < n_obs; i++) {
-    const sbp_gnss_signal_t sid = nav_sids[i];
-    talker_id_t id = sid_to_talker_id(sid);
-
-    if (TALKER_ID_INVALID == id) {
-      /* Unsupported constellation */
-      continue;
-    }
-
-    /* Check following:
-     *   - constellation to group by correct talker ID
-     *       * GPS, QZSS and SBAS use GP
-     *       * GLO uses GL
-     *       * BDS uses GB
-     *       * GAL uses GA
-     *   - maximum group size is GSA_MAX_SV
-     *   - if SV is reported already by another signal (eg. GPS L1CA vs L2C)
-     */
-    if (num_prns[id] > GSA_MAX_SV) {
-      /* Talker ID specific sentence already maxed out */
-      continue;
-    }
-
-    if (is_value_in_array_u16(prns[id], num_prns[id], nmea_get_id(sid))) {
-      /* SV already listed by another signal */
-      continue;
-    }
-
-    /* All checks pass, add to list */
-    prns[id][num_prns[id]++] = nmea_get_id(sid);
-  }
+  const sbp2nmea_sv_set_t *svs = sbp2nmea_nav_svs_get(state);
 
   u8 constellations = 0;
   for (u8 i = 0; i < TALKER_ID_COUNT; ++i) {
-    constellations += (0 != num_prns[i]) ? 1 : 0;
+    constellations += (0 != sv_set_count(&svs[i])) ? 1 : 0;
   }
 
   /* Check if no SVs identified */
   if (0 == constellations) {
     /* At bare minimum, print empty GPGSA and be done with it */
-    send_gsa_print(
-        prns[TALKER_ID_GP], num_prns[TALKER_ID_GP], sbp_dops, "GP", state);
+    send_gsa_print(&svs[TALKER_ID_GP], sbp_dops, "GP", state);
     return;
   }
 
@@ -584,16 +591,13 @@ void send_gsa(const sbp2nmea_t *state) {
 
   /* Print active SVs per talker ID */
   for (u8 i = 0; i < TALKER_ID_COUNT; ++i) {
-    if (0 == num_prns[i]) {
+    if (0 == sv_set_count(&svs[i])) {
       /* Empty */
       continue;
     }
 
-    send_gsa_print(prns[i],
-                   num_prns[i],
-                   sbp_dops,
-                   use_gn ? "GN" : talker_id_to_str(i),
-                   state);
+    send_gsa_print(
+        &svs[i], sbp_dops, use_gn ? "GN" : talker_id_to_str(i), state);
   }
 }
 
@@ -643,23 +647,7 @@ void send_gprmc(const sbp2nmea_t *state) {
       sbp2nmea_msg_get(state, SBP2NMEA_SBP_POS_LLH);
   const msg_vel_ned_t *sbp_vel_ned =
       sbp2nmea_msg_get(state, SBP2NMEA_SBP_VEL_NED);
-  const msg_utc_time_t *sbp_utc_time =
-      sbp2nmea_msg_get(state, SBP2NMEA_SBP_UTC_TIME);
-  /* See the relevant comment for the similar code in nmea_gpgga() function
-     for the reasoning behind (... * 1e8 / 1e8) trick */
-  double lat = fabs(round(sbp_pos_llh->lat * 1e8) / 1e8);
-  double lon = fabs(round(sbp_pos_llh->lon * 1e8) / 1e8);
-
-  char lat_dir = sbp_pos_llh->lat < 0.0 ? 'S' : 'N';
-  assert(lat <= UINT16_MAX);
-  u16 lat_deg = (u16)lat; /* truncation towards zero */
-  double lat_min = (lat - (double)lat_deg) * 60.0;
-
-  char lon_dir = sbp_pos_llh->lon < 0.0 ? 'W' : 'E';
-  assert(lon <= UINT16_MAX);
-  u16 lon_deg = (u16)lon; /* truncation towards zero */
-  double lon_min = (lon - (double)lon_deg) * 60.0;
-
+  const sbp2nmea_utc_fields_t *utc_fields = &state->utc_fields;
   char mode = get_nmea_mode_indicator(sbp_pos_llh->flags);
   char status = get_nmea_status(sbp_pos_llh->flags);
 
@@ -667,47 +655,35 @@ void send_gprmc(const sbp2nmea_t *state) {
   calc_cog_sog(sbp_vel_ned, &cog, &sog_knots, &sog_kph);
 
   NMEA_SENTENCE_START(140);
-  NMEA_SENTENCE_PRINTF("$GPRMC,"); /* Command */
+  nmea_fmt_str(&sentence, "$GPRMC,"); /* Command */
 
-  char utc[NMEA_TS_MAX_LEN];
-  get_utc_time_string(true, false, false, sbp_utc_time, utc, NMEA_TS_MAX_LEN);
-  NMEA_SENTENCE_PRINTF("%s", utc);
+  nmea_fmt_utc(&sentence, true, false, false, utc_fields);
 
-  NMEA_SENTENCE_PRINTF("%c,", /* Status */
-                       status);
+  nmea_fmt_char(&sentence, status); /* Status */
+  nmea_fmt_char(&sentence, ',');
 
   if ((sbp_pos_llh->flags & POSITION_MODE_MASK) != POSITION_MODE_NONE) {
-    NMEA_SENTENCE_PRINTF("%02u%010.7f,%c,%03u%010.7f,%c,", /* Lat/Lon */
-                         lat_deg,
-                         lat_min,
-                         lat_dir,
-                         lon_deg,
-                         lon_min,
-                         lon_dir);
+    nmea_fmt_lat_lon(&sentence, sbp_pos_llh); /* Lat/Lon */
   } else {
-    NMEA_SENTENCE_PRINTF(",,,,"); /* Lat/Lon */
+    nmea_fmt_str(&sentence, ",,,,"); /* Lat/Lon */
   }
 
   if ((sbp_pos_llh->flags & VELOCITY_MODE_MASK) != VELOCITY_MODE_NONE) {
-    NMEA_SENTENCE_PRINTF("%.2f,", sog_knots); /* Speed */
+    nmea_fmt_fixed(&sentence, sog_knots, 2, 0); /* Speed */
+    nmea_fmt_char(&sentence, ',');
     if (NMEA_COG_STATIC_LIMIT_KNOTS < sog_knots) {
-      NMEA_SENTENCE_PRINTF("%.*f,", NMEA_COG_DECIMALS, cog); /* Course */
-    } else {
-      NMEA_SENTENCE_PRINTF(","); /* Course */
+      nmea_fmt_fixed(&sentence, cog, NMEA_COG_DECIMALS, 0); /* Course */
     }
+    nmea_fmt_char(&sentence, ',');
   } else {
-    NMEA_SENTENCE_PRINTF(",,"); /* Speed, Course */
+    nmea_fmt_str(&sentence, ",,"); /* Speed, Course */
   }
 
-  char date[NMEA_TS_MAX_LEN];
-  get_utc_time_string(false, true, true, sbp_utc_time, date, NMEA_TS_MAX_LEN);
-  NMEA_SENTENCE_PRINTF("%s", date);
+  nmea_fmt_utc(&sentence, false, true, true, utc_fields);
 
-  NMEA_SENTENCE_PRINTF(
-      ",,"  /* Magnetic Variation */
-      "%c", /* Mode Indicator */
-      mode);
-  NMEA_SENTENCE_DONE(state);
+  nmea_fmt_str(&sentence, ",,");  /* Magnetic Variation */
+  nmea_fmt_char(&sentence, mode); /* Mode Indicator */
+  NMEA_SENTENCE_DONE(state, SBP2NMEA_NMEA_RMC);
 }
 
 /** Assemble an NMEA GPVTG message and send it out NMEA USARTs.
@@ -732,30 +708,32 @@ void send_gpvtg(const sbp2nmea_t *state) {
   char mode = get_nmea_mode_indicator(sbp_pos_llh->flags);
 
   NMEA_SENTENCE_START(120);
-  NMEA_SENTENCE_PRINTF("$GPVTG,"); /* Command */
+  nmea_fmt_str(&sentence, "$GPVTG,"); /* Command */
 
   bool is_moving =
       (sbp_pos_llh->flags & VELOCITY_MODE_MASK) != VELOCITY_MODE_NONE;
 
   if (is_moving && NMEA_COG_STATIC_LIMIT_KNOTS < sog_knots) {
-    NMEA_SENTENCE_PRINTF("%.*f,T,", NMEA_COG_DECIMALS, cog); /* Course */
-  } else {
-    NMEA_SENTENCE_PRINTF(",T,"); /* Course */
+    nmea_fmt_fixed(&sentence, cog, NMEA_COG_DECIMALS, 0); /* Course */
   }
+  nmea_fmt_str(&sentence, ",T,");
 
-  NMEA_SENTENCE_PRINTF(",M,"); /* Magnetic Course (omitted) */
+  nmea_fmt_str(&sentence, ",M,"); /* Magnetic Course (omitted) */
 
   if (is_moving) {
     /* Speed (knots, km/hr) */
-    NMEA_SENTENCE_PRINTF("%.2f,N,%.2f,K,", sog_knots, sog_kph);
+    nmea_fmt_fixed(&sentence, sog_knots, 2, 0);
+    nmea_fmt_str(&sentence, ",N,");
+    nmea_fmt_fixed(&sentence, sog_kph, 2, 0);
+    nmea_fmt_str(&sentence, ",K,");
   } else {
     /* Speed (knots, km/hr) */
-    NMEA_SENTENCE_PRINTF(",N,,K,");
+    nmea_fmt_str(&sentence, ",N,,K,");
   }
 
   /* Mode (note this is position mode not velocity mode)*/
-  NMEA_SENTENCE_PRINTF("%c", mode);
-  NMEA_SENTENCE_DONE(state);
+  nmea_fmt_char(&sentence, mode);
+  NMEA_SENTENCE_DONE(state, SBP2NMEA_NMEA_VTG);
 }
 
 /** Assemble an NMEA GPHDT message and send it out NMEA USARTs.
@@ -766,17 +744,18 @@ void send_gphdt(const sbp2nmea_t *state) {
   const msg_baseline_heading_t *sbp_baseline_heading =
       sbp2nmea_msg_get(state, SBP2NMEA_SBP_HDG);
   NMEA_SENTENCE_START(40);
-  NMEA_SENTENCE_PRINTF("$GPHDT,"); /* Command */
+  nmea_fmt_str(&sentence, "$GPHDT,"); /* Command */
   if ((POSITION_MODE_MASK & sbp_baseline_heading->flags) ==
       POSITION_MODE_FIXED) {
-    NMEA_SENTENCE_PRINTF(
-        "%.1f,T",
-        (float)sbp_baseline_heading->heading /
-            MSG_HEADING_SCALE_FACTOR); /* Heading only valid when fixed */
-  } else {
-    NMEA_SENTENCE_PRINTF(",T"); /* Heading only valid when fixed */
-  }
-  NMEA_SENTENCE_DONE(state);
+    /* Heading only valid when fixed */
+    nmea_fmt_fixed(
+        &sentence,
+        (float)sbp_baseline_heading->heading / MSG_HEADING_SCALE_FACTOR,
+        1,
+        0);
+  }
+  nmea_fmt_str(&sentence, ",T");
+  NMEA_SENTENCE_DONE(state, SBP2NMEA_NMEA_HDT);
 }
 
 /** Assemble an NMEA GPGLL message and send it out NMEA USARTs.
@@ -789,49 +768,25 @@ void send_gphdt(const sbp2nmea_t *state) {
 void send_gpgll(const sbp2nmea_t *state) {
   const msg_pos_llh_t *sbp_pos_llh =
       sbp2nmea_msg_get(state, SBP2NMEA_SBP_POS_LLH);
-  const msg_utc_time_t *sbp_utc_time =
-      sbp2nmea_msg_get(state, SBP2NMEA_SBP_UTC_TIME);
-  /* See the relevant comment for the similar code in nmea_gpgga() function
-     for the reasoning behind (... * 1e8 / 1e8) trick */
-  double lat = fabs(round(sbp_pos_llh->lat * 1e8) / 1e8);
-  double lon = fabs(round(sbp_pos_llh->lon * 1e8) / 1e8);
-
-  char lat_dir = sbp_pos_llh->lat < 0.0 ? 'S' : 'N';
-  assert(lat <= UINT16_MAX);
-  u16 lat_deg = (u16)lat; /* truncation towards zero */
-  double lat_min = (lat - (double)lat_deg) * 60.0;
-
-  char lon_dir = sbp_pos_llh->lon < 0.0 ? 'W' : 'E';
-  assert(lon <= UINT16_MAX);
-  u16 lon_deg = (u16)lon; /* truncation towards zero */
-  double lon_min = (lon - (double)lon_deg) * 60.0;
-
+  const sbp2nmea_utc_fields_t *utc_fields = &state->utc_fields;
   char status = get_nmea_status(sbp_pos_llh->flags);
   char mode = get_nmea_mode_indicator(sbp_pos_llh->flags);
 
   NMEA_SENTENCE_START(120);
-  NMEA_SENTENCE_PRINTF("$GPGLL,"); /* Command */
+  nmea_fmt_str(&sentence, "$GPGLL,"); /* Command */
 
   if ((sbp_pos_llh->flags & POSITION_MODE_MASK) != POSITION_MODE_NONE) {
-    NMEA_SENTENCE_PRINTF("%02u%010.7f,%c,%03u%010.7f,%c,", /* Lat/Lon */
-                         lat_deg,
-                         lat_min,
-                         lat_dir,
-                         lon_deg,
-                         lon_min,
-                         lon_dir);
+    nmea_fmt_lat_lon(&sentence, sbp_pos_llh); /* Lat/Lon */
   } else {
-    NMEA_SENTENCE_PRINTF(",,,,"); /* Lat/Lon */
+    nmea_fmt_str(&sentence, ",,,,"); /* Lat/Lon */
   }
 
-  char utc[NMEA_TS_MAX_LEN];
-  get_utc_time_string(true, false, false, sbp_utc_time, utc, NMEA_TS_MAX_LEN);
-  NMEA_SENTENCE_PRINTF("%s", utc);
+  nmea_fmt_utc(&sentence, true, false, false, utc_fields);
 
-  NMEA_SENTENCE_PRINTF("%c,%c", /* Status, Mode */
-                       status,
-                       mode);
-  NMEA_SENTENCE_DONE(state);
+  nmea_fmt_char(&sentence, status); /* Status */
+  nmea_fmt_char(&sentence, ',');
+  nmea_fmt_char(&sentence, mode); /* Mode */
+  NMEA_SENTENCE_DONE(state, SBP2NMEA_NMEA_GLL);
 }
 
 /** Assemble an NMEA GPZDA message and send it out NMEA USARTs.
@@ -840,18 +795,15 @@ void send_gpgll(const sbp2nmea_t *state) {
  * \param sbp_utc_time Pointer to sbp UTC time
  */
 void send_gpzda(const sbp2nmea_t *state) {
-  const msg_utc_time_t *sbp_utc_time =
-      sbp2nmea_msg_get(state, SBP2NMEA_SBP_UTC_TIME);
+  const sbp2nmea_utc_fields_t *utc_fields = &state->utc_fields;
 
   NMEA_SENTENCE_START(40);
-  NMEA_SENTENCE_PRINTF("$GPZDA,"); /* Command */
+  nmea_fmt_str(&sentence, "$GPZDA,"); /* Command */
 
-  char utc[NMEA_TS_MAX_LEN];
-  get_utc_time_string(true, true, false, sbp_utc_time, utc, NMEA_TS_MAX_LEN);
-  NMEA_SENTENCE_PRINTF("%s", utc);
+  nmea_fmt_utc(&sentence, true, true, false, utc_fields);
 
-  NMEA_SENTENCE_PRINTF(","); /* Time zone */
-  NMEA_SENTENCE_DONE(state);
+  nmea_fmt_char(&sentence, ','); /* Time zone */
+  NMEA_SENTENCE_DONE(state, SBP2NMEA_NMEA_ZDA);
 
 } /* send_gpzda() */
 
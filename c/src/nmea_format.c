@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "nmea_format.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Scaled values up to 2^52 have a fraction part that can be split off
+ * exactly, larger ones (and NaN or infinity) go through snprintf */
+#define FIXED_EXACT_LIMIT 4503599627370496.0
+
+/* Enough for "%f" of any double */
+#define FIXED_FALLBACK_LEN 400
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static const u32 pow10_u32[NMEA_FMT_MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+void nmea_fmt_init(nmea_fmt_t *fmt, char *buf, size_t size) {
+  fmt->buf = buf;
+  fmt->p = buf;
+  fmt->end = buf + size;
+  fmt->checksum = 0;
+}
+
+size_t nmea_fmt_len(const nmea_fmt_t *fmt) {
+  return (size_t)(fmt->p - fmt->buf);
+}
+
+void nmea_fmt_char(nmea_fmt_t *fmt, char c) {
+  if (fmt->p < fmt->end) {
+    *fmt->p++ = c;
+    fmt->checksum ^= (u8)c;
+  }
+}
+
+void nmea_fmt_str(nmea_fmt_t *fmt, const char *str) {
+  while ('\0' != *str) {
+    nmea_fmt_char(fmt, *str++);
+  }
+}
+
+void nmea_fmt_uint(nmea_fmt_t *fmt, u32 value, u8 width) {
+  char digits[10];
+  u8 n_digits = 0;
+  do {
+    digits[n_digits++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  for (u8 i = n_digits; i < width; i++) {
+    nmea_fmt_char(fmt, '0');
+  }
+  while (n_digits > 0) {
+    nmea_fmt_char(fmt, digits[--n_digits]);
+  }
+}
+
+/* Round abs_value * scale to an integer the way printf does, i.e. from the
+ * exact value of the product with ties to even. fma() gives the rounding
+ * error of the double product exactly, which decides on which side of the
+ * half way point the exact product lies when the rounded one is close to it.
+ */
+static u64 round_scaled(double abs_value, double scale) {
+  double product = abs_value * scale;
+  double error = fma(abs_value, scale, -product);
+  double integer = floor(product);
+  /* exact, and at least an ulp of product away from 0 unless it is 0 */
+  double from_half = (product - integer) - 0.5;
+
+  u64 n = (u64)integer;
+  if (from_half > 0 ||
+      (0 == from_half && (error > 0 || (0 == error && 1 == (n & 1))))) {
+    n++;
+  }
+  return n;
+}
+
+void nmea_fmt_fixed(nmea_fmt_t *fmt, double value, u8 decimals, u8 width) {
+  assert(decimals <= NMEA_FMT_MAX_DECIMALS);
+  double scale = pow10_u32[decimals];
+  double abs_value = fabs(value);
+
+  if (!(abs_value * scale < FIXED_EXACT_LIMIT)) {
+    char fallback[FIXED_FALLBACK_LEN];
+    snprintf(fallback, sizeof(fallback), "%0*.*f", width, decimals, value);
+    nmea_fmt_str(fmt, fallback);
+    return;
+  }
+
+  /* the decimals and then the integer digits, least significant first */
+  u64 n = round_scaled(abs_value, scale);
+  char digits[NMEA_FMT_MAX_DECIMALS + 16];
+  u8 n_digits = 0;
+  for (u8 i = 0; i < decimals; i++) {
+    digits[n_digits++] = (char)('0' + n % 10);
+    n /= 10;
+  }
+  do {
+    digits[n_digits++] = (char)('0' + n % 10);
+    n /= 10;
+  } while (n > 0);
+
+  /* printf keeps the sign of negative values rounding to zero */
+  bool negative = (0 != signbit(value));
+  u8 len = n_digits + (decimals > 0 ? 1 : 0) + (negative ? 1 : 0);
+  if (negative) {
+    nmea_fmt_char(fmt, '-');
+  }
+  for (u8 i = len; i < width; i++) {
+    nmea_fmt_char(fmt, '0');
+  }
+  for (u8 i = n_digits; i > 0; i--) {
+    if (i == decimals) {
+      nmea_fmt_char(fmt, '.');
+    }
+    nmea_fmt_char(fmt, digits[i - 1]);
+  }
+}
+
+size_t nmea_fmt_finish(nmea_fmt_t *fmt) {
+  u8 checksum = fmt->checksum;
+  /* '$' header not included in checksum calculation */
+  if (fmt->p > fmt->buf && '$' == fmt->buf[0]) {
+    checksum ^= (u8)'$';
+  }
+
+  char *p = fmt->p;
+  *p++ = '*';
+  *p++ = hex_digits[checksum >> 4];
+  *p++ = hex_digits[checksum & 0xF];
+  *p++ = '\r';
+  *p++ = '\n';
+  *p = '\0';
+  return (size_t)(p - fmt->buf);
+}
+
+void nmea_fmt_deg_min(nmea_fmt_t *fmt, double deg, u8 deg_width) {
+  /* Rounding before the split, as rounding the minutes could otherwise give
+   * 60 minutes. E.g. 15.9999999996 is printed as 1600.0000000 and not as
+   * 1560.0000000 */
+  double abs_deg = fabs(round(deg * 1e8) / 1e8);
+  assert(abs_deg <= UINT16_MAX);
+  u16 whole_deg = (u16)abs_deg; /* truncation towards zero */
+  double min = (abs_deg - (double)whole_deg) * 60.0;
+
+  nmea_fmt_uint(fmt, whole_deg, deg_width);
+  nmea_fmt_fixed(fmt, min, 7, 10);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Append-only formatter for the NMEA sentences. The number formats produce
+ * exactly the same characters as the printf conversions named in the
+ * comments, without going through printf. Output beyond the end of the
+ * buffer is dropped. The checksum is accumulated as the characters are
+ * appended, so the sentence is never scanned again. */
+
+#ifndef GNSS_CONVERTERS_NMEA_FORMAT_H
+#define GNSS_CONVERTERS_NMEA_FORMAT_H
+
+#include <stddef.h>
+
+#include <swiftnav/common.h>
+
+/* Largest number of decimals of nmea_fmt_fixed() */
+#define NMEA_FMT_MAX_DECIMALS 9
+
+/* Room nmea_fmt_finish() needs after the end of the buffer, "*%02X\r\n\0" */
+#define NMEA_FMT_SUFFIX_LEN 6
+
+typedef struct {
+  char *buf;
+  char *p;
+  char *end;
+  /* XOR of the characters written so far */
+  u8 checksum;
+} nmea_fmt_t;
+
+/* Start formatting into buf, which has room for size characters */
+void nmea_fmt_init(nmea_fmt_t *fmt, char *buf, size_t size);
+
+/* Number of characters written so far */
+size_t nmea_fmt_len(const nmea_fmt_t *fmt);
+
+void nmea_fmt_char(nmea_fmt_t *fmt, char c);
+
+void nmea_fmt_str(nmea_fmt_t *fmt, const char *str);
+
+/* "%0<width>u", width 0 for no padding */
+void nmea_fmt_uint(nmea_fmt_t *fmt, u32 value, u8 width);
+
+/* "%0<width>.<decimals>f" */
+void nmea_fmt_fixed(nmea_fmt_t *fmt, double value, u8 decimals, u8 width);
+
+/* Append the checksum of everything but a leading '$', CR LF and a NUL.
+ * These go past the end of the buffer given to nmea_fmt_init(), which must
+ * be followed by NMEA_FMT_SUFFIX_LEN more characters. Returns the length of
+ * the sentence, not counting the NUL. */
+size_t nmea_fmt_finish(nmea_fmt_t *fmt);
+
+/* Absolute value of an angle in degrees as degrees and minutes,
+ * "%0<deg_width>u%010.7f" rounded to 1e-8 degrees before the split so that
+ * the minutes never read 60 */
+void nmea_fmt_deg_min(nmea_fmt_t *fmt, double deg, u8 deg_width);
+
+#endif /* GNSS_CONVERTERS_NMEA_FORMAT_H */
@@ -0,0 +1,560 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "gnss-converters/nmea_sbp.h"
+#include "sbp_nmea_internal.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <libsbp/navigation.h>
+#include <swiftnav/constants.h>
+#include <swiftnav/gnss_time.h>
+#include <swiftnav/pvt_result.h>
+
+/* values of state->framing */
+#define FRAMING_IDLE 0
+#define FRAMING_BODY 1
+#define FRAMING_CHECKSUM_HI 2
+#define FRAMING_CHECKSUM_LO 3
+
+#define DAY_MS (DAY_HOURS * HOUR_MINUTES * MINUTE_SECS * SECS_MS)
+#define WEEK_MS (WEEK_SECS * SECS_MS)
+#define TOD_INVALID 0xFFFFFFFF
+
+/* 1980-01-06 in days since 1970-01-01 */
+#define GPS_EPOCH_DAYS 3657
+
+/* inverse of MS2KNOTS() and MS2KMHR() */
+#define KNOTS2MS(x) ((x) / 1.94385)
+#define KMHR2MS(x) ((x) / (3600.0 / 1000.0))
+
+/* MSG_VEL_NED flags, velocity from measured Doppler */
+#define VELOCITY_MODE_MEASURED_DOPPLER 1
+/* MSG_UTC_TIME flags, time from the GNSS solution */
+#define TIME_SOURCE_GNSS 1
+
+/* Most digits parse_fixed() takes, so that they fit in a u64 */
+#define FIXED_MAX_DIGITS 18
+
+static const double pow10_f64[FIXED_MAX_DIGITS + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+typedef struct {
+  const char *begin;
+  const char *end;
+} nmea_field_t;
+
+typedef struct {
+  u8 hours;
+  u8 minutes;
+  u8 seconds;
+  u32 ns;
+} nmea_time_t;
+
+typedef struct {
+  u16 year;
+  u8 month;
+  u8 day;
+} nmea_date_t;
+
+/* Field i of the current sentence, empty if the sentence has fewer */
+static nmea_field_t get_field(const nmea2sbp_t *state, u8 i) {
+  nmea_field_t field = {state->sentence, state->sentence};
+  if (i < state->n_fields) {
+    field.begin = &state->sentence[state->field[i]];
+    field.end = (i + 1 < state->n_fields)
+                    ? &state->sentence[state->field[i + 1] - 1]
+                    : &state->sentence[state->len];
+  }
+  return field;
+}
+
+static bool field_empty(nmea_field_t field) {
+  return field.begin == field.end;
+}
+
+/* The single character of a field, '\0' if it is empty or longer */
+static char field_char(nmea_field_t field) {
+  return (field.end - field.begin == 1) ? *field.begin : '\0';
+}
+
+static bool parse_digits(const char *s, u8 n_digits, u32 *value) {
+  u32 v = 0;
+  for (u8 i = 0; i < n_digits; i++) {
+    u8 digit = (u8)(s[i] - '0');
+    if (digit > 9) {
+      return false;
+    }
+    v = v * 10 + digit;
+  }
+  *value = v;
+  return true;
+}
+
+static bool parse_uint(nmea_field_t field, u32 *value) {
+  ptrdiff_t n_digits = field.end - field.begin;
+  if (n_digits < 1 || n_digits > 9) {
+    return false;
+  }
+  return parse_digits(field.begin, (u8)n_digits, value);
+}
+
+/* Parse "[-]digits[.digits]" without going through strtod(). The digits are
+ * collected in an integer and divided by a power of ten once, which is the
+ * correctly rounded value, the same as strtod() gives, for up to 15
+ * significant digits. */
+static bool parse_fixed(nmea_field_t field, double *value) {
+  const char *s = field.begin;
+  bool negative = (s < field.end && '-' == *s);
+  if (negative) {
+    s++;
+  }
+
+  u64 mantissa = 0;
+  u8 n_digits = 0;
+  u8 decimals = 0;
+  bool point = false;
+  for (; s < field.end; s++) {
+    if ('.' == *s && !point) {
+      point = true;
+      continue;
+    }
+    u8 digit = (u8)(*s - '0');
+    if (digit > 9 || n_digits >= FIXED_MAX_DIGITS) {
+      return false;
+    }
+    mantissa = mantissa * 10 + digit;
+    n_digits++;
+    decimals += point ? 1 : 0;
+  }
+  if (0 == n_digits) {
+    return false;
+  }
+
+  double v = (double)mantissa / pow10_f64[decimals];
+  *value = negative ? -v : v;
+  return true;
+}
+
+/* "hhmmss" with an optional fraction of up to 9 digits */
+static bool parse_time(nmea_field_t field, nmea_time_t *time) {
+  ptrdiff_t len = field.end - field.begin;
+  u32 hhmmss;
+  if (len < 6 || !parse_digits(field.begin, 6, &hhmmss)) {
+    return false;
+  }
+  time->hours = (u8)(hhmmss / 10000);
+  time->minutes = (u8)(hhmmss / 100 % 100);
+  time->seconds = (u8)(hhmmss % 100);
+  /* up to 60 seconds for a leap second */
+  if (time->hours >= DAY_HOURS || time->minutes >= HOUR_MINUTES ||
+      time->seconds > MINUTE_SECS) {
+    return false;
+  }
+
+  time->ns = 0;
+  if (len > 6) {
+    ptrdiff_t n_decimals = len - 7;
+    u32 fraction;
+    if ('.' != field.begin[6] || n_decimals > 9 ||
+        !parse_digits(field.begin + 7, (u8)n_decimals, &fraction)) {
+      return false;
+    }
+    time->ns = fraction * (u32)pow10_f64[9 - n_decimals];
+  }
+  return true;
+}
+
+/* "ddmmyy", the years 80 to 99 are 1980 to 1999 */
+static bool parse_date(nmea_field_t field, nmea_date_t *date) {
+  u32 ddmmyy;
+  if (6 != field.end - field.begin || !parse_digits(field.begin, 6, &ddmmyy)) {
+    return false;
+  }
+  u32 yy = ddmmyy % 100;
+  date->year = (u16)(yy < 80 ? 2000 + yy : 1900 + yy);
+  date->month = (u8)(ddmmyy / 100 % 100);
+  date->day = (u8)(ddmmyy / 10000);
+  return date->month >= 1 && date->month <= YEAR_MONTHS && date->day >= 1 &&
+         date->day <= 31;
+}
+
+/* "dddmm.mmm" and its hemisphere as signed degrees */
+static bool parse_deg_min(nmea_field_t field,
+                          nmea_field_t hemisphere,
+                          char negative,
+                          char positive,
+                          double *deg) {
+  double deg_min;
+  char h = field_char(hemisphere);
+  if (!parse_fixed(field, &deg_min) || deg_min < 0 ||
+      (h != negative && h != positive)) {
+    return false;
+  }
+  double whole_deg = floor(deg_min / 100);
+  *deg = whole_deg + (deg_min - whole_deg * 100) / 60;
+  if (h == negative) {
+    *deg = -*deg;
+  }
+  return true;
+}
+
+static u32 time_of_day_ms(const nmea_time_t *time) {
+  return ((time->hours * HOUR_MINUTES + time->minutes) * MINUTE_SECS +
+          time->seconds) *
+             SECS_MS +
+         (time->ns + 500000) / 1000000;
+}
+
+/* Days since the GPS epoch, which was a Sunday */
+static s32 gps_days_from_date(const nmea_date_t *date) {
+  /* days since 1970-01-01 of the proleptic Gregorian calendar, with the
+   * year starting in March so that the leap day comes last */
+  s32 y = date->year - (date->month <= 2 ? 1 : 0);
+  s32 era = y / 400;
+  s32 yoe = y - era * 400;
+  s32 mp = (date->month + 9) % 12;
+  s32 doy = (153 * mp + 2) / 5 + date->day - 1;
+  s32 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468 - GPS_EPOCH_DAYS;
+}
+
+/* Position mode with the GGA quality indicator, the inverse of
+ * get_nmea_quality_indicator(). Where several modes share an indicator the
+ * first one is taken, i.e. DGNSS and not SBAS. */
+static u8 position_mode(u32 quality) {
+  for (u8 mode = POSITION_MODE_NONE; mode <= POSITION_MODE_SBAS; mode++) {
+    if (get_nmea_quality_indicator(mode) == quality) {
+      return mode;
+    }
+  }
+  return POSITION_MODE_NONE;
+}
+
+static void send_msg(const nmea2sbp_t *state,
+                     u16 msg_id,
+                     void *msg,
+                     size_t len) {
+  state->cb_nmea_to_sbp(
+      msg_id, (u8)len, (u8 *)msg, state->sender_id, state->context);
+}
+
+/* Move to the epoch of a sentence with UTC time of day tod_ms. Returns false
+ * while the date is not known. */
+static bool update_epoch(nmea2sbp_t *state, u32 tod_ms) {
+  if (state->gps_days < 0) {
+    state->n_no_date++;
+    return false;
+  }
+  if (TOD_INVALID != state->last_tod_ms &&
+      tod_ms + DAY_MS / 2 < state->last_tod_ms) {
+    /* past midnight, the next RMC sentence confirms the date */
+    state->gps_days++;
+  }
+  state->last_tod_ms = tod_ms;
+
+  s64 tow_ms = (s64)(state->gps_days % 7) * DAY_MS + tod_ms +
+               (s64)state->leap_seconds * SECS_MS;
+  state->tow = (u32)(((tow_ms % WEEK_MS) + WEEK_MS) % WEEK_MS);
+  return true;
+}
+
+/* Speed over ground in m/s and course in degrees as north and east mm/s.
+ * Receivers leave the course empty when stationary, without a course the
+ * velocity of a moving receiver is unknown. */
+static void send_vel_ned(nmea2sbp_t *state,
+                         bool valid,
+                         double speed,
+                         nmea_field_t course) {
+  if (state->vel_tow == state->tow) {
+    return;
+  }
+  state->vel_tow = state->tow;
+
+  msg_vel_ned_t vel;
+  memset(&vel, 0, sizeof(vel));
+  vel.tow = state->tow;
+  double cog;
+  if (valid && parse_fixed(course, &cog)) {
+    vel.n = (s32)lround(speed * cos(cog / R2D) * 1000);
+    vel.e = (s32)lround(speed * sin(cog / R2D) * 1000);
+  } else if (0 != speed) {
+    valid = false;
+  }
+  vel.flags = valid ? VELOCITY_MODE_MEASURED_DOPPLER : VELOCITY_MODE_NONE;
+  send_msg(state, SBP_MSG_VEL_NED, &vel, sizeof(vel));
+}
+
+/* $--GGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,q,nn,h.h,a.a,M,g.g,M,x.x,iiii */
+static void convert_gga(nmea2sbp_t *state) {
+  nmea_time_t time;
+  u32 quality;
+  if (!parse_time(get_field(state, 1), &time) ||
+      !parse_uint(get_field(state, 6), &quality)) {
+    state->n_invalid++;
+    return;
+  }
+  if (!update_epoch(state, time_of_day_ms(&time))) {
+    return;
+  }
+
+  msg_pos_llh_t pos;
+  memset(&pos, 0, sizeof(pos));
+  pos.tow = state->tow;
+  pos.flags = position_mode(quality);
+  if (POSITION_MODE_NONE != pos.flags) {
+    u32 n_sats;
+    double lat, lon, altitude;
+    double separation = 0;
+    nmea_field_t separation_field = get_field(state, 11);
+    if (!parse_deg_min(
+            get_field(state, 2), get_field(state, 3), 'S', 'N', &lat) ||
+        !parse_deg_min(
+            get_field(state, 4), get_field(state, 5), 'W', 'E', &lon) ||
+        !parse_uint(get_field(state, 7), &n_sats) ||
+        !parse_fixed(get_field(state, 9), &altitude) ||
+        (!field_empty(separation_field) &&
+         !parse_fixed(separation_field, &separation))) {
+      state->n_invalid++;
+      return;
+    }
+    pos.lat = lat;
+    pos.lon = lon;
+    /* height above the ellipsoid */
+    pos.height = altitude + separation;
+    pos.n_sats = (u8)MIN(n_sats, UINT8_MAX);
+  }
+
+  state->pos_flags = pos.flags;
+  state->pos_tow = pos.tow;
+  send_msg(state, SBP_MSG_POS_LLH, &pos, sizeof(pos));
+}
+
+/* $--RMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,x.x,a,m */
+static void convert_rmc(nmea2sbp_t *state) {
+  nmea_time_t time;
+  nmea_date_t date;
+  if (!parse_time(get_field(state, 1), &time) ||
+      !parse_date(get_field(state, 9), &date)) {
+    state->n_invalid++;
+    return;
+  }
+
+  /* the date is that of the time, no need to look for midnight */
+  state->gps_days = gps_days_from_date(&date);
+  state->last_tod_ms = TOD_INVALID;
+  update_epoch(state, time_of_day_ms(&time));
+
+  msg_utc_time_t utc;
+  memset(&utc, 0, sizeof(utc));
+  utc.flags = TIME_SOURCE_GNSS;
+  utc.tow = state->tow;
+  utc.year = date.year;
+  utc.month = date.month;
+  utc.day = date.day;
+  utc.hours = time.hours;
+  utc.minutes = time.minutes;
+  utc.seconds = time.seconds;
+  utc.ns = time.ns;
+  send_msg(state, SBP_MSG_UTC_TIME, &utc, sizeof(utc));
+
+  double sog_knots;
+  bool valid = 'A' == field_char(get_field(state, 2)) &&
+               'N' != field_char(get_field(state, 12)) &&
+               parse_fixed(get_field(state, 7), &sog_knots);
+  send_vel_ned(
+      state, valid, valid ? KNOTS2MS(sog_knots) : 0, get_field(state, 8));
+}
+
+/* $--VTG,x.x,T,x.x,M,x.x,N,x.x,K,m */
+static void convert_vtg(nmea2sbp_t *state) {
+  if (TOW_INVALID == state->tow) {
+    state->n_no_date++;
+    return;
+  }
+
+  /* the speed in km/h has the finer resolution */
+  double speed;
+  bool valid = 'N' != field_char(get_field(state, 9));
+  if (valid && parse_fixed(get_field(state, 7), &speed)) {
+    speed = KMHR2MS(speed);
+  } else if (valid && parse_fixed(get_field(state, 5), &speed)) {
+    speed = KNOTS2MS(speed);
+  } else {
+    valid = false;
+    speed = 0;
+  }
+  send_vel_ned(state, valid, speed, get_field(state, 1));
+}
+
+static u16 dop_value(nmea_field_t field) {
+  double dop;
+  if (!parse_fixed(field, &dop) || dop < 0) {
+    return 0;
+  }
+  return (u16)MIN(lround(dop * 100), UINT16_MAX);
+}
+
+/* $--GSA,a,x,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,x.x,x.x,x.x */
+static void convert_gsa(nmea2sbp_t *state) {
+  if (TOW_INVALID == state->tow) {
+    state->n_no_date++;
+    return;
+  }
+  /* one sentence per talker ID with the same DOPs */
+  if (state->dops_tow == state->tow) {
+    return;
+  }
+  state->dops_tow = state->tow;
+
+  char fix_mode = field_char(get_field(state, 2));
+  msg_dops_t dops;
+  memset(&dops, 0, sizeof(dops));
+  dops.tow = state->tow;
+  if ('2' == fix_mode || '3' == fix_mode) {
+    dops.pdop = dop_value(get_field(state, 15));
+    dops.hdop = dop_value(get_field(state, 16));
+    dops.vdop = dop_value(get_field(state, 17));
+    dops.flags = (state->pos_tow == state->tow) ? state->pos_flags
+                                                : POSITION_MODE_SPP;
+  }
+  send_msg(state, SBP_MSG_DOPS, &dops, sizeof(dops));
+}
+
+static void convert_sentence(nmea2sbp_t *state) {
+  nmea_field_t address = get_field(state, 0);
+  /* talker ID and sentence type, proprietary sentences are ignored */
+  if (5 != address.end - address.begin) {
+    return;
+  }
+  const char *type = address.begin + 2;
+  if (0 == memcmp(type, "GGA", 3)) {
+    convert_gga(state);
+  } else if (0 == memcmp(type, "RMC", 3)) {
+    convert_rmc(state);
+  } else if (0 == memcmp(type, "VTG", 3)) {
+    convert_vtg(state);
+  } else if (0 == memcmp(type, "GSA", 3)) {
+    convert_gsa(state);
+  }
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+void nmea2sbp_init(nmea2sbp_t *state,
+                   void (*cb_nmea_to_sbp)(u16 msg_id,
+                                          u8 length,
+                                          u8 *buffer,
+                                          u16 sender_id,
+                                          void *context),
+                   void *context) {
+  assert(NULL != cb_nmea_to_sbp);
+  memset(state, 0, sizeof(*state));
+  state->framing = FRAMING_IDLE;
+  state->gps_days = -1;
+  state->last_tod_ms = TOD_INVALID;
+  state->tow = TOW_INVALID;
+  state->leap_seconds = NMEA2SBP_DEFAULT_LEAP_SECONDS;
+  state->pos_tow = TOW_INVALID;
+  state->vel_tow = TOW_INVALID;
+  state->dops_tow = TOW_INVALID;
+  state->cb_nmea_to_sbp = cb_nmea_to_sbp;
+  state->context = context;
+}
+
+void nmea2sbp_set_leap_second(nmea2sbp_t *state, s8 leap_seconds) {
+  state->leap_seconds = leap_seconds;
+}
+
+void nmea2sbp_set_sender_id(nmea2sbp_t *state, u16 sender_id) {
+  state->sender_id = sender_id;
+}
+
+void nmea2sbp_decode(nmea2sbp_t *state, const char *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    const char c = data[i];
+    if ('$' == c) {
+      /* a new sentence, even if the previous one is incomplete */
+      if (FRAMING_IDLE != state->framing) {
+        state->n_invalid++;
+      }
+      state->framing = FRAMING_BODY;
+      state->len = 0;
+      state->field[0] = 0;
+      state->n_fields = 1;
+      state->checksum = 0;
+      continue;
+    }
+
+    switch (state->framing) {
+      case FRAMING_IDLE:
+        break;
+
+      case FRAMING_BODY:
+        if ('*' == c) {
+          state->framing = FRAMING_CHECKSUM_HI;
+        } else if ('\r' == c || '\n' == c ||
+                   NMEA2SBP_MAX_SENTENCE_LEN == state->len) {
+          /* no checksum or too long */
+          state->framing = FRAMING_IDLE;
+          state->n_invalid++;
+        } else {
+          /* the fields are split and checksummed as the sentence comes in */
+          state->checksum ^= (u8)c;
+          if (',' == c && state->n_fields < NMEA2SBP_MAX_FIELDS) {
+            state->field[state->n_fields++] = (u8)(state->len + 1);
+          }
+          state->sentence[state->len++] = c;
+        }
+        break;
+
+      case FRAMING_CHECKSUM_HI:
+      case FRAMING_CHECKSUM_LO: {
+        int value = hex_value(c);
+        if (value < 0) {
+          state->framing = FRAMING_IDLE;
+          state->n_invalid++;
+        } else if (FRAMING_CHECKSUM_HI == state->framing) {
+          state->sentence_checksum = (u8)(value << 4);
+          state->framing = FRAMING_CHECKSUM_LO;
+        } else {
+          state->framing = FRAMING_IDLE;
+          if ((state->sentence_checksum | value) == state->checksum) {
+            convert_sentence(state);
+          } else {
+            state->n_checksum_errors++;
+          }
+        }
+        break;
+      }
+
+      default:
+        assert(!"Invalid NMEA framing state");
+        state->framing = FRAMING_IDLE;
+        break;
+    }
+  }
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "gnss-converters/rtcm3_fanout.h"
+#include "rtcm3_sbp_internal.h"
+
+#include <assert.h>
+#include <string.h>
+
+static struct rtcm3_fanout_cache *profile_cache(struct rtcm3_fanout *fanout,
+                                                msm_enum msm_type) {
+  switch (msm_type) {
+    case MSM_UNKNOWN:
+      return &fanout->cache[0];
+    case MSM4:
+      return &fanout->cache[1];
+    case MSM5:
+      return &fanout->cache[2];
+    case MSM1:
+    case MSM2:
+    case MSM3:
+    case MSM6:
+    case MSM7:
+    default:
+      /* no encoder available for these */
+      return NULL;
+  }
+}
+
+/* station messages are the same for every profile, pass them straight on */
+static void fanout_station_cb(u8 *buffer, u16 length, void *context) {
+  struct rtcm3_fanout *fanout = (struct rtcm3_fanout *)context;
+  if (NULL != fanout->cb_sbp_to_rtcm) {
+    fanout->cb_sbp_to_rtcm(buffer, length, fanout->context);
+  }
+}
+
+/* collect the observation frames of the profile being encoded */
+static void fanout_capture_cb(u8 *buffer, u16 length, void *context) {
+  struct rtcm3_fanout *fanout = (struct rtcm3_fanout *)context;
+  struct rtcm3_fanout_cache *cache = fanout->encoding;
+  assert(NULL != cache);
+
+  if (0 == length) {
+    return;
+  }
+  if (cache->length + length > RTCM3_FANOUT_BUFFER_SIZE) {
+    fanout->n_dropped_frames++;
+    return;
+  }
+  memcpy(&cache->frames[cache->length], buffer, length);
+  cache->length += length;
+}
+
+/* take a copy of the complete epoch, it is encoded only when requested */
+static void fanout_epoch_cb(const struct rtcm3_out_state *state,
+                            void *context) {
+  struct rtcm3_fanout *fanout = (struct rtcm3_fanout *)context;
+  fanout->out = *state;
+  fanout->out.cb_sbp_to_rtcm = fanout_capture_cb;
+  fanout->out.cb_sbp_obs_epoch = NULL;
+  fanout->epoch++;
+}
+
+void rtcm3_fanout_init(struct rtcm3_fanout *fanout,
+                       void (*cb_sbp_to_rtcm)(u8 *buffer,
+                                              u16 length,
+                                              void *context),
+                       void *context) {
+  memset(fanout, 0, sizeof(*fanout));
+  fanout->cb_sbp_to_rtcm = cb_sbp_to_rtcm;
+  fanout->context = context;
+
+  sbp2rtcm_init(&fanout->in, fanout_station_cb, fanout);
+  /* observations are not encoded by the input state itself */
+  fanout->in.send_legacy_obs = false;
+  fanout->in.send_msm_obs = false;
+  fanout->in.cb_sbp_obs_epoch = fanout_epoch_cb;
+
+  fanout->out = fanout->in;
+  fanout->out.cb_sbp_to_rtcm = fanout_capture_cb;
+  fanout->out.cb_sbp_obs_epoch = NULL;
+}
+
+void rtcm3_fanout_base_pos_ecef_cb(const u16 sender_id,
+                                   const u8 len,
+                                   const u8 msg[],
+                                   struct rtcm3_fanout *fanout) {
+  sbp2rtcm_base_pos_ecef_cb(sender_id, len, msg, &fanout->in);
+}
+
+void rtcm3_fanout_glo_biases_cb(const u16 sender_id,
+                                const u8 len,
+                                const u8 msg[],
+                                struct rtcm3_fanout *fanout) {
+  sbp2rtcm_glo_biases_cb(sender_id, len, msg, &fanout->in);
+}
+
+void rtcm3_fanout_sbp_obs_cb(const u16 sender_id,
+                             const u8 len,
+                             const u8 msg[],
+                             struct rtcm3_fanout *fanout) {
+  sbp2rtcm_sbp_obs_cb(sender_id, len, msg, &fanout->in);
+}
+
+u32 rtcm3_fanout_epoch(const struct rtcm3_fanout *fanout) {
+  return fanout->epoch;
+}
+
+u16 rtcm3_fanout_get(struct rtcm3_fanout *fanout,
+                     msm_enum msm_type,
+                     const u8 **frames) {
+  struct rtcm3_fanout_cache *cache = profile_cache(fanout, msm_type);
+  if (NULL == cache || 0 == fanout->epoch) {
+    *frames = NULL;
+    return 0;
+  }
+
+  if (!cache->valid || cache->epoch != fanout->epoch) {
+    cache->length = 0;
+    fanout->encoding = cache;
+    if (MSM_UNKNOWN == msm_type) {
+      sbp_buffer_to_legacy_rtcm3(&fanout->out);
+    } else {
+      fanout->out.msm_type = msm_type;
+      sbp_buffer_to_msm(&fanout->out);
+    }
+    fanout->encoding = NULL;
+    cache->epoch = fanout->epoch;
+    cache->valid = true;
+    fanout->n_encodes++;
+  }
+
+  *frames = cache->frames;
+  return cache->length;
+}
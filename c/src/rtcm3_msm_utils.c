@@ -314,7 +314,7 @@ u8 code_to_msm_signal_id(const code_t code, const rtcm_constellation_t cons) {
     default:
       break;
   }
-  fprintf(stderr, "Code %d not found in RTCM constellation %u\n", code, cons);
+  /* not found, callers report GNSSC_DIAG_MSM_UNSUPPORTED_CODE */
   return MSM_SIGNAL_MASK_SIZE;
 }
 
@@ -558,16 +558,21 @@ u8 msm_get_num_cells(const rtcm_msm_header *header) {
   return count_mask_values(cell_size, header->cell_mask);
 }
 
-static void msm_add_to_header_err(code_t code, u8 prn, const char reason[]) {
-  char code_string[SID_STR_LEN_MAX];
-  gnss_signal_t sid = {prn, code};
-  sid_to_string(code_string, SID_STR_LEN_MAX, sid);
-  fprintf(stderr, "Cannot add %s to MSM header: %s\n", code_string, reason);
+static void msm_add_to_header_err(const rtcm_msm_header *header,
+                                  gnssc_diag_event_t event,
+                                  code_t code,
+                                  u8 prn,
+                                  struct gnssc_diag *diag) {
+  gnssc_diag_report(diag, event, header->stn_id, code, prn, 0, 0);
 }
 
 /* add the given signal and satellite to the MSM header, returns true if
- * successful, false on failure (invalid signal, or cell mask full) */
-bool msm_add_to_header(rtcm_msm_header *header, code_t code, u8 prn) {
+ * successful, false on failure (invalid signal, or cell mask full). Failures
+ * are reported to diag, which may be NULL */
+bool msm_add_to_header(rtcm_msm_header *header,
+                       code_t code,
+                       u8 prn,
+                       struct gnssc_diag *diag) {
   /* should not try to add more satellites or signals if cell mask is already
    * filled */
   assert(msm_get_num_cells(header) == 0);
@@ -575,16 +580,26 @@ bool msm_add_to_header(rtcm_msm_header *header, code_t code, u8 prn) {
   rtcm_constellation_t cons = to_constellation(header->msg_num);
 
   if (CODE_INVALID == code) {
-    msm_add_to_header_err(code, prn, "invalid code");
+    msm_add_to_header_err(header, GNSSC_DIAG_MSM_INVALID_CODE, code, prn, diag);
     return false;
   }
   if (!prn_valid(cons, prn)) {
-    msm_add_to_header_err(code, prn, "invalid PRN");
+    msm_add_to_header_err(header, GNSSC_DIAG_MSM_INVALID_PRN, code, prn, diag);
     return false;
   }
 
   u8 sat_id = prn_to_msm_sat_id(prn, cons);
   u8 signal_id = code_to_msm_signal_id(code, cons);
+  if (signal_id >= MSM_SIGNAL_MASK_SIZE) {
+    gnssc_diag_report(diag,
+                      GNSSC_DIAG_MSM_UNSUPPORTED_CODE,
+                      header->stn_id,
+                      code,
+                      cons,
+                      0,
+                      0);
+    return false;
+  }
 
   u8 num_sats = msm_get_num_satellites(header);
   u8 num_signals = msm_get_num_signals(header);
@@ -595,8 +610,7 @@ bool msm_add_to_header(rtcm_msm_header *header, code_t code, u8 prn) {
       header->satellite_mask[sat_id] = true;
       num_sats++;
     } else {
-      msm_add_to_header_err(
-          code, prn, "cell size limit for satellites reached");
+      msm_add_to_header_err(header, GNSSC_DIAG_MSM_SAT_LIMIT, code, prn, diag);
       return false;
     }
   }
@@ -607,7 +621,8 @@ bool msm_add_to_header(rtcm_msm_header *header, code_t code, u8 prn) {
       header->signal_mask[signal_id] = true;
       num_signals++;
     } else {
-      msm_add_to_header_err(code, prn, "cell size limit for signals reached");
+      msm_add_to_header_err(
+          header, GNSSC_DIAG_MSM_SIGNAL_LIMIT, code, prn, diag);
       return false;
     }
   }
@@ -616,30 +631,45 @@ bool msm_add_to_header(rtcm_msm_header *header, code_t code, u8 prn) {
 
 /* given a header with satellite and signal masks built, allocate a cell for the
  * given signal and satellite */
-bool msm_add_to_cell_mask(rtcm_msm_header *header, code_t code, u8 prn) {
+bool msm_add_to_cell_mask(rtcm_msm_header *header,
+                          code_t code,
+                          u8 prn,
+                          struct gnssc_diag *diag) {
   uint8_t num_sigs = msm_get_num_signals(header);
   assert(num_sigs > 0);
 
   rtcm_constellation_t cons = to_constellation(header->msg_num);
 
   if (CODE_INVALID == code) {
-    msm_add_to_header_err(code, prn, "invalid code");
+    msm_add_to_header_err(header, GNSSC_DIAG_MSM_INVALID_CODE, code, prn, diag);
     return false;
   }
   if (!prn_valid(cons, prn)) {
-    msm_add_to_header_err(code, prn, "invalid PRN");
+    msm_add_to_header_err(header, GNSSC_DIAG_MSM_INVALID_PRN, code, prn, diag);
     return false;
   }
 
   u8 sat_id = prn_to_msm_sat_id(prn, cons);
   if (!header->satellite_mask[sat_id]) {
-    msm_add_to_header_err(code, prn, "not in satellite mask");
+    msm_add_to_header_err(
+        header, GNSSC_DIAG_MSM_NOT_IN_SAT_MASK, code, prn, diag);
     return false;
   }
 
   u8 signal_id = code_to_msm_signal_id(code, cons);
+  if (signal_id >= MSM_SIGNAL_MASK_SIZE) {
+    gnssc_diag_report(diag,
+                      GNSSC_DIAG_MSM_UNSUPPORTED_CODE,
+                      header->stn_id,
+                      code,
+                      cons,
+                      0,
+                      0);
+    return false;
+  }
   if (!header->signal_mask[signal_id]) {
-    msm_add_to_header_err(code, prn, "not in signal mask");
+    msm_add_to_header_err(
+        header, GNSSC_DIAG_MSM_NOT_IN_SIGNAL_MASK, code, prn, diag);
     return false;
   }
 
@@ -16,6 +16,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include <gnss-converters/diagnostics.h>
 #include <rtcm3/messages.h>
 #include <swiftnav/signal.h>
 
@@ -40,7 +41,13 @@ u8 msm_get_num_signals(const rtcm_msm_header *header);
 u8 msm_get_num_satellites(const rtcm_msm_header *header);
 u8 msm_get_num_cells(const rtcm_msm_header *header);
 
-bool msm_add_to_header(rtcm_msm_header *header, code_t code, u8 prn);
-bool msm_add_to_cell_mask(rtcm_msm_header *header, code_t code, u8 prn);
+bool msm_add_to_header(rtcm_msm_header *header,
+                       code_t code,
+                       u8 prn,
+                       struct gnssc_diag *diag);
+bool msm_add_to_cell_mask(rtcm_msm_header *header,
+                          code_t code,
+                          u8 prn,
+                          struct gnssc_diag *diag);
 
 #endif /* GNSS_CONVERTERS_RTCM3_MSM_UTILS_H */
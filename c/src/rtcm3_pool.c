@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "gnss-converters/rtcm3_pool.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+bool rtcm2sbp_pool_init(struct rtcm2sbp_pool *pool,
+                        struct rtcm3_sbp_state states[],
+                        u16 n_states,
+                        void (*cb_rtcm_to_sbp)(u16 msg_id,
+                                               u8 length,
+                                               u8 *buffer,
+                                               u16 sender_id,
+                                               void *context),
+                        void (*cb_base_obs_invalid)(double time_diff,
+                                                    void *context)) {
+  if (n_states > RTCM3_POOL_MAX_STATES) {
+    return false;
+  }
+
+  rtcm2sbp_init(&pool->config, cb_rtcm_to_sbp, cb_base_obs_invalid, NULL);
+  pool->states = states;
+  pool->n_states = n_states;
+  pool->n_free = n_states;
+  for (u16 i = 0; i < n_states; i++) {
+    rtcm2sbp_init(&states[i], cb_rtcm_to_sbp, cb_base_obs_invalid, NULL);
+    /* hand out the lowest indices first */
+    pool->free_list[i] = n_states - 1 - i;
+  }
+  return true;
+}
+
+struct rtcm3_sbp_state *rtcm2sbp_pool_acquire(struct rtcm2sbp_pool *pool,
+                                              void *context) {
+  if (0 == pool->n_free) {
+    return NULL;
+  }
+
+  struct rtcm3_sbp_state *state =
+      &pool->states[pool->free_list[--pool->n_free]];
+  rtcm2sbp_reset(&pool->config, state);
+  state->context = context;
+  /* the block of the previous user must not be written any more */
+  state->stats = NULL;
+  state->trace = NULL;
+  return state;
+}
+
+void rtcm2sbp_pool_release(struct rtcm2sbp_pool *pool,
+                           struct rtcm3_sbp_state *state) {
+  assert(state >= pool->states && state < &pool->states[pool->n_states]);
+  assert(pool->n_free < pool->n_states);
+  pool->free_list[pool->n_free++] = (u16)(state - pool->states);
+}
+
+bool sbp2rtcm_pool_init(struct sbp2rtcm_pool *pool,
+                        struct rtcm3_out_state states[],
+                        u16 n_states,
+                        void (*cb_sbp_to_rtcm)(u8 *buffer,
+                                               u16 length,
+                                               void *context)) {
+  if (n_states > RTCM3_POOL_MAX_STATES) {
+    return false;
+  }
+
+  sbp2rtcm_init(&pool->config, cb_sbp_to_rtcm, NULL);
+  pool->states = states;
+  pool->n_states = n_states;
+  pool->n_free = n_states;
+  for (u16 i = 0; i < n_states; i++) {
+    sbp2rtcm_init(&states[i], cb_sbp_to_rtcm, NULL);
+    pool->free_list[i] = n_states - 1 - i;
+  }
+  return true;
+}
+
+struct rtcm3_out_state *sbp2rtcm_pool_acquire(struct sbp2rtcm_pool *pool,
+                                              void *context) {
+  if (0 == pool->n_free) {
+    return NULL;
+  }
+
+  struct rtcm3_out_state *state =
+      &pool->states[pool->free_list[--pool->n_free]];
+  sbp2rtcm_reset(&pool->config, state);
+  state->context = context;
+  state->stats = NULL;
+  return state;
+}
+
+void sbp2rtcm_pool_release(struct sbp2rtcm_pool *pool,
+                           struct rtcm3_out_state *state) {
+  assert(state >= pool->states && state < &pool->states[pool->n_states]);
+  assert(pool->n_free < pool->n_states);
+  pool->free_list[pool->n_free++] = (u16)(state - pool->states);
+}
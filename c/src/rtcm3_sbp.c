@@ -35,6 +35,16 @@
 
 #include "rtcm3_msm_utils.h"
 
+_Static_assert(MAX_OBS_PER_EPOCH > 0 &&
+                   MAX_OBS_PER_EPOCH <= SBP_MAX_OBS_SEQ * MAX_OBS_IN_SBP,
+               "GNSSC_MAX_OBS_PER_EPOCH must be between 1 and 210");
+_Static_assert(RTCM3_MAX_STATIONS > 0 && RTCM3_MAX_STATIONS <= UINT8_MAX,
+               "RTCM3_MAX_STATIONS must be between 1 and 255");
+_Static_assert(RTCM3_REORDER_MAX_EPOCHS <= UINT8_MAX,
+               "RTCM3_REORDER_MAX_EPOCHS must be at most 255");
+_Static_assert(RTCM3_SBP_QUEUE_SIZE <= UINT16_MAX,
+               "output queue offsets must fit in u16");
+
 static void validate_base_obs_sanity(struct rtcm3_sbp_state *state,
                                      const gps_time_t *obs_time,
                                      const gps_time_t *rover_time);
@@ -55,15 +65,50 @@ void rtcm2sbp_init(struct rtcm3_sbp_state *state,
   state->leap_seconds = 0;
   state->leap_second_known = false;
 
-  state->sender_id = 0;
   state->cb_rtcm_to_sbp = cb_rtcm_to_sbp;
   state->cb_base_obs_invalid = cb_base_obs_invalid;
   state->context = context;
 
-  state->last_gps_time.wn = INVALID_TIME;
-  state->last_gps_time.tow = 0;
-  state->last_glo_time.wn = INVALID_TIME;
-  state->last_glo_time.tow = 0;
+  for (u8 i = 0; i < sizeof(state->glo_sv_id_fcn_map); i++) {
+    state->glo_sv_id_fcn_map[i] = MSM_GLO_FCN_UNKNOWN;
+  }
+
+  memset(state->stations, 0, sizeof(state->stations));
+  state->reorder_window = 0;
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+  memset(state->reorder_slots, 0, sizeof(state->reorder_slots));
+#endif
+  state->decimation_ms = 0;
+
+  memset(&state->epoch_timer, 0, sizeof(state->epoch_timer));
+
+  gnssc_diag_init(&state->diag);
+  state->stats = NULL;
+  state->trace = NULL;
+
+  rtcm2sbp_reset(NULL, state);
+}
+
+void rtcm2sbp_reset(const struct rtcm3_sbp_state *config,
+                    struct rtcm3_sbp_state *state) {
+  if (NULL != config && config != state) {
+    state->time_from_rover_obs = config->time_from_rover_obs;
+    state->leap_seconds = config->leap_seconds;
+    state->leap_second_known = config->leap_second_known;
+    state->cb_rtcm_to_sbp = config->cb_rtcm_to_sbp;
+    state->cb_base_obs_invalid = config->cb_base_obs_invalid;
+    state->context = config->context;
+    memcpy(state->glo_sv_id_fcn_map,
+           config->glo_sv_id_fcn_map,
+           sizeof(state->glo_sv_id_fcn_map));
+    state->reorder_window = config->reorder_window;
+    state->decimation_ms = config->decimation_ms;
+    state->epoch_timer.timeout_ms = config->epoch_timer.timeout_ms;
+    state->diag = config->diag;
+  }
+
+  state->sender_id = 0;
+
   state->last_1230_received.wn = INVALID_TIME;
   state->last_1230_received.tow = 0;
   state->last_msm_received.wn = INVALID_TIME;
@@ -74,11 +119,32 @@ void rtcm2sbp_init(struct rtcm3_sbp_state *state,
     state->sent_code_warning[i] = false;
   }
 
-  for (u8 i = 0; i < sizeof(state->glo_sv_id_fcn_map); i++) {
-    state->glo_sv_id_fcn_map[i] = MSM_GLO_FCN_UNKNOWN;
+  /* the buffers are cleared when they are taken into use again */
+  for (u8 i = 0; i < RTCM3_MAX_STATIONS; i++) {
+    state->stations[i].in_use = false;
+  }
+  state->station_use_count = 0;
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+  for (u8 i = 0; i < RTCM3_REORDER_MAX_EPOCHS; i++) {
+    state->reorder_slots[i].in_use = false;
   }
+#endif
+  state->n_reordered_msgs = 0;
+  state->n_decimated_frames = 0;
+  state->gps_time_cache.valid = false;
+  state->glo_time_cache.valid = false;
+
+  u32 timeout_ms = state->epoch_timer.timeout_ms;
+  memset(&state->epoch_timer, 0, sizeof(state->epoch_timer));
+  state->epoch_timer.timeout_ms = timeout_ms;
 
-  memset(state->obs_buffer, 0, OBS_BUFFER_SIZE);
+  gnssc_diag_reset_counters(&state->diag);
+
+  state->queue.head = 0;
+  state->queue.tail = 0;
+  state->queue.wrap = RTCM3_SBP_QUEUE_SIZE;
+  state->queue.count = 0;
+  state->queue.n_dropped = 0;
 
   rtcm_init_logging(&rtcm_log_callback_fn, state);
 }
@@ -92,10 +158,9 @@ void sbp2rtcm_init(struct rtcm3_out_state *state,
   state->leap_second_known = false;
 
   state->cb_sbp_to_rtcm = cb_sbp_to_rtcm;
+  state->cb_sbp_obs_epoch = NULL;
   state->context = context;
 
-  state->n_sbp_obs = 0;
-
   for (u8 i = 0; i < sizeof(state->glo_sv_id_fcn_map); i++) {
     state->glo_sv_id_fcn_map[i] = MSM_GLO_FCN_UNKNOWN;
   }
@@ -109,6 +174,66 @@ void sbp2rtcm_init(struct rtcm3_out_state *state,
   memset(state->ant_descriptor, 0, sizeof(state->ant_descriptor));
   memset(state->rcv_descriptor, 0, sizeof(state->rcv_descriptor));
 
+  memset(state->stn_msgs, 0, sizeof(state->stn_msgs));
+  for (u8 i = 0; i < RTCM3_STN_MSG_COUNT; i++) {
+    state->stn_msgs[i].interval_ms = RTCM3_STN_MSG_INTERVAL_IMMEDIATE;
+  }
+  /* 1006 carries the same position, 1005 is sent only on request */
+  state->stn_msgs[RTCM3_STN_MSG_1005].interval_ms = RTCM3_STN_MSG_INTERVAL_OFF;
+
+  memset(&state->epoch_timer, 0, sizeof(state->epoch_timer));
+
+  gnssc_diag_init(&state->diag);
+  state->stats = NULL;
+
+  sbp2rtcm_reset(NULL, state);
+}
+
+void sbp2rtcm_reset(const struct rtcm3_out_state *config,
+                    struct rtcm3_out_state *state) {
+  if (NULL != config && config != state) {
+    state->leap_seconds = config->leap_seconds;
+    state->leap_second_known = config->leap_second_known;
+    state->cb_sbp_to_rtcm = config->cb_sbp_to_rtcm;
+    state->cb_sbp_obs_epoch = config->cb_sbp_obs_epoch;
+    state->context = config->context;
+    memcpy(state->glo_sv_id_fcn_map,
+           config->glo_sv_id_fcn_map,
+           sizeof(state->glo_sv_id_fcn_map));
+    state->send_legacy_obs = config->send_legacy_obs;
+    state->send_msm_obs = config->send_msm_obs;
+    state->msm_type = config->msm_type;
+    state->ant_known = config->ant_known;
+    state->ant_height = config->ant_height;
+    memcpy(state->ant_descriptor,
+           config->ant_descriptor,
+           sizeof(state->ant_descriptor));
+    memcpy(state->rcv_descriptor,
+           config->rcv_descriptor,
+           sizeof(state->rcv_descriptor));
+    for (u8 i = 0; i < RTCM3_STN_MSG_COUNT; i++) {
+      state->stn_msgs[i].interval_ms = config->stn_msgs[i].interval_ms;
+    }
+    state->epoch_timer.timeout_ms = config->epoch_timer.timeout_ms;
+    state->diag = config->diag;
+  }
+
+  state->sender_id = 0;
+  state->n_sbp_obs = 0;
+
+  /* the cached station message content belongs to the previous stream */
+  for (u8 i = 0; i < RTCM3_STN_MSG_COUNT; i++) {
+    state->stn_msgs[i].valid = false;
+    state->stn_msgs[i].dirty = false;
+    state->stn_msgs[i].scheduled = false;
+  }
+
+  u32 timeout_ms = state->epoch_timer.timeout_ms;
+  memset(&state->epoch_timer, 0, sizeof(state->epoch_timer));
+  state->epoch_timer.timeout_ms = timeout_ms;
+
+  gnssc_diag_reset_counters(&state->diag);
+
   rtcm_init_logging(&rtcm_log_callback_fn, state);
 }
 
@@ -121,6 +246,54 @@ double sbp_diff_time(const sbp_gps_time_t *end,
   return dt;
 }
 
+/* epoch periods above this are gaps in the data rather than the rate */
+#define EPOCH_PERIOD_MAX_S 60
+
+/* Note that the pending epoch received observations at the last tick */
+static void epoch_timer_input(const struct rtcm3_epoch_timer *timer,
+                              struct rtcm3_epoch_stream *stream) {
+  stream->last_input_ms = timer->now_ms;
+}
+
+/* Note that an epoch was sent, and update the epoch period of the stream */
+static void epoch_timer_sent(struct rtcm3_epoch_stream *stream,
+                             const sbp_gps_time_t *t) {
+  if (stream->last_epoch_valid) {
+    double dt = sbp_diff_time(t, &stream->last_epoch);
+    if (dt > 0 && dt <= EPOCH_PERIOD_MAX_S) {
+      stream->epoch_period_ms = (u32)lrint(dt * SECS_MS);
+    }
+  }
+  stream->last_epoch = *t;
+  stream->last_epoch_valid = true;
+  stream->last_epoch_forced = false;
+}
+
+/* Return true if no data arrived since last_input_ms within the timeout,
+ * which the automatic mode derives from the epoch period of the stream */
+static bool epoch_timer_expired(const struct rtcm3_epoch_timer *timer,
+                                const struct rtcm3_epoch_stream *stream,
+                                u64 last_input_ms) {
+  u32 timeout_ms = timer->timeout_ms;
+  if (RTCM3_EPOCH_TIMEOUT_AUTO == timeout_ms) {
+    timeout_ms = (stream->epoch_period_ms > 0) ? stream->epoch_period_ms / 2
+                                               : RTCM3_EPOCH_TIMEOUT_DEFAULT_MS;
+  }
+  return timer->now_ms - last_input_ms >= timeout_ms;
+}
+
+/* Return true for the late messages of an epoch already flushed on timeout */
+static bool epoch_timer_is_late(struct rtcm3_epoch_timer *timer,
+                                const struct rtcm3_epoch_stream *stream,
+                                const sbp_gps_time_t *t) {
+  if (stream->last_epoch_forced &&
+      sbp_diff_time(t, &stream->last_epoch) <= 0) {
+    timer->n_late_msgs++;
+    return true;
+  }
+  return false;
+}
+
 static u16 rtcm_stn_to_sbp_sender_id(u16 rtcm_id) {
   /* To avoid conflicts with reserved low number sender ID's we or
    * on the highest nibble as RTCM sender ID's are 12 bit */
@@ -134,26 +307,149 @@ static u16 sbp_sender_to_rtcm_stn_id(u16 sbp_id) {
   return sbp_id & 0x0FFF;
 }
 
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+static void reorder_add(struct rtcm3_station_buffer *station,
+                        const msg_obs_t *new_sbp_obs,
+                        struct rtcm3_sbp_state *state);
+static void reorder_flush_station(struct rtcm3_station_buffer *station,
+                                  struct rtcm3_sbp_state *state);
+#endif
+
+/* Return the epoch buffer of the station, NULL if it has none */
+static struct rtcm3_station_buffer *find_station(
+    u16 sender_id, struct rtcm3_sbp_state *state) {
+  for (u8 i = 0; i < RTCM3_MAX_STATIONS; i++) {
+    struct rtcm3_station_buffer *station = &state->stations[i];
+    if (station->in_use && station->sender_id == sender_id) {
+      station->last_used = ++state->station_use_count;
+      return station;
+    }
+  }
+  return NULL;
+}
+
+/* Return the epoch buffer of the station. A new station takes a free buffer,
+ * or the one of the least recently used station after sending out its
+ * pending epoch. */
+static struct rtcm3_station_buffer *get_station(
+    u16 sender_id, struct rtcm3_sbp_state *state) {
+  struct rtcm3_station_buffer *station = find_station(sender_id, state);
+  if (NULL != station) {
+    return station;
+  }
+
+  station = &state->stations[0];
+  for (u8 i = 1; i < RTCM3_MAX_STATIONS && station->in_use; i++) {
+    if (!state->stations[i].in_use ||
+        state->stations[i].last_used < station->last_used) {
+      station = &state->stations[i];
+    }
+  }
+  if (station->in_use) {
+    send_observations(station, state);
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+    reorder_flush_station(station, state);
+#endif
+  }
+
+  memset(station, 0, sizeof(*station));
+  station->in_use = true;
+  station->sender_id = sender_id;
+  station->last_used = ++state->station_use_count;
+  station->last_gps_time.wn = INVALID_TIME;
+  station->last_glo_time.wn = INVALID_TIME;
+  return station;
+}
+
+/* Check the epoch time of an observation message against the decimation grid,
+ * reading only the time field so that dropped frames are never decoded.
+ * Returns false for other messages and for epochs that cannot be placed on
+ * the GPS time grid yet. */
+static bool obs_off_grid(const uint8_t *payload,
+                         u16 message_type,
+                         const struct rtcm3_sbp_state *state) {
+  s64 tow_ms;
+  bool glo = false;
+  if (gps_obs_message(message_type)) {
+    tow_ms = rtcm_getbitu(payload, RTCM_EPOCH_TIME_OFFSET, 30);
+  } else if (glo_obs_message(message_type)) {
+    tow_ms = rtcm_getbitu(payload, RTCM_EPOCH_TIME_OFFSET, 27);
+    glo = true;
+  } else if (message_type >= MSM_MSG_TYPE_MIN &&
+             message_type <= MSM_MSG_TYPE_MAX) {
+    switch (to_constellation(message_type)) {
+      case RTCM_CONSTELLATION_GPS:
+      case RTCM_CONSTELLATION_SBAS:
+      case RTCM_CONSTELLATION_QZS:
+      case RTCM_CONSTELLATION_GAL:
+        tow_ms = rtcm_getbitu(payload, RTCM_EPOCH_TIME_OFFSET, 30);
+        break;
+      case RTCM_CONSTELLATION_BDS:
+        tow_ms = rtcm_getbitu(payload, RTCM_EPOCH_TIME_OFFSET, 30) +
+                 BDS_SECOND_TO_GPS_SECOND * S_TO_MS;
+        break;
+      case RTCM_CONSTELLATION_GLO:
+        /* skip the day of week DF416 */
+        tow_ms = rtcm_getbitu(payload, RTCM_EPOCH_TIME_OFFSET + 3, 27);
+        glo = true;
+        break;
+      case RTCM_CONSTELLATION_INVALID:
+      case RTCM_CONSTELLATION_COUNT:
+      default:
+        return false;
+    }
+  } else {
+    return false;
+  }
+
+  if (glo) {
+    /* without the day of week only the time of day can be compared */
+    if (!state->leap_second_known ||
+        (SEC_IN_DAY * S_TO_MS) % state->decimation_ms != 0) {
+      return false;
+    }
+    tow_ms += (state->leap_seconds - UTC_SU_OFFSET * SEC_IN_HOUR) * S_TO_MS;
+  }
+
+  s64 offset_ms = tow_ms % state->decimation_ms;
+  if (offset_ms < 0) {
+    offset_ms += state->decimation_ms;
+  }
+  return 0 != offset_ms;
+}
+
 void rtcm2sbp_decode_payload(const uint8_t *payload,
                              uint32_t payload_length,
                              struct rtcm3_sbp_state *state) {
   (void)payload_length;
 
   if (!gps_time_valid(&state->time_from_rover_obs)) {
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_NO_TIME, 1);
     return;
   }
 
+  u64 start_ns = gnssc_stats_now(state->stats);
   uint16_t byte = 0;
   uint16_t message_type =
       (payload[byte] << 4) | ((payload[byte + 1] >> 4) & 0xf);
 
+  if (state->decimation_ms > 0 &&
+      obs_off_grid(&payload[byte], message_type, state)) {
+    state->n_decimated_frames++;
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_DECIMATED, 1);
+    return;
+  }
+
+  rtcm3_rc rc = RC_OK;
+  GNSSC_TRACE_BEGIN(state->trace, GNSSC_TRACE_DECODE, message_type);
   switch (message_type) {
     case 1001:
     case 1003:
       break;
     case 1002: {
       rtcm_obs_message new_rtcm_obs;
-      if (RC_OK == rtcm3_decode_1002(&payload[byte], &new_rtcm_obs)) {
+      rc = rtcm3_decode_1002(&payload[byte], &new_rtcm_obs);
+      if (RC_OK == rc) {
         /* Need to check if we've got obs in the buffer from the previous epoch
          and send before accepting the new message */
         add_gps_obs_to_buffer(&new_rtcm_obs, state);
@@ -162,7 +458,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     }
     case 1004: {
       rtcm_obs_message new_rtcm_obs;
-      if (RC_OK == rtcm3_decode_1004(&payload[byte], &new_rtcm_obs)) {
+      rc = rtcm3_decode_1004(&payload[byte], &new_rtcm_obs);
+      if (RC_OK == rc) {
         /* Need to check if we've got obs in the buffer from the previous epoch
          and send before accepting the new message */
         add_gps_obs_to_buffer(&new_rtcm_obs, state);
@@ -171,28 +468,29 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     }
     case 1005: {
       rtcm_msg_1005 msg_1005;
-      if (RC_OK == rtcm3_decode_1005(&payload[byte], &msg_1005)) {
+      rc = rtcm3_decode_1005(&payload[byte], &msg_1005);
+      if (RC_OK == rc) {
         msg_base_pos_ecef_t sbp_base_pos;
         rtcm3_1005_to_sbp(&msg_1005, &sbp_base_pos);
-        state->cb_rtcm_to_sbp(SBP_MSG_BASE_POS_ECEF,
-                              (u8)sizeof(sbp_base_pos),
-                              (u8 *)&sbp_base_pos,
-                              rtcm_stn_to_sbp_sender_id(msg_1005.stn_id),
-                              state->context);
+        send_sbp_msg(SBP_MSG_BASE_POS_ECEF,
+                     (u8)sizeof(sbp_base_pos),
+                     (u8 *)&sbp_base_pos,
+                     rtcm_stn_to_sbp_sender_id(msg_1005.stn_id),
+                     state);
       }
       break;
     }
     case 1006: {
       rtcm_msg_1006 msg_1006;
-      if (RC_OK == rtcm3_decode_1006(&payload[byte], &msg_1006)) {
+      rc = rtcm3_decode_1006(&payload[byte], &msg_1006);
+      if (RC_OK == rc) {
         msg_base_pos_ecef_t sbp_base_pos;
         rtcm3_1006_to_sbp(&msg_1006, &sbp_base_pos);
-        state->cb_rtcm_to_sbp(
-            SBP_MSG_BASE_POS_ECEF,
-            (u8)sizeof(sbp_base_pos),
-            (u8 *)&sbp_base_pos,
-            rtcm_stn_to_sbp_sender_id(msg_1006.msg_1005.stn_id),
-            state->context);
+        send_sbp_msg(SBP_MSG_BASE_POS_ECEF,
+                     (u8)sizeof(sbp_base_pos),
+                     (u8 *)&sbp_base_pos,
+                     rtcm_stn_to_sbp_sender_id(msg_1006.msg_1005.stn_id),
+                     state);
       }
       break;
     }
@@ -201,120 +499,127 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
       break;
     case 1010: {
       rtcm_obs_message new_rtcm_obs;
-      if (RC_OK == rtcm3_decode_1010(&payload[byte], &new_rtcm_obs) &&
-          state->leap_second_known) {
+      rc = rtcm3_decode_1010(&payload[byte], &new_rtcm_obs);
+      if (RC_OK == rc && state->leap_second_known) {
         add_glo_obs_to_buffer(&new_rtcm_obs, state);
       }
       break;
     }
     case 1012: {
       rtcm_obs_message new_rtcm_obs;
-      if (RC_OK == rtcm3_decode_1012(&payload[byte], &new_rtcm_obs) &&
-          state->leap_second_known) {
+      rc = rtcm3_decode_1012(&payload[byte], &new_rtcm_obs);
+      if (RC_OK == rc && state->leap_second_known) {
         add_glo_obs_to_buffer(&new_rtcm_obs, state);
       }
       break;
     }
     case 1019: {
       rtcm_msg_eph msg_eph;
-      if (RC_OK == rtcm3_decode_gps_eph(&payload[byte], &msg_eph)) {
+      rc = rtcm3_decode_gps_eph(&payload[byte], &msg_eph);
+      if (RC_OK == rc) {
         msg_ephemeris_gps_t sbp_gps_eph;
         rtcm3_gps_eph_to_sbp(&msg_eph, &sbp_gps_eph, state);
-        state->cb_rtcm_to_sbp(SBP_MSG_EPHEMERIS_GPS,
-                              (u8)sizeof(sbp_gps_eph),
-                              (u8 *)&sbp_gps_eph,
-                              rtcm_stn_to_sbp_sender_id(0),
-                              state->context);
+        send_sbp_msg(SBP_MSG_EPHEMERIS_GPS,
+                     (u8)sizeof(sbp_gps_eph),
+                     (u8 *)&sbp_gps_eph,
+                     rtcm_stn_to_sbp_sender_id(0),
+                     state);
         rtcm2sbp_set_leap_second_from_wn(sbp_gps_eph.common.toe.wn, state);
       }
       break;
     }
     case 1020: {
       rtcm_msg_eph msg_eph;
-      if (RC_OK == rtcm3_decode_glo_eph(&payload[byte], &msg_eph)) {
+      rc = rtcm3_decode_glo_eph(&payload[byte], &msg_eph);
+      if (RC_OK == rc) {
         msg_ephemeris_glo_t sbp_glo_eph;
         rtcm3_glo_eph_to_sbp(&msg_eph, &sbp_glo_eph, state);
         rtcm2sbp_set_glo_fcn(sbp_glo_eph.common.sid, sbp_glo_eph.fcn, state);
-        state->cb_rtcm_to_sbp(SBP_MSG_EPHEMERIS_GLO,
-                              (u8)sizeof(sbp_glo_eph),
-                              (u8 *)&sbp_glo_eph,
-                              rtcm_stn_to_sbp_sender_id(0),
-                              state->context);
+        send_sbp_msg(SBP_MSG_EPHEMERIS_GLO,
+                     (u8)sizeof(sbp_glo_eph),
+                     (u8 *)&sbp_glo_eph,
+                     rtcm_stn_to_sbp_sender_id(0),
+                     state);
       }
       break;
     }
     case 1045: {
       rtcm_msg_eph msg_eph;
-      if (RC_OK == rtcm3_decode_gal_eph_fnav(&payload[byte], &msg_eph)) {
+      rc = rtcm3_decode_gal_eph_fnav(&payload[byte], &msg_eph);
+      if (RC_OK == rc) {
         msg_ephemeris_gal_t sbp_gal_eph;
         rtcm3_gal_eph_to_sbp(&msg_eph, &sbp_gal_eph, state);
-        state->cb_rtcm_to_sbp(SBP_MSG_EPHEMERIS_GAL,
-                              (u8)sizeof(sbp_gal_eph),
-                              (u8 *)&sbp_gal_eph,
-                              rtcm_stn_to_sbp_sender_id(0),
-                              state->context);
+        send_sbp_msg(SBP_MSG_EPHEMERIS_GAL,
+                     (u8)sizeof(sbp_gal_eph),
+                     (u8 *)&sbp_gal_eph,
+                     rtcm_stn_to_sbp_sender_id(0),
+                     state);
         rtcm2sbp_set_leap_second_from_wn(sbp_gal_eph.common.toe.wn, state);
       }
       break;
     }
     case 1042: {
       rtcm_msg_eph msg_eph;
-      if (RC_OK == rtcm3_decode_bds_eph(&payload[byte], &msg_eph)) {
+      rc = rtcm3_decode_bds_eph(&payload[byte], &msg_eph);
+      if (RC_OK == rc) {
         msg_ephemeris_bds_t sbp_bds_eph;
         rtcm3_bds_eph_to_sbp(&msg_eph, &sbp_bds_eph, state);
-        state->cb_rtcm_to_sbp(SBP_MSG_EPHEMERIS_BDS,
-                              (u8)sizeof(sbp_bds_eph),
-                              (u8 *)&sbp_bds_eph,
-                              rtcm_stn_to_sbp_sender_id(0),
-                              state->context);
+        send_sbp_msg(SBP_MSG_EPHEMERIS_BDS,
+                     (u8)sizeof(sbp_bds_eph),
+                     (u8 *)&sbp_bds_eph,
+                     rtcm_stn_to_sbp_sender_id(0),
+                     state);
       }
       break;
     }
     case 1046: {
       rtcm_msg_eph msg_eph;
-      if (RC_OK == rtcm3_decode_gal_eph(&payload[byte], &msg_eph)) {
+      rc = rtcm3_decode_gal_eph(&payload[byte], &msg_eph);
+      if (RC_OK == rc) {
         msg_ephemeris_gal_t sbp_gal_eph;
         rtcm3_gal_eph_to_sbp(&msg_eph, &sbp_gal_eph, state);
-        state->cb_rtcm_to_sbp(SBP_MSG_EPHEMERIS_GAL,
-                              (u8)sizeof(sbp_gal_eph),
-                              (u8 *)&sbp_gal_eph,
-                              rtcm_stn_to_sbp_sender_id(0),
-                              state->context);
+        send_sbp_msg(SBP_MSG_EPHEMERIS_GAL,
+                     (u8)sizeof(sbp_gal_eph),
+                     (u8 *)&sbp_gal_eph,
+                     rtcm_stn_to_sbp_sender_id(0),
+                     state);
         rtcm2sbp_set_leap_second_from_wn(sbp_gal_eph.common.toe.wn, state);
       }
       break;
     }
     case 1029: {
       rtcm_msg_1029 msg_1029;
-      if (RC_OK == rtcm3_decode_1029(&payload[byte], &msg_1029)) {
+      rc = rtcm3_decode_1029(&payload[byte], &msg_1029);
+      if (RC_OK == rc) {
         send_1029(&msg_1029, state);
       }
       break;
     }
     case 1033: {
       rtcm_msg_1033 msg_1033;
-      if (RC_OK == rtcm3_decode_1033(&payload[byte], &msg_1033) &&
-          no_1230_received(state)) {
+      rc = rtcm3_decode_1033(&payload[byte], &msg_1033);
+      if (RC_OK == rc && no_1230_received(state)) {
         msg_glo_biases_t sbp_glo_cpb;
         rtcm3_1033_to_sbp(&msg_1033, &sbp_glo_cpb);
-        state->cb_rtcm_to_sbp(SBP_MSG_GLO_BIASES,
-                              (u8)sizeof(sbp_glo_cpb),
-                              (u8 *)&sbp_glo_cpb,
-                              rtcm_stn_to_sbp_sender_id(msg_1033.stn_id),
-                              state->context);
+        send_sbp_msg(SBP_MSG_GLO_BIASES,
+                     (u8)sizeof(sbp_glo_cpb),
+                     (u8 *)&sbp_glo_cpb,
+                     rtcm_stn_to_sbp_sender_id(msg_1033.stn_id),
+                     state);
       }
       break;
     }
     case 1230: {
       rtcm_msg_1230 msg_1230;
-      if (RC_OK == rtcm3_decode_1230(&payload[byte], &msg_1230)) {
+      rc = rtcm3_decode_1230(&payload[byte], &msg_1230);
+      if (RC_OK == rc) {
         msg_glo_biases_t sbp_glo_cpb;
         rtcm3_1230_to_sbp(&msg_1230, &sbp_glo_cpb);
-        state->cb_rtcm_to_sbp(SBP_MSG_GLO_BIASES,
-                              (u8)sizeof(sbp_glo_cpb),
-                              (u8 *)&sbp_glo_cpb,
-                              rtcm_stn_to_sbp_sender_id(msg_1230.stn_id),
-                              state->context);
+        send_sbp_msg(SBP_MSG_GLO_BIASES,
+                     (u8)sizeof(sbp_glo_cpb),
+                     (u8 *)&sbp_glo_cpb,
+                     rtcm_stn_to_sbp_sender_id(msg_1230.stn_id),
+                     state);
         state->last_1230_received = state->time_from_rover_obs;
       }
       break;
@@ -325,7 +630,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     case 1248:
     case 1260: {
       rtcm_msg_code_bias msg_code_bias;
-      if (RC_OK == rtcm3_decode_code_bias(&payload[byte], &msg_code_bias)) {
+      rc = rtcm3_decode_code_bias(&payload[byte], &msg_code_bias);
+      if (RC_OK == rc) {
         rtcm3_ssr_code_bias_to_sbp(&msg_code_bias, state);
       }
       break;
@@ -336,7 +642,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     case 1249:
     case 1261: {
       rtcm_msg_orbit_clock msg_orbit_clock;
-      if (RC_OK == rtcm3_decode_orbit_clock(&payload[byte], &msg_orbit_clock)) {
+      rc = rtcm3_decode_orbit_clock(&payload[byte], &msg_orbit_clock);
+      if (RC_OK == rc) {
         rtcm3_ssr_orbit_clock_to_sbp(&msg_orbit_clock, state);
       }
       break;
@@ -348,7 +655,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     case 1269:
     case 1270: {
       rtcm_msg_phase_bias msg_phase_bias;
-      if (RC_OK == rtcm3_decode_phase_bias(&payload[byte], &msg_phase_bias)) {
+      rc = rtcm3_decode_phase_bias(&payload[byte], &msg_phase_bias);
+      if (RC_OK == rc) {
         rtcm3_ssr_phase_bias_to_sbp(&msg_phase_bias, state);
       }
       break;
@@ -358,7 +666,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     case 1094:
     case 1124: {
       rtcm_msm_message new_rtcm_msm;
-      if (RC_OK == rtcm3_decode_msm4(&payload[byte], &new_rtcm_msm)) {
+      rc = rtcm3_decode_msm4(&payload[byte], &new_rtcm_msm);
+      if (RC_OK == rc) {
         add_msm_obs_to_buffer(&new_rtcm_msm, state);
       }
       break;
@@ -368,7 +677,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     case 1095:
     case 1125: {
       rtcm_msm_message new_rtcm_msm;
-      if (RC_OK == rtcm3_decode_msm5(&payload[byte], &new_rtcm_msm)) {
+      rc = rtcm3_decode_msm5(&payload[byte], &new_rtcm_msm);
+      if (RC_OK == rc) {
         add_msm_obs_to_buffer(&new_rtcm_msm, state);
       }
       break;
@@ -378,7 +688,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     case 1096:
     case 1126: {
       rtcm_msm_message new_rtcm_msm;
-      if (RC_OK == rtcm3_decode_msm6(&payload[byte], &new_rtcm_msm)) {
+      rc = rtcm3_decode_msm6(&payload[byte], &new_rtcm_msm);
+      if (RC_OK == rc) {
         add_msm_obs_to_buffer(&new_rtcm_msm, state);
       }
       break;
@@ -388,7 +699,8 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     case 1097:
     case 1127: {
       rtcm_msm_message new_rtcm_msm;
-      if (RC_OK == rtcm3_decode_msm7(&payload[byte], &new_rtcm_msm)) {
+      rc = rtcm3_decode_msm7(&payload[byte], &new_rtcm_msm);
+      if (RC_OK == rc) {
         add_msm_obs_to_buffer(&new_rtcm_msm, state);
       }
       break;
@@ -432,15 +744,23 @@ void rtcm2sbp_decode_payload(const uint8_t *payload,
     default:
       break;
   }
+  GNSSC_TRACE_END(state->trace, GNSSC_TRACE_DECODE, message_type);
 
   /* check if the message was the final MSM message in the epoch, and if so send
    * out the SBP buffer */
   if (message_type >= MSM_MSG_TYPE_MIN && message_type <= MSM_MSG_TYPE_MAX) {
     /* The Multiple message bit DF393 is the same regardless of MSM msg type */
     if (rtcm_getbitu(&payload[byte], MSM_MULTIPLE_BIT_OFFSET, 1) == 0) {
-      send_observations(state);
+      u16 stn_id = rtcm_getbitu(&payload[byte], RTCM_STN_ID_OFFSET, 12);
+      struct rtcm3_station_buffer *station =
+          find_station(rtcm_stn_to_sbp_sender_id(stn_id), state);
+      if (NULL != station) {
+        send_observations(station, state);
+      }
     }
   }
+
+  gnssc_stats_msg_done(state->stats, message_type, RC_OK != rc, start_ns);
 }
 
 void rtcm2sbp_decode_frame(const uint8_t *frame,
@@ -461,6 +781,34 @@ void rtcm2sbp_decode_frame(const uint8_t *frame,
   rtcm2sbp_decode_payload(&frame[byte], message_size, state);
 }
 
+u16 rtcm2sbp_push(const uint8_t *frame,
+                  uint32_t frame_length,
+                  struct rtcm3_sbp_state *state) {
+  assert(NULL == state->cb_rtcm_to_sbp);
+  rtcm2sbp_decode_frame(frame, frame_length, state);
+  return state->queue.count;
+}
+
+bool rtcm2sbp_next(struct rtcm2sbp_msg *msg, struct rtcm3_sbp_state *state) {
+  struct rtcm3_sbp_queue *queue = &state->queue;
+  if (0 == queue->count) {
+    return false;
+  }
+  if (queue->tail < queue->head && queue->head == queue->wrap) {
+    queue->head = 0;
+  }
+
+  const u8 *entry = &queue->data[queue->head];
+  msg->msg_id = (u16)(entry[0] | (entry[1] << 8));
+  msg->sender_id = (u16)(entry[2] | (entry[3] << 8));
+  msg->length = entry[4];
+  msg->payload = &entry[RTCM3_SBP_QUEUE_HDR_SIZE];
+
+  queue->head += RTCM3_SBP_QUEUE_HDR_SIZE + msg->length;
+  queue->count--;
+  return true;
+}
+
 /* check if there was a MSM message decoded within the MSM timeout period */
 static bool is_msm_active(const gps_time_t *current_time,
                           const struct rtcm3_sbp_state *state) {
@@ -523,12 +871,21 @@ static u16 encode_rtcm3_payload(const void *rtcm_msg,
 }
 
 /* Encode RTCM frame into the given buffer, returns frame length */
-u16 encode_rtcm3_frame(const void *rtcm_msg, u16 message_type, u8 *frame) {
+u16 encode_rtcm3_frame(const void *rtcm_msg,
+                       u16 message_type,
+                       u8 *frame,
+                       struct rtcm3_out_state *state) {
   u16 byte = 3;
   u16 message_size = encode_rtcm3_payload(rtcm_msg, message_type, &frame[byte]);
 
   if (0 == message_size) {
-    fprintf(stderr, "Error encoding RTCM message %u\n", message_type);
+    gnssc_diag_report(&state->diag,
+                      GNSSC_DIAG_RTCM_ENCODE_FAILED,
+                      sbp_sender_to_rtcm_stn_id(state->sender_id),
+                      message_type,
+                      0,
+                      0,
+                      0);
     return 0;
   }
 
@@ -561,18 +918,23 @@ void add_glo_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
 
   if (!gps_time_valid(&obs_time)) {
     /* invalid GLO time */
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_INVALID_TIME, 1);
     return;
   }
 
   if (is_msm_active(&obs_time, state)) {
     /* Stream potentially contains also MSM observations, so discard the legacy
      * observation messages */
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_MSM_ACTIVE, 1);
     return;
   }
 
-  if (!gps_time_valid(&state->last_glo_time) ||
-      gpsdifftime(&obs_time, &state->last_glo_time) > MS_TO_S / 2) {
-    state->last_glo_time = obs_time;
+  struct rtcm3_station_buffer *station = get_station(
+      rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id), state);
+  /* with the reorder window older epochs are still accepted */
+  if (state->reorder_window > 0 || !gps_time_valid(&station->last_glo_time) ||
+      gpsdifftime(&obs_time, &station->last_glo_time) > MS_TO_S / 2) {
+    station->last_glo_time = obs_time;
     add_obs_to_buffer(new_rtcm_obs, &obs_time, state);
   }
 }
@@ -589,12 +951,16 @@ void add_gps_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
   if (is_msm_active(&obs_time, state)) {
     /* Stream potentially contains also MSM observations, so discard the legacy
      * observation messages */
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_MSM_ACTIVE, 1);
     return;
   }
 
-  if (!gps_time_valid(&state->last_gps_time) ||
-      gpsdifftime(&obs_time, &state->last_gps_time) > MS_TO_S / 2) {
-    state->last_gps_time = obs_time;
+  struct rtcm3_station_buffer *station = get_station(
+      rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id), state);
+  /* with the reorder window older epochs are still accepted */
+  if (state->reorder_window > 0 || !gps_time_valid(&station->last_gps_time) ||
+      gpsdifftime(&obs_time, &station->last_gps_time) > MS_TO_S / 2) {
+    station->last_gps_time = obs_time;
     add_obs_to_buffer(new_rtcm_obs, &obs_time, state);
   }
 }
@@ -608,31 +974,54 @@ void add_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
   msg_obs_t *new_sbp_obs = (msg_obs_t *)(new_obs);
 
   /* Find the buffer of obs to be sent */
-  msg_obs_t *sbp_obs_buffer = (msg_obs_t *)state->obs_buffer;
+  struct rtcm3_station_buffer *station = get_station(
+      rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id), state);
+  msg_obs_t *sbp_obs_buffer = (msg_obs_t *)station->obs_buffer;
 
   /* Build an SBP time stamp */
   new_sbp_obs->header.t.wn = obs_time->wn;
   new_sbp_obs->header.t.tow = (u32)rint(obs_time->tow * S_TO_MS);
   new_sbp_obs->header.t.ns_residual = 0;
 
+  if (0 == sbp_obs_buffer->header.n_obs &&
+      epoch_timer_is_late(
+          &state->epoch_timer, &station->epoch, &new_sbp_obs->header.t)) {
+    /* the epoch has already been flushed by rtcm2sbp_tick() */
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_LATE, 1);
+    return;
+  }
+
+  GNSSC_TRACE_BEGIN(
+      state->trace, GNSSC_TRACE_CONVERT, new_rtcm_obs->header.msg_num);
   rtcm3_to_sbp(new_rtcm_obs, new_sbp_obs, state);
+  GNSSC_TRACE_END(
+      state->trace, GNSSC_TRACE_CONVERT, new_rtcm_obs->header.msg_num);
+  gnssc_stats_obs(state->stats, new_sbp_obs->header.n_obs, 0);
+
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+  if (state->reorder_window > 0) {
+    reorder_add(station, new_sbp_obs, state);
+    return;
+  }
+#endif
 
   /* Check if the buffer already has obs of the same time */
   if (sbp_obs_buffer->header.n_obs != 0 &&
-      (sbp_obs_buffer->header.t.tow != new_sbp_obs->header.t.tow ||
-       state->sender_id !=
-           rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id))) {
-    /* We either have missed a message, or we have a new station. Either way,
-     send through the current buffer and clear before adding new obs */
-    send_observations(state);
+      sbp_obs_buffer->header.t.tow != new_sbp_obs->header.t.tow) {
+    /* We have missed a message, send through the current buffer and clear
+     * before adding new obs */
+    send_observations(station, state);
   }
 
   /* Copy new obs into buffer */
   u8 obs_index_buffer = sbp_obs_buffer->header.n_obs;
-  state->sender_id = rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id);
+  state->sender_id = station->sender_id;
   for (u8 obs_count = 0; obs_count < new_sbp_obs->header.n_obs; obs_count++) {
     if (obs_index_buffer >= MAX_OBS_PER_EPOCH) {
       send_buffer_full_error(state);
+      gnssc_stats_drop(state->stats,
+                       GNSSC_STATS_DROP_BUFFER_FULL,
+                       new_sbp_obs->header.n_obs - obs_count);
       break;
     }
 
@@ -641,18 +1030,22 @@ void add_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
   }
   sbp_obs_buffer->header.n_obs = obs_index_buffer;
   sbp_obs_buffer->header.t = new_sbp_obs->header.t;
+  epoch_timer_input(&state->epoch_timer, &station->epoch);
 
   /* If we aren't expecting another message, send the buffer */
   if (0 == new_rtcm_obs->header.sync) {
-    send_observations(state);
+    send_observations(station, state);
   }
 }
 
 /**
  * Split the observation buffer into SBP messages and send them
  */
-void send_observations(struct rtcm3_sbp_state *state) {
-  const msg_obs_t *sbp_obs_buffer = (msg_obs_t *)state->obs_buffer;
+static void send_obs_buffer(u8 obs_buffer[],
+                            u16 sender_id,
+                            struct rtcm3_epoch_stream *stream,
+                            struct rtcm3_sbp_state *state) {
+  const msg_obs_t *sbp_obs_buffer = (msg_obs_t *)obs_buffer;
 
   if (sbp_obs_buffer->header.n_obs == 0) {
     return;
@@ -665,6 +1058,8 @@ void send_observations(struct rtcm3_sbp_state *state) {
 
   assert(sbp_obs_buffer->header.n_obs <= MAX_OBS_PER_EPOCH);
   assert(total_messages <= SBP_MAX_OBS_SEQ);
+  gnssc_stats_obs(state->stats, 0, sbp_obs_buffer->header.n_obs);
+  GNSSC_TRACE_BEGIN(state->trace, GNSSC_TRACE_SEND_OBS, SBP_MSG_OBS);
 
   /* Write the SBP observation messages */
   u8 buffer_obs_index = 0;
@@ -690,13 +1085,164 @@ void send_observations(struct rtcm3_sbp_state *state) {
     u16 len = SBP_HDR_SIZE + obs_index * SBP_OBS_SIZE;
     assert(len <= SBP_FRAMING_MAX_PAYLOAD_SIZE);
 
-    state->cb_rtcm_to_sbp(
-        SBP_MSG_OBS, len, obs_data, state->sender_id, state->context);
+    send_sbp_msg(SBP_MSG_OBS, len, obs_data, sender_id, state);
   }
+  epoch_timer_sent(stream, &sbp_obs_buffer->header.t);
+
   /* clear the observation buffer, so also header.n_obs is set to zero */
-  memset(state->obs_buffer, 0, OBS_BUFFER_SIZE);
+  memset(obs_buffer, 0, OBS_BUFFER_SIZE);
+  GNSSC_TRACE_END(state->trace, GNSSC_TRACE_SEND_OBS, SBP_MSG_OBS);
+}
+
+void send_observations(struct rtcm3_station_buffer *station,
+                       struct rtcm3_sbp_state *state) {
+  send_obs_buffer(
+      station->obs_buffer, station->sender_id, &station->epoch, state);
+}
+
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+/* Return the oldest epoch of the station held by the reorder window, NULL if
+ * there is none */
+static struct rtcm3_reorder_slot *reorder_oldest(
+    const struct rtcm3_station_buffer *station, struct rtcm3_sbp_state *state) {
+  struct rtcm3_reorder_slot *oldest = NULL;
+  for (u8 i = 0; i < RTCM3_REORDER_MAX_EPOCHS; i++) {
+    struct rtcm3_reorder_slot *slot = &state->reorder_slots[i];
+    if (!slot->in_use || slot->sender_id != station->sender_id) {
+      continue;
+    }
+    const msg_obs_t *obs = (msg_obs_t *)slot->obs_buffer;
+    if (NULL == oldest ||
+        sbp_diff_time(&obs->header.t,
+                      &((msg_obs_t *)oldest->obs_buffer)->header.t) < 0) {
+      oldest = slot;
+    }
+  }
+  return oldest;
+}
+
+static void reorder_send(struct rtcm3_station_buffer *station,
+                         struct rtcm3_reorder_slot *slot,
+                         struct rtcm3_sbp_state *state) {
+  send_obs_buffer(slot->obs_buffer, slot->sender_id, &station->epoch, state);
+  slot->in_use = false;
 }
 
+/* Send all the epochs of the station held by the reorder window */
+static void reorder_flush_station(struct rtcm3_station_buffer *station,
+                                  struct rtcm3_sbp_state *state) {
+  struct rtcm3_reorder_slot *slot;
+  while (NULL != (slot = reorder_oldest(station, state))) {
+    reorder_send(station, slot, state);
+  }
+}
+
+/* Merge the observations into their epoch in the reorder window, and send
+ * the oldest epochs of the station that no longer fit in the window */
+static void reorder_add(struct rtcm3_station_buffer *station,
+                        const msg_obs_t *new_sbp_obs,
+                        struct rtcm3_sbp_state *state) {
+  const sbp_gps_time_t *t = &new_sbp_obs->header.t;
+  if (station->epoch.last_epoch_valid &&
+      sbp_diff_time(t, &station->epoch.last_epoch) <= 0) {
+    /* the epoch has already been sent */
+    state->epoch_timer.n_late_msgs++;
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_LATE, 1);
+    return;
+  }
+
+  struct rtcm3_reorder_slot *slot = NULL;
+  struct rtcm3_reorder_slot *free_slot = NULL;
+  u8 n_pending = 0;
+  bool newer_pending = false;
+  for (u8 i = 0; i < RTCM3_REORDER_MAX_EPOCHS; i++) {
+    struct rtcm3_reorder_slot *other = &state->reorder_slots[i];
+    if (!other->in_use) {
+      free_slot = (NULL == free_slot) ? other : free_slot;
+      continue;
+    }
+    if (other->sender_id != station->sender_id) {
+      continue;
+    }
+    const sbp_gps_time_t *other_t =
+        &((msg_obs_t *)other->obs_buffer)->header.t;
+    if (other_t->wn == t->wn && other_t->tow == t->tow) {
+      slot = other;
+    } else if (sbp_diff_time(t, other_t) < 0) {
+      newer_pending = true;
+    }
+    n_pending++;
+  }
+
+  if (NULL == slot) {
+    if (NULL == free_slot) {
+      /* window full, make room by sending the oldest epoch of any station */
+      struct rtcm3_reorder_slot *oldest = NULL;
+      for (u8 i = 0; i < RTCM3_REORDER_MAX_EPOCHS; i++) {
+        struct rtcm3_reorder_slot *other = &state->reorder_slots[i];
+        if (NULL == oldest ||
+            sbp_diff_time(&((msg_obs_t *)other->obs_buffer)->header.t,
+                          &((msg_obs_t *)oldest->obs_buffer)->header.t) < 0) {
+          oldest = other;
+        }
+      }
+      struct rtcm3_station_buffer *owner =
+          find_station(oldest->sender_id, state);
+      assert(NULL != owner);
+      reorder_send(owner, oldest, state);
+      if (owner == station) {
+        n_pending--;
+        if (station->epoch.last_epoch_valid &&
+            sbp_diff_time(t, &station->epoch.last_epoch) <= 0) {
+          /* the new observations were older than the evicted epoch */
+          state->epoch_timer.n_late_msgs++;
+          gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_LATE, 1);
+          return;
+        }
+      }
+      free_slot = oldest;
+    }
+    slot = free_slot;
+    memset(slot->obs_buffer, 0, OBS_BUFFER_SIZE);
+    slot->in_use = true;
+    slot->sender_id = station->sender_id;
+    ((msg_obs_t *)slot->obs_buffer)->header.t = *t;
+    n_pending++;
+  }
+  if (newer_pending) {
+    state->n_reordered_msgs++;
+  }
+
+  /* merge, skipping signals the epoch already has */
+  msg_obs_t *sbp_obs_buffer = (msg_obs_t *)slot->obs_buffer;
+  u8 n_obs = sbp_obs_buffer->header.n_obs;
+  for (u8 i = 0; i < new_sbp_obs->header.n_obs; i++) {
+    const packed_obs_content_t *obs = &new_sbp_obs->obs[i];
+    bool duplicate = false;
+    for (u8 j = 0; j < n_obs && !duplicate; j++) {
+      duplicate = sbp_obs_buffer->obs[j].sid.sat == obs->sid.sat &&
+                  sbp_obs_buffer->obs[j].sid.code == obs->sid.code;
+    }
+    if (duplicate) {
+      continue;
+    }
+    if (n_obs >= MAX_OBS_PER_EPOCH) {
+      send_buffer_full_error(state);
+      break;
+    }
+    sbp_obs_buffer->obs[n_obs++] = *obs;
+  }
+  sbp_obs_buffer->header.n_obs = n_obs;
+  slot->last_input_ms = state->epoch_timer.now_ms;
+  state->sender_id = station->sender_id;
+
+  while (n_pending > state->reorder_window) {
+    reorder_send(station, reorder_oldest(station, state), state);
+    n_pending--;
+  }
+}
+#endif
+
 bool gps_obs_message(u16 msg_num) {
   if (msg_num == 1001 || msg_num == 1002 || msg_num == 1003 ||
       msg_num == 1004) {
@@ -1167,13 +1713,13 @@ void sbp_to_rtcm3_1230(const msg_glo_biases_t *sbp_glo_bias,
 
 /* Convert from SBP FCN (1..14 with unknown marked with 0) to
  * RTCM FCN (0..13 with unknown marked with 255) */
-static u8 sbp_fcn_to_rtcm(u8 sbp_fcn) {
+static u8 sbp_fcn_to_rtcm(u8 sbp_fcn, struct gnssc_diag *diag) {
   if (SBP_GLO_FCN_UNKNOWN == sbp_fcn) {
     return MSM_GLO_FCN_UNKNOWN;
   }
   s8 rtcm_fcn = sbp_fcn + MSM_GLO_FCN_OFFSET - SBP_GLO_FCN_OFFSET;
   if (rtcm_fcn < 0 || rtcm_fcn > MSM_GLO_MAX_FCN) {
-    fprintf(stderr, "Ignoring invalid GLO FCN %d\n", sbp_fcn);
+    gnssc_diag_report(diag, GNSSC_DIAG_INVALID_GLO_FCN, 0, sbp_fcn, 0, 0, 0);
     return MSM_GLO_FCN_UNKNOWN;
   }
   return rtcm_fcn;
@@ -1209,10 +1755,83 @@ void rtcm2sbp_set_glo_fcn(sbp_gnss_signal_t sid,
   /* convert FCN from SBP representation to RTCM representation */
   if (sid.sat < GLO_FIRST_PRN || sid.sat >= GLO_FIRST_PRN + NUM_SATS_GLO) {
     /* invalid PRN */
-    fprintf(stderr, "Ignoring invalid GLO PRN %u\n", sid.sat);
+    gnssc_diag_report(
+        &state->diag, GNSSC_DIAG_INVALID_GLO_PRN, 0, sid.sat, 0, 0, 0);
     return;
   }
-  state->glo_sv_id_fcn_map[sid.sat] = sbp_fcn_to_rtcm(sbp_fcn);
+  state->glo_sv_id_fcn_map[sid.sat] = sbp_fcn_to_rtcm(sbp_fcn, &state->diag);
+}
+
+void rtcm2sbp_tick(u64 now_ms, struct rtcm3_sbp_state *state) {
+  struct rtcm3_epoch_timer *timer = &state->epoch_timer;
+
+  timer->now_ms = now_ms;
+  gnssc_diag_set_time(&state->diag, now_ms);
+
+  for (u8 i = 0; i < RTCM3_MAX_STATIONS; i++) {
+    struct rtcm3_station_buffer *station = &state->stations[i];
+    const msg_obs_t *sbp_obs_buffer = (msg_obs_t *)station->obs_buffer;
+    if (station->in_use && sbp_obs_buffer->header.n_obs > 0 &&
+        epoch_timer_expired(
+            timer, &station->epoch, station->epoch.last_input_ms)) {
+      send_observations(station, state);
+      station->epoch.last_epoch_forced = true;
+      timer->n_forced_flushes++;
+    }
+
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+    /* the reorder window releases its epochs in order, as long as the
+     * oldest one has not received data within the timeout */
+    struct rtcm3_reorder_slot *slot;
+    while (station->in_use &&
+           NULL != (slot = reorder_oldest(station, state)) &&
+           epoch_timer_expired(
+               timer, &station->epoch, slot->last_input_ms)) {
+      reorder_send(station, slot, state);
+      timer->n_forced_flushes++;
+    }
+#endif
+  }
+}
+
+bool rtcm2sbp_set_reorder_window(u8 n_epochs, struct rtcm3_sbp_state *state) {
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+  if (n_epochs >= RTCM3_REORDER_MAX_EPOCHS) {
+    return false;
+  }
+  /* send what the old window held, in order */
+  for (u8 i = 0; i < RTCM3_MAX_STATIONS; i++) {
+    if (state->stations[i].in_use) {
+      reorder_flush_station(&state->stations[i], state);
+    }
+  }
+#else
+  /* without slots the window can only be disabled */
+  if (n_epochs > 0) {
+    return false;
+  }
+#endif
+  state->reorder_window = n_epochs;
+  return true;
+}
+
+void rtcm2sbp_set_decimation(u32 interval_ms, struct rtcm3_sbp_state *state) {
+  state->decimation_ms = interval_ms;
+}
+
+void rtcm2sbp_set_stats(struct gnssc_stats *stats,
+                        struct rtcm3_sbp_state *state) {
+  state->stats = stats;
+}
+
+void rtcm2sbp_set_trace(struct gnssc_trace *trace,
+                        struct rtcm3_sbp_state *state) {
+  state->trace = trace;
+}
+
+void rtcm2sbp_set_flush_timeout(u32 timeout_ms,
+                                struct rtcm3_sbp_state *state) {
+  state->epoch_timer.timeout_ms = timeout_ms;
 }
 
 void sbp2rtcm_set_leap_second(s8 leap_seconds, struct rtcm3_out_state *state) {
@@ -1245,10 +1864,11 @@ void sbp2rtcm_set_glo_fcn(sbp_gnss_signal_t sid,
   /* convert FCN from SBP representation to RTCM representation */
   if (sid.sat < GLO_FIRST_PRN || sid.sat >= GLO_FIRST_PRN + NUM_SATS_GLO) {
     /* invalid PRN */
-    fprintf(stderr, "Ignoring invalid GLO PRN %u\n", sid.sat);
+    gnssc_diag_report(
+        &state->diag, GNSSC_DIAG_INVALID_GLO_PRN, 0, sid.sat, 0, 0, 0);
     return;
   }
-  state->glo_sv_id_fcn_map[sid.sat] = sbp_fcn_to_rtcm(sbp_fcn);
+  state->glo_sv_id_fcn_map[sid.sat] = sbp_fcn_to_rtcm(sbp_fcn, &state->diag);
 }
 
 bool sbp2rtcm_set_ant_height(const double ant_height,
@@ -1269,6 +1889,28 @@ void sbp2rtcm_set_rcv_ant_descriptors(const char *ant_descriptor,
   state->ant_known = true;
 };
 
+static const u16 stn_msg_num[RTCM3_STN_MSG_COUNT] = {
+    [RTCM3_STN_MSG_1005] = 1005,
+    [RTCM3_STN_MSG_1006] = 1006,
+    [RTCM3_STN_MSG_1008] = 1008,
+    [RTCM3_STN_MSG_1033] = 1033,
+    [RTCM3_STN_MSG_1230] = 1230,
+};
+
+bool sbp2rtcm_set_station_msg_interval(u16 msg_num,
+                                       u32 interval_ms,
+                                       struct rtcm3_out_state *state) {
+  for (u8 i = 0; i < RTCM3_STN_MSG_COUNT; i++) {
+    if (stn_msg_num[i] == msg_num) {
+      state->stn_msgs[i].interval_ms = interval_ms;
+      /* rephase on the next epoch */
+      state->stn_msgs[i].scheduled = false;
+      return true;
+    }
+  }
+  return false;
+}
+
 void compute_gps_message_time(u32 tow_ms,
                               gps_time_t *obs_time,
                               const gps_time_t *rover_time) {
@@ -1300,16 +1942,45 @@ void gps_tow_to_beidou_tow(u32 *tow_ms) {
   *tow_ms -= BDS_SECOND_TO_GPS_SECOND * S_TO_MS;
 }
 
+static bool time_cache_hit(const struct rtcm3_time_cache *cache,
+                           u32 raw_ms,
+                           const gps_time_t *ref_time,
+                           s8 leap_seconds) {
+  return cache->valid && cache->raw_ms == raw_ms &&
+         cache->ref_time.wn == ref_time->wn &&
+         cache->ref_time.tow == ref_time->tow &&
+         cache->leap_seconds == leap_seconds;
+}
+
+static void time_cache_store(struct rtcm3_time_cache *cache,
+                             u32 raw_ms,
+                             const gps_time_t *ref_time,
+                             s8 leap_seconds,
+                             const gps_time_t *obs_time) {
+  cache->valid = true;
+  cache->raw_ms = raw_ms;
+  cache->ref_time = *ref_time;
+  cache->leap_seconds = leap_seconds;
+  cache->obs_time = *obs_time;
+}
+
 void compute_gps_time(u32 tow_ms,
                       gps_time_t *obs_time,
                       const gps_time_t *rover_time,
                       struct rtcm3_sbp_state *state) {
-  compute_gps_message_time(tow_ms, obs_time, rover_time);
+  struct rtcm3_time_cache *cache = &state->gps_time_cache;
+  if (time_cache_hit(cache, tow_ms, rover_time, state->leap_seconds)) {
+    *obs_time = cache->obs_time;
+  } else {
+    compute_gps_message_time(tow_ms, obs_time, rover_time);
+    time_cache_store(cache, tow_ms, rover_time, state->leap_seconds, obs_time);
+  }
   validate_base_obs_sanity(state, obs_time, rover_time);
 }
 
 /* Compute full GLO time stamp from the time-of-day count, so that the result
- * is close to the supplied reference gps time
+ * is close to the supplied reference gps time. The last result is cached as
+ * all GLO messages of an epoch carry the same time of day.
  * TODO: correct functionality during/around leap second event to be
  *       tested and implemented */
 void compute_glo_time(u32 tod_ms,
@@ -1323,6 +1994,12 @@ void compute_glo_time(u32 tod_ms,
   assert(tod_ms < (SEC_IN_DAY + 1) * S_TO_MS);
   assert(gps_time_valid(rover_time));
 
+  struct rtcm3_time_cache *cache = &state->glo_time_cache;
+  if (time_cache_hit(cache, tod_ms, rover_time, state->leap_seconds)) {
+    *obs_time = cache->obs_time;
+    return;
+  }
+
   /* Approximate DOW from the reference GPS time */
   u8 glo_dow = (u8)(rover_time->tow / SEC_IN_DAY);
   s32 glo_tod_ms = tod_ms - UTC_SU_OFFSET * SEC_IN_HOUR * S_TO_MS;
@@ -1350,6 +2027,8 @@ void compute_glo_time(u32 tod_ms,
     /* time too far from rover time, invalidate */
     obs_time->wn = INVALID_TIME;
   }
+
+  time_cache_store(cache, tod_ms, rover_time, state->leap_seconds, obs_time);
 }
 
 static void validate_base_obs_sanity(struct rtcm3_sbp_state *state,
@@ -1413,11 +2092,67 @@ void send_1029(rtcm_msg_1029 *msg_1029, struct rtcm3_sbp_state *state) {
       RTCM_1029_LOGGING_LEVEL, message, message_size, msg_1029->stn_id, state);
 }
 
+/* Reserve a contiguous entry of size bytes in the output queue, returns NULL
+ * if there is no room */
+static u8 *queue_reserve(struct rtcm3_sbp_queue *queue, u16 size) {
+  if (0 == queue->count) {
+    queue->head = 0;
+    queue->tail = 0;
+  }
+
+  u16 offset;
+  if (queue->tail >= queue->head) {
+    if (RTCM3_SBP_QUEUE_SIZE - queue->tail >= size) {
+      offset = queue->tail;
+    } else if (size < queue->head) {
+      /* the write offset must stay below the read offset after wrapping */
+      queue->wrap = queue->tail;
+      offset = 0;
+    } else {
+      return NULL;
+    }
+  } else if (queue->tail + size < queue->head) {
+    offset = queue->tail;
+  } else {
+    return NULL;
+  }
+
+  queue->tail = offset + size;
+  queue->count++;
+  return &queue->data[offset];
+}
+
+void send_sbp_msg(u16 msg_id,
+                  u8 length,
+                  u8 *buffer,
+                  u16 sender_id,
+                  struct rtcm3_sbp_state *state) {
+  if (NULL != state->cb_rtcm_to_sbp) {
+    GNSSC_TRACE_BEGIN(state->trace, GNSSC_TRACE_CALLBACK, msg_id);
+    state->cb_rtcm_to_sbp(msg_id, length, buffer, sender_id, state->context);
+    GNSSC_TRACE_END(state->trace, GNSSC_TRACE_CALLBACK, msg_id);
+    return;
+  }
+
+  u8 *entry = queue_reserve(&state->queue, RTCM3_SBP_QUEUE_HDR_SIZE + length);
+  if (NULL == entry) {
+    state->queue.n_dropped++;
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_QUEUE_FULL, 1);
+    return;
+  }
+  entry[0] = (u8)(msg_id & 0xFF);
+  entry[1] = (u8)(msg_id >> 8);
+  entry[2] = (u8)(sender_id & 0xFF);
+  entry[3] = (u8)(sender_id >> 8);
+  entry[4] = length;
+  memcpy(&entry[RTCM3_SBP_QUEUE_HDR_SIZE], buffer, length);
+}
+
 void send_sbp_log_message(const uint8_t level,
                           const uint8_t *message,
                           uint16_t length,
                           const uint16_t stn_id,
-                          const struct rtcm3_sbp_state *state) {
+                          struct rtcm3_sbp_state *state) {
   u8 frame_buffer[SBP_FRAMING_MAX_PAYLOAD_SIZE];
   msg_log_t *sbp_log_msg = (msg_log_t *)frame_buffer;
   sbp_log_msg->level = level;
@@ -1425,15 +2160,21 @@ void send_sbp_log_message(const uint8_t level,
   /* truncate the message to fit in the payload */
   u16 max_message_length = SBP_FRAMING_MAX_PAYLOAD_SIZE - sizeof(*sbp_log_msg);
   if (length > max_message_length) {
-    fprintf(stderr, "Truncating too long log message: %s\n", message);
+    gnssc_diag_report(&state->diag,
+                      GNSSC_DIAG_LOG_TRUNCATED,
+                      stn_id,
+                      length,
+                      max_message_length,
+                      0,
+                      0);
     length = max_message_length;
   }
   MEMCPY_S(sbp_log_msg->text, max_message_length, message, length);
-  state->cb_rtcm_to_sbp(SBP_MSG_LOG,
-                        sizeof(*sbp_log_msg) + length,
-                        (u8 *)frame_buffer,
-                        rtcm_stn_to_sbp_sender_id(stn_id),
-                        state->context);
+  send_sbp_msg(SBP_MSG_LOG,
+               sizeof(*sbp_log_msg) + length,
+               (u8 *)frame_buffer,
+               rtcm_stn_to_sbp_sender_id(stn_id),
+               state);
 }
 
 void send_MSM_warning(const uint8_t *frame, struct rtcm3_sbp_state *state) {
@@ -1451,14 +2192,14 @@ void send_MSM_warning(const uint8_t *frame, struct rtcm3_sbp_state *state) {
   }
 }
 
-void send_buffer_full_error(const struct rtcm3_sbp_state *state) {
+void send_buffer_full_error(struct rtcm3_sbp_state *state) {
   /* TODO: Get the stn ID as well */
   uint8_t log_msg[] = "Too many RTCM observations received!";
   send_sbp_log_message(
       RTCM_BUFFER_FULL_LOGGING_LEVEL, log_msg, sizeof(log_msg), 0, state);
 }
 
-void send_buffer_not_empty_warning(const struct rtcm3_sbp_state *state) {
+void send_buffer_not_empty_warning(struct rtcm3_sbp_state *state) {
   uint8_t log_msg[] =
       "RTCM MSM sequence not properly finished, sending incomplete message";
   send_sbp_log_message(
@@ -1494,7 +2235,7 @@ void rtcm_log_callback_fn(uint8_t level,
                           uint8_t *message,
                           uint16_t length,
                           void *context) {
-  const struct rtcm3_sbp_state *state = (const struct rtcm3_sbp_state *)context;
+  struct rtcm3_sbp_state *state = (struct rtcm3_sbp_state *)context;
   send_sbp_log_message(level, message, length, 0, state);
 }
 
@@ -1511,6 +2252,7 @@ void add_msm_obs_to_buffer(const rtcm_msm_message *new_rtcm_obs,
     if (!gps_time_valid(&obs_time)) {
       /* time invalid because of missing leap second info or ongoing leap second
        * event, skip these measurements */
+      gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_INVALID_TIME, 1);
       return;
     }
 
@@ -1524,19 +2266,22 @@ void add_msm_obs_to_buffer(const rtcm_msm_message *new_rtcm_obs,
     compute_gps_time(tow_ms, &obs_time, &state->time_from_rover_obs, state);
   }
 
-  if (!gps_time_valid(&state->last_gps_time) ||
-      gpsdifftime(&obs_time, &state->last_gps_time) >= -MS_TO_S / 2) {
-    /* Find the buffer of obs to be sent */
-    msg_obs_t *sbp_obs_buffer = (msg_obs_t *)state->obs_buffer;
+  /* Find the buffer of obs to be sent */
+  struct rtcm3_station_buffer *station = get_station(
+      rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id), state);
+
+  if (state->reorder_window > 0 || !gps_time_valid(&station->last_gps_time) ||
+      gpsdifftime(&obs_time, &station->last_gps_time) >= -MS_TO_S / 2) {
+    msg_obs_t *sbp_obs_buffer = (msg_obs_t *)station->obs_buffer;
 
     if (!is_msm_active(&obs_time, state) && sbp_obs_buffer->header.n_obs > 0) {
       /* This is the first MSM observation, so clear the already decoded legacy
        * messages from the observation buffer to avoid duplicates */
-      memset(state->obs_buffer, 0, OBS_BUFFER_SIZE);
+      memset(station->obs_buffer, 0, OBS_BUFFER_SIZE);
     }
 
-    state->last_gps_time = obs_time;
-    state->last_glo_time = obs_time;
+    station->last_gps_time = obs_time;
+    station->last_glo_time = obs_time;
     state->last_msm_received = obs_time;
 
     /* Transform the newly received obs to sbp */
@@ -1549,25 +2294,46 @@ void add_msm_obs_to_buffer(const rtcm_msm_message *new_rtcm_obs,
     new_sbp_obs->header.t.tow = (u32)rint(obs_time.tow * S_TO_MS);
     new_sbp_obs->header.t.ns_residual = 0;
 
+    if (0 == sbp_obs_buffer->header.n_obs &&
+        epoch_timer_is_late(
+            &state->epoch_timer, &station->epoch, &new_sbp_obs->header.t)) {
+      /* the epoch has already been flushed by rtcm2sbp_tick() */
+      gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_LATE, 1);
+      return;
+    }
+
+    GNSSC_TRACE_BEGIN(
+        state->trace, GNSSC_TRACE_CONVERT, new_rtcm_obs->header.msg_num);
     rtcm3_msm_to_sbp(new_rtcm_obs, new_sbp_obs, state);
+    GNSSC_TRACE_END(
+        state->trace, GNSSC_TRACE_CONVERT, new_rtcm_obs->header.msg_num);
+    gnssc_stats_obs(state->stats, new_sbp_obs->header.n_obs, 0);
+
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+    if (state->reorder_window > 0) {
+      reorder_add(station, new_sbp_obs, state);
+      return;
+    }
+#endif
 
     /* Check if the buffer already has obs of the same time */
     if (sbp_obs_buffer->header.n_obs != 0 &&
-        (sbp_obs_buffer->header.t.tow != new_sbp_obs->header.t.tow ||
-         state->sender_id !=
-             rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id))) {
-      /* We either have missed a message, or we have a new station. Either way,
-       send through the current buffer and clear before adding new obs */
+        sbp_obs_buffer->header.t.tow != new_sbp_obs->header.t.tow) {
+      /* We have missed a message, send through the current buffer and clear
+       * before adding new obs */
       send_buffer_not_empty_warning(state);
-      send_observations(state);
+      send_observations(station, state);
     }
 
     /* Copy new obs into buffer */
     u8 obs_index_buffer = sbp_obs_buffer->header.n_obs;
-    state->sender_id = rtcm_stn_to_sbp_sender_id(new_rtcm_obs->header.stn_id);
+    state->sender_id = station->sender_id;
     for (u8 obs_count = 0; obs_count < new_sbp_obs->header.n_obs; obs_count++) {
       if (obs_index_buffer >= MAX_OBS_PER_EPOCH) {
         send_buffer_full_error(state);
+        gnssc_stats_drop(state->stats,
+                         GNSSC_STATS_DROP_BUFFER_FULL,
+                         new_sbp_obs->header.n_obs - obs_count);
         break;
       }
 
@@ -1579,6 +2345,7 @@ void add_msm_obs_to_buffer(const rtcm_msm_message *new_rtcm_obs,
     }
     sbp_obs_buffer->header.n_obs = obs_index_buffer;
     sbp_obs_buffer->header.t = new_sbp_obs->header.t;
+    epoch_timer_input(&state->epoch_timer, &station->epoch);
   }
 }
 
@@ -1599,6 +2366,7 @@ static bool get_sid_from_msm(const rtcm_msm_header *header,
   if (CODE_INVALID == code) {
     /* should have specific code warning but this requires modifying librtcm */
     send_unsupported_code_warning(UNSUPPORTED_CODE_UNKNOWN, state);
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_UNSUPPORTED_CODE, 1);
   }
   return false;
 }
@@ -1731,34 +2499,67 @@ void rtcm3_msm_to_sbp(const rtcm_msm_message *msg,
   }
 }
 
+/* Hand new content of a station message over to the output: it is either
+ * sent right away, or cached until send_station_msg() finds it due */
+static void station_msg_update(rtcm3_stn_msg_t id,
+                               const void *rtcm_msg,
+                               size_t size,
+                               struct rtcm3_out_state *state) {
+  struct rtcm3_stn_msg *stn_msg = &state->stn_msgs[id];
+
+  if (RTCM3_STN_MSG_INTERVAL_OFF == stn_msg->interval_ms) {
+    return;
+  }
+  if (RTCM3_STN_MSG_INTERVAL_IMMEDIATE == stn_msg->interval_ms) {
+    u8 frame[RTCM3_MAX_MSG_LEN];
+    u16 frame_size =
+        encode_rtcm3_frame(rtcm_msg, stn_msg_num[id], frame, state);
+    state->cb_sbp_to_rtcm(frame, frame_size, state->context);
+    return;
+  }
+
+  /* the content rarely changes, so only re-encode when it does */
+  assert(size <= sizeof(stn_msg->msg));
+  if (!stn_msg->valid || 0 != memcmp(&stn_msg->msg, rtcm_msg, size)) {
+    memcpy(&stn_msg->msg, rtcm_msg, size);
+    stn_msg->valid = true;
+    stn_msg->dirty = true;
+  }
+}
+
 void sbp2rtcm_base_pos_ecef_cb(const u16 sender_id,
                                const u8 len,
                                const u8 msg[],
                                struct rtcm3_out_state *state) {
   (void)len;
+  u64 start_ns = gnssc_stats_now(state->stats);
+  rtcm_msg_1005 msg_1005;
   rtcm_msg_1006 msg_1006;
   rtcm_msg_1008 msg_1008;
   rtcm_msg_1033 msg_1033;
-  u8 frame[RTCM3_MAX_MSG_LEN];
 
   state->sender_id = sender_id;
 
-  /* generate and send the base position message */
+  /* cleared so that the cached copies can be compared bytewise */
+  memset(&msg_1005, 0, sizeof(msg_1005));
+  memset(&msg_1006, 0, sizeof(msg_1006));
+
+  /* generate and send the base position messages */
+  sbp_to_rtcm3_1005((const msg_base_pos_ecef_t *)msg, &msg_1005, state);
+  station_msg_update(RTCM3_STN_MSG_1005, &msg_1005, sizeof(msg_1005), state);
   sbp_to_rtcm3_1006((const msg_base_pos_ecef_t *)msg, &msg_1006, state);
-  u16 frame_size = encode_rtcm3_frame(&msg_1006, 1006, frame);
-  state->cb_sbp_to_rtcm(frame, frame_size, state->context);
+  station_msg_update(RTCM3_STN_MSG_1006, &msg_1006, sizeof(msg_1006), state);
 
   if (state->ant_known) {
     /* generate and send the receiver and antenna description messages */
     generate_rtcm3_1033(&msg_1033, state);
     rtcm3_1033_to_1008(&msg_1033, &msg_1008);
 
-    frame_size = encode_rtcm3_frame(&msg_1008, 1008, frame);
-    state->cb_sbp_to_rtcm(frame, frame_size, state->context);
-
-    frame_size = encode_rtcm3_frame(&msg_1033, 1033, frame);
-    state->cb_sbp_to_rtcm(frame, frame_size, state->context);
+    station_msg_update(RTCM3_STN_MSG_1008, &msg_1008, sizeof(msg_1008), state);
+    station_msg_update(RTCM3_STN_MSG_1033, &msg_1033, sizeof(msg_1033), state);
   }
+
+  gnssc_stats_msg_done(state->stats, SBP_MSG_BASE_POS_ECEF, false, start_ns);
 }
 
 void sbp2rtcm_glo_biases_cb(const u16 sender_id,
@@ -1766,14 +2567,15 @@ void sbp2rtcm_glo_biases_cb(const u16 sender_id,
                             const u8 msg[],
                             struct rtcm3_out_state *state) {
   (void)len;
+  u64 start_ns = gnssc_stats_now(state->stats);
   state->sender_id = sender_id;
 
   rtcm_msg_1230 msg_1230;
+  memset(&msg_1230, 0, sizeof(msg_1230));
   sbp_to_rtcm3_1230((const msg_glo_biases_t *)msg, &msg_1230, state);
+  station_msg_update(RTCM3_STN_MSG_1230, &msg_1230, sizeof(msg_1230), state);
 
-  u8 frame[RTCM3_MAX_MSG_LEN];
-  u16 frame_size = encode_rtcm3_frame(&msg_1230, 1230, frame);
-  state->cb_sbp_to_rtcm(frame, frame_size, state->context);
+  gnssc_stats_msg_done(state->stats, SBP_MSG_GLO_BIASES, false, start_ns);
 }
 
 static void sbp_obs_to_freq_data(const packed_obs_content_t *sbp_freq,
@@ -1845,14 +2647,14 @@ static void msm_init_obs_message(rtcm_msm_message *msg,
   /* MSM Multiple Message bit DF393 bit(1) 1
    * 0 this is the last message
    * 1 more messages to follow */
-  /* initialize messages to 1, reset the flag of the last message later */
+  /* initialize messages to 1, the flag is set when the message is sent */
   msg->header.multiple = 1;
 }
 
 /* convert the SBP observation into MSM message structure */
 static void sbp_obs_to_msm_signal_data(const packed_obs_content_t *sbp_obs,
                                        rtcm_msm_message *msg,
-                                       const struct rtcm3_out_state *state) {
+                                       struct rtcm3_out_state *state) {
   rtcm_constellation_t cons = to_constellation(msg->header.msg_num);
   uint8_t num_sigs = msm_get_num_signals(&msg->header);
 
@@ -1861,10 +2663,13 @@ static void sbp_obs_to_msm_signal_data(const packed_obs_content_t *sbp_obs,
   u8 cell_id = sat_index * num_sigs + signal_index;
 
   if (!msg->header.cell_mask[cell_id]) {
-    fprintf(stderr,
-            "Cell mask not set for sat %u signal %u\n",
-            sat_index,
-            signal_index);
+    gnssc_diag_report(&state->diag,
+                      GNSSC_DIAG_MSM_CELL_NOT_SET,
+                      msg->header.stn_id,
+                      sat_index,
+                      signal_index,
+                      0,
+                      0);
     return;
   }
 
@@ -1978,74 +2783,198 @@ static void rtcm_init_obs_message(rtcm_obs_message *msg,
   msg->header.smooth = PIKSI_SMOOTHING_INTERVAL;
 }
 
-/* Find the matching svId from sat data array
- * Return the found index, or n_sats if not found */
-static u8 sat_index_from_obs(rtcm_sat_data sats[], u8 n_sats, u8 svId) {
-  for (u8 sat_i = 0; sat_i < n_sats; sat_i++) {
-    if (sats[sat_i].svId == svId) {
-      return sat_i;
-    }
+#define LEGACY_NO_SLOT 0xFF
+
+/* Return the index of the satellite in the legacy observation message, a new
+ * one is taken on the first observation of the satellite. Returns
+ * LEGACY_NO_SLOT for an invalid PRN or if the message is full. */
+static u8 legacy_sat_slot(u8 slots[], u8 max_prn, u8 prn, u8 *n_sats) {
+  if (0 == prn || prn > max_prn) {
+    return LEGACY_NO_SLOT;
   }
-  return n_sats;
+  if (LEGACY_NO_SLOT == slots[prn] && *n_sats < RTCM_MAX_SATS) {
+    slots[prn] = (*n_sats)++;
+  }
+  return slots[prn];
 }
 
-void sbp_buffer_to_msm(const struct rtcm3_out_state *state) {
-  /* message for each constellation */
-  rtcm_msm_message obs[RTCM_CONSTELLATION_COUNT];
-  for (u8 cons = 0; cons < RTCM_CONSTELLATION_COUNT; cons++) {
-    msm_init_obs_message(&obs[cons], state, cons);
+/* 1004 and 1012 carry the L2 observables relative to L1, so the satellites
+ * without an L1 observation are dropped. Returns the new number of
+ * satellites. */
+static u8 legacy_drop_sats_without_l1(rtcm_obs_message *msg,
+                                      const bool has_l1[],
+                                      u8 n_sats) {
+  u8 n_kept = 0;
+  for (u8 i = 0; i < n_sats; i++) {
+    if (has_l1[i]) {
+      if (n_kept != i) {
+        msg->sats[n_kept] = msg->sats[i];
+      }
+      n_kept++;
+    }
   }
-
-  /* loop through observations once to generate satellite and signal masks */
-  for (u8 i = 0; i < state->n_sbp_obs; i++) {
-    const packed_obs_content_t *sbp_obs = &(state->sbp_obs_buffer[i]);
-    rtcm_constellation_t cons =
-        (rtcm_constellation_t)code_to_constellation(sbp_obs->sid.code);
-    msm_add_to_header(&obs[cons].header, sbp_obs->sid.code, sbp_obs->sid.sat);
+  return n_kept;
+}
+
+/* count how many of the given observations of a single satellite can be added
+ * to the MSM header without exceeding the cell limit, the header itself is not
+ * modified */
+static u8 msm_count_fitting_obs(const rtcm_msm_header *header,
+                                const u16 obs_idx[],
+                                u8 n_obs,
+                                const struct rtcm3_out_state *state) {
+  rtcm_msm_header trial = *header;
+  u8 n_fit = 0;
+  for (u8 i = 0; i < n_obs; i++) {
+    const packed_obs_content_t *sbp_obs = &state->sbp_obs_buffer[obs_idx[i]];
+    if (msm_add_to_header(&trial, sbp_obs->sid.code, sbp_obs->sid.sat, NULL)) {
+      n_fit++;
+    }
   }
-
-  /* using the complete satellite and signal masks, loop through observations
-   * again to generate the cell mask */
-  for (u8 i = 0; i < state->n_sbp_obs; i++) {
-    const packed_obs_content_t *sbp_obs = &(state->sbp_obs_buffer[i]);
-    rtcm_constellation_t cons =
-        (rtcm_constellation_t)code_to_constellation(sbp_obs->sid.code);
+  return n_fit;
+}
+
+/* report an observation left out of the message for lack of cells */
+static void msm_report_dropped_obs(const rtcm_msm_header *header,
+                                   const packed_obs_content_t *sbp_obs,
+                                   struct rtcm3_out_state *state) {
+  gnssc_diag_report(&state->diag,
+                    GNSSC_DIAG_MSM_SIGNAL_LIMIT,
+                    header->stn_id,
+                    sbp_obs->sid.code,
+                    sbp_obs->sid.sat,
+                    0,
+                    0);
+}
+
+/* using the complete satellite and signal masks, generate the cell mask and
+ * the signal data of the message */
+static void msm_fill_cells(rtcm_msm_message *msg,
+                           const u16 obs_idx[],
+                           u8 n_obs,
+                           struct rtcm3_out_state *state) {
+  for (u8 i = 0; i < n_obs; i++) {
+    const packed_obs_content_t *sbp_obs = &state->sbp_obs_buffer[obs_idx[i]];
     msm_add_to_cell_mask(
-        &obs[cons].header, sbp_obs->sid.code, sbp_obs->sid.sat);
+        &msg->header, sbp_obs->sid.code, sbp_obs->sid.sat, &state->diag);
   }
-
-  /* loop through observations once more to generate the actual signal data */
-  for (u8 i = 0; i < state->n_sbp_obs; i++) {
-    const packed_obs_content_t *sbp_obs = &(state->sbp_obs_buffer[i]);
-    rtcm_constellation_t cons =
-        (rtcm_constellation_t)code_to_constellation(sbp_obs->sid.code);
-    sbp_obs_to_msm_signal_data(sbp_obs, &obs[cons], state);
+  for (u8 i = 0; i < n_obs; i++) {
+    const packed_obs_content_t *sbp_obs = &state->sbp_obs_buffer[obs_idx[i]];
+    sbp_obs_to_msm_signal_data(sbp_obs, msg, state);
   }
+}
 
+static void msm_send(rtcm_msm_message *msg,
+                     bool last,
+                     struct rtcm3_out_state *state) {
   /* Fill in the MSM Multiple Message bit DF393 bit(1) 1
    * 0 this is the last message
    * 1 more messages to follow */
-  for (s8 cons = RTCM_CONSTELLATION_COUNT - 1; cons >= 0; cons--) {
-    if (msm_get_num_satellites(&obs[cons].header) > 0) {
-      /* reset the multiple message bit of the last constellation that has
-       * measurements, others have already been initialized to one */
-      obs[cons].header.multiple = 0;
-      break;
-    }
-  }
+  msg->header.multiple = last ? 0 : 1;
 
-  /* send out all the messages that have measurements */
   static u8 frame[RTCM3_MAX_MSG_LEN];
+  u16 frame_size = encode_rtcm3_frame(msg, msg->header.msg_num, frame, state);
+  state->cb_sbp_to_rtcm(frame, frame_size, state->context);
+}
+
+/* Convert the SBP observation buffer into MSM messages. Satellites are packed
+ * into the message of their constellation until the cell mask is full, after
+ * which the constellation continues in a new message, so no observations are
+ * lost to the MSM_MAX_CELLS limit. */
+void sbp_buffer_to_msm(struct rtcm3_out_state *state) {
+  /* A finished message is held back until the next one is finished, so that
+   * the multiple message bit can be cleared on the last message of the epoch */
+  rtcm_msm_message msgs[2];
+  u8 current = 0;
+  bool pending = false;
+
+  /* observations allocated into the current message */
+  u16 msg_obs[MSM_MAX_CELLS];
+  u8 n_msg_obs = 0;
+
+  /* observations of the satellite being added */
+  u16 sat_obs[MSM_SIGNAL_MASK_SIZE];
+
+  bool used[MAX_OBS_PER_EPOCH];
+  memset(used, 0, sizeof(used));
+
   for (u8 cons = 0; cons < RTCM_CONSTELLATION_COUNT; cons++) {
-    if (msm_get_num_satellites(&obs[cons].header) > 0) {
-      u16 frame_size =
-          encode_rtcm3_frame(&obs[cons], obs[cons].header.msg_num, frame);
-      state->cb_sbp_to_rtcm(frame, frame_size, state->context);
+    rtcm_msm_message *msg = &msgs[current];
+    msm_init_obs_message(msg, state, cons);
+    const rtcm_msm_header empty_header = msg->header;
+    n_msg_obs = 0;
+
+    for (u16 i = 0; i < state->n_sbp_obs; i++) {
+      const packed_obs_content_t *sbp_obs = &state->sbp_obs_buffer[i];
+      if (used[i] ||
+          cons != (rtcm_constellation_t)code_to_constellation(
+                      sbp_obs->sid.code)) {
+        continue;
+      }
+
+      /* gather all the signals of this satellite */
+      u8 n_sat_obs = 0;
+      for (u16 j = i; j < state->n_sbp_obs; j++) {
+        const packed_obs_content_t *other = &state->sbp_obs_buffer[j];
+        if (used[j] || other->sid.sat != sbp_obs->sid.sat ||
+            cons !=
+                (rtcm_constellation_t)code_to_constellation(other->sid.code)) {
+          continue;
+        }
+        used[j] = true;
+        if (n_sat_obs < MSM_SIGNAL_MASK_SIZE) {
+          sat_obs[n_sat_obs++] = j;
+        } else {
+          msm_report_dropped_obs(&msg->header, other, state);
+        }
+      }
+
+      /* if the satellite does not fit in the current message any more, finish
+       * it and continue the constellation in a new message */
+      if (n_msg_obs > 0 &&
+          msm_count_fitting_obs(&msg->header, sat_obs, n_sat_obs, state) <
+              msm_count_fitting_obs(&empty_header, sat_obs, n_sat_obs, state)) {
+        msm_fill_cells(msg, msg_obs, n_msg_obs, state);
+        if (pending) {
+          msm_send(&msgs[current ^ 1], false, state);
+        }
+        pending = true;
+        current ^= 1;
+        msg = &msgs[current];
+        msm_init_obs_message(msg, state, cons);
+        n_msg_obs = 0;
+      }
+
+      for (u8 k = 0; k < n_sat_obs; k++) {
+        const packed_obs_content_t *obs = &state->sbp_obs_buffer[sat_obs[k]];
+        /* the header may only gain the signals that get a cell */
+        if (n_msg_obs >= MSM_MAX_CELLS) {
+          msm_report_dropped_obs(&msg->header, obs, state);
+        } else if (msm_add_to_header(&msg->header,
+                                     obs->sid.code,
+                                     obs->sid.sat,
+                                     &state->diag)) {
+          msg_obs[n_msg_obs++] = sat_obs[k];
+        }
+      }
+    }
+
+    if (n_msg_obs > 0) {
+      msm_fill_cells(msg, msg_obs, n_msg_obs, state);
+      if (pending) {
+        msm_send(&msgs[current ^ 1], false, state);
+      }
+      pending = true;
+      current ^= 1;
     }
   }
+
+  if (pending) {
+    msm_send(&msgs[current ^ 1], true, state);
+  }
 }
 
-static void sbp_buffer_to_legacy_rtcm3(struct rtcm3_out_state *state) {
+void sbp_buffer_to_legacy_rtcm3(struct rtcm3_out_state *state) {
   rtcm_obs_message gps_obs;
   rtcm_init_obs_message(&gps_obs, state, RTCM_CONSTELLATION_GPS);
 
@@ -2058,60 +2987,86 @@ static void sbp_buffer_to_legacy_rtcm3(struct rtcm3_out_state *state) {
   /* Loop through the observation buffer once and add the observations into
    * gps_obs and glo_obs structures.
    *
-   * The observations are stored by satellite. New satellite is created into the
-   * struct for each L1 observation. Note that L2 observations are added only if
-   * the satellite exists already, that is it has already an L1 observation.
-   * This requires that observations come in sorted with L1 first.
+   * The observations are stored by satellite, in the order the satellites
+   * first appear in the buffer. The slot of each satellite is looked up by
+   * PRN, so the L1 and L2 observations can come in any order. If a satellite
+   * has several observations on the same band, the first one is used.
    */
-
-  for (u8 i = 0; i < state->n_sbp_obs; i++) {
-    packed_obs_content_t *sbp_obs = &(state->sbp_obs_buffer[i]);
+  u8 gps_slots[NUM_SATS_GPS + 1];
+  u8 glo_slots[NUM_SATS_GLO + 1];
+  memset(gps_slots, LEGACY_NO_SLOT, sizeof(gps_slots));
+  memset(glo_slots, LEGACY_NO_SLOT, sizeof(glo_slots));
+  bool gps_has_l1[RTCM_MAX_SATS] = {false};
+  bool gps_has_l2[RTCM_MAX_SATS] = {false};
+  bool glo_has_l1[RTCM_MAX_SATS] = {false};
+  bool glo_has_l2[RTCM_MAX_SATS] = {false};
+
+  for (u16 i = 0; i < state->n_sbp_obs; i++) {
+    const packed_obs_content_t *sbp_obs = &(state->sbp_obs_buffer[i]);
+    u8 prn = sbp_obs->sid.sat;
     switch (sbp_obs->sid.code) {
       case CODE_GPS_L1CA:
       case CODE_GPS_L1P: {
-        /* add a new sat */
-        gps_obs.sats[n_gps].fcn = 0;
-        gps_obs.sats[n_gps].svId = sbp_obs->sid.sat;
+        u8 sat_i = legacy_sat_slot(gps_slots, NUM_SATS_GPS, prn, &n_gps);
+        if (LEGACY_NO_SLOT == sat_i || gps_has_l1[sat_i]) {
+          break;
+        }
+        gps_obs.sats[sat_i].fcn = 0;
+        gps_obs.sats[sat_i].svId = prn;
         sbp_obs_to_freq_data(sbp_obs,
-                             &(gps_obs.sats[n_gps].obs[L1_FREQ]),
+                             &(gps_obs.sats[sat_i].obs[L1_FREQ]),
                              (sbp_obs->sid.code == CODE_GPS_L1P) ? 1 : 0);
-        n_gps++;
+        gps_has_l1[sat_i] = true;
         break;
       }
       case CODE_GPS_L2CM:
       case CODE_GPS_L2P: {
-        /* find the sat with L1 observations already added */
-        u8 sat_i = sat_index_from_obs(gps_obs.sats, n_gps, sbp_obs->sid.sat);
-        if (sat_i < n_gps) {
-          sbp_obs_to_freq_data(sbp_obs,
-                               &(gps_obs.sats[sat_i].obs[L2_FREQ]),
-                               (sbp_obs->sid.code == CODE_GPS_L2P) ? 1 : 0);
+        u8 sat_i = legacy_sat_slot(gps_slots, NUM_SATS_GPS, prn, &n_gps);
+        if (LEGACY_NO_SLOT == sat_i || gps_has_l2[sat_i]) {
+          break;
         }
+        gps_obs.sats[sat_i].fcn = 0;
+        gps_obs.sats[sat_i].svId = prn;
+        sbp_obs_to_freq_data(sbp_obs,
+                             &(gps_obs.sats[sat_i].obs[L2_FREQ]),
+                             (sbp_obs->sid.code == CODE_GPS_L2P) ? 1 : 0);
+        gps_has_l2[sat_i] = true;
         break;
       }
       case CODE_GLO_L1OF:
       case CODE_GLO_L1P: {
-        u8 fcn = state->glo_sv_id_fcn_map[sbp_obs->sid.sat];
-        if (MSM_GLO_FCN_UNKNOWN != fcn) {
-          /* add a new sat */
-          glo_obs.sats[n_glo].fcn = fcn;
-          glo_obs.sats[n_glo].svId = sbp_obs->sid.sat;
-          sbp_obs_to_freq_data(sbp_obs,
-                               &(glo_obs.sats[n_glo].obs[L1_FREQ]),
-                               (sbp_obs->sid.code == CODE_GLO_L1P) ? 1 : 0);
-          n_glo++;
+        if (prn > NUM_SATS_GLO ||
+            MSM_GLO_FCN_UNKNOWN == state->glo_sv_id_fcn_map[prn]) {
+          break;
+        }
+        u8 sat_i = legacy_sat_slot(glo_slots, NUM_SATS_GLO, prn, &n_glo);
+        if (LEGACY_NO_SLOT == sat_i || glo_has_l1[sat_i]) {
+          break;
         }
+        glo_obs.sats[sat_i].fcn = state->glo_sv_id_fcn_map[prn];
+        glo_obs.sats[sat_i].svId = prn;
+        sbp_obs_to_freq_data(sbp_obs,
+                             &(glo_obs.sats[sat_i].obs[L1_FREQ]),
+                             (sbp_obs->sid.code == CODE_GLO_L1P) ? 1 : 0);
+        glo_has_l1[sat_i] = true;
         break;
       }
       case CODE_GLO_L2OF:
       case CODE_GLO_L2P: {
-        /* find the sat with L1 observations already added */
-        u8 sat_i = sat_index_from_obs(glo_obs.sats, n_glo, sbp_obs->sid.sat);
-        if (sat_i < n_glo) {
-          sbp_obs_to_freq_data(sbp_obs,
-                               &(glo_obs.sats[sat_i].obs[L2_FREQ]),
-                               (sbp_obs->sid.code == CODE_GLO_L2P) ? 1 : 0);
+        if (prn > NUM_SATS_GLO ||
+            MSM_GLO_FCN_UNKNOWN == state->glo_sv_id_fcn_map[prn]) {
+          break;
         }
+        u8 sat_i = legacy_sat_slot(glo_slots, NUM_SATS_GLO, prn, &n_glo);
+        if (LEGACY_NO_SLOT == sat_i || glo_has_l2[sat_i]) {
+          break;
+        }
+        glo_obs.sats[sat_i].fcn = state->glo_sv_id_fcn_map[prn];
+        glo_obs.sats[sat_i].svId = prn;
+        sbp_obs_to_freq_data(sbp_obs,
+                             &(glo_obs.sats[sat_i].obs[L2_FREQ]),
+                             (sbp_obs->sid.code == CODE_GLO_L2P) ? 1 : 0);
+        glo_has_l2[sat_i] = true;
         break;
       }
       default:
@@ -2119,6 +3074,9 @@ static void sbp_buffer_to_legacy_rtcm3(struct rtcm3_out_state *state) {
     }
   }
 
+  n_gps = legacy_drop_sats_without_l1(&gps_obs, gps_has_l1, n_gps);
+  n_glo = legacy_drop_sats_without_l1(&glo_obs, glo_has_l1, n_glo);
+
   /* Number of satellites DF006 uint8 5 */
   gps_obs.header.n_sat = n_gps;
   glo_obs.header.n_sat = n_glo;
@@ -2130,18 +3088,90 @@ static void sbp_buffer_to_legacy_rtcm3(struct rtcm3_out_state *state) {
   static u8 frame[RTCM3_MAX_MSG_LEN];
   if (n_gps > 0) {
     u16 frame_size =
-        encode_rtcm3_frame(&gps_obs, gps_obs.header.msg_num, frame);
+        encode_rtcm3_frame(&gps_obs, gps_obs.header.msg_num, frame, state);
     state->cb_sbp_to_rtcm(frame, frame_size, state->context);
   }
 
   if (n_glo > 0) {
     u16 frame_size =
-        encode_rtcm3_frame(&glo_obs, glo_obs.header.msg_num, frame);
+        encode_rtcm3_frame(&glo_obs, glo_obs.header.msg_num, frame, state);
     state->cb_sbp_to_rtcm(frame, frame_size, state->context);
   }
 }
 
+/* Send the most overdue of the scheduled station messages, if any. This is
+ * called once per observation epoch, so messages falling due at the same time
+ * go out on consecutive epochs instead of in one burst. */
+static void send_station_msg(struct rtcm3_out_state *state) {
+  s64 now_ms = (s64)state->sbp_header.t.wn * SEC_IN_WEEK * S_TO_MS +
+               state->sbp_header.t.tow;
+  rtcm3_stn_msg_t due_id = RTCM3_STN_MSG_COUNT;
+
+  for (rtcm3_stn_msg_t id = 0; id < RTCM3_STN_MSG_COUNT; id++) {
+    struct rtcm3_stn_msg *stn_msg = &state->stn_msgs[id];
+    if (!stn_msg->valid ||
+        RTCM3_STN_MSG_INTERVAL_IMMEDIATE == stn_msg->interval_ms ||
+        RTCM3_STN_MSG_INTERVAL_OFF == stn_msg->interval_ms) {
+      continue;
+    }
+    if (!stn_msg->scheduled ||
+        stn_msg->next_due_ms - stn_msg->interval_ms > now_ms) {
+      /* first epoch, or the time went backwards */
+      stn_msg->next_due_ms = now_ms;
+      stn_msg->scheduled = true;
+    }
+    if (stn_msg->next_due_ms <= now_ms &&
+        (RTCM3_STN_MSG_COUNT == due_id ||
+         stn_msg->next_due_ms < state->stn_msgs[due_id].next_due_ms)) {
+      due_id = id;
+    }
+  }
+
+  if (RTCM3_STN_MSG_COUNT == due_id) {
+    return;
+  }
+
+  struct rtcm3_stn_msg *stn_msg = &state->stn_msgs[due_id];
+  if (stn_msg->dirty) {
+    u8 frame[RTCM3_MAX_MSG_LEN];
+    u16 frame_size =
+        encode_rtcm3_frame(&stn_msg->msg, stn_msg_num[due_id], frame, state);
+    if (frame_size > sizeof(stn_msg->frame)) {
+      gnssc_diag_report(&state->diag,
+                        GNSSC_DIAG_RTCM_ENCODE_FAILED,
+                        sbp_sender_to_rtcm_stn_id(state->sender_id),
+                        stn_msg_num[due_id],
+                        0,
+                        0,
+                        0);
+      frame_size = 0;
+    }
+    memcpy(stn_msg->frame, frame, frame_size);
+    stn_msg->frame_length = frame_size;
+    stn_msg->dirty = false;
+  }
+
+  /* keep the cadence, unless the epochs had a gap longer than the interval */
+  stn_msg->next_due_ms += stn_msg->interval_ms;
+  if (stn_msg->next_due_ms <= now_ms) {
+    stn_msg->next_due_ms = now_ms + stn_msg->interval_ms;
+  }
+
+  if (stn_msg->frame_length > 0) {
+    state->cb_sbp_to_rtcm(
+        stn_msg->frame, stn_msg->frame_length, state->context);
+  }
+}
+
 static void sbp_buffer_to_rtcm3(struct rtcm3_out_state *state) {
+  if (state->n_sbp_obs > 0) {
+    gnssc_stats_obs(state->stats, 0, state->n_sbp_obs);
+    send_station_msg(state);
+    epoch_timer_sent(&state->epoch_timer.stream, &state->sbp_header.t);
+  }
+  if (NULL != state->cb_sbp_obs_epoch && state->n_sbp_obs > 0) {
+    state->cb_sbp_obs_epoch(state, state->context);
+  }
   if (state->send_legacy_obs) {
     sbp_buffer_to_legacy_rtcm3(state);
   }
@@ -2152,10 +3182,10 @@ static void sbp_buffer_to_rtcm3(struct rtcm3_out_state *state) {
   state->n_sbp_obs = 0;
 }
 
-void sbp2rtcm_sbp_obs_cb(const u16 sender_id,
-                         const u8 len,
-                         const u8 msg[],
-                         struct rtcm3_out_state *state) {
+static void add_sbp_obs_to_buffer(const u16 sender_id,
+                                  const u8 len,
+                                  const u8 msg[],
+                                  struct rtcm3_out_state *state) {
   msg_obs_t *sbp_obs = (msg_obs_t *)msg;
 
   if (state->sender_id != sender_id) {
@@ -2166,6 +3196,16 @@ void sbp2rtcm_sbp_obs_cb(const u16 sender_id,
 
   u8 seq_counter = (sbp_obs->header.n_obs & 0x0F) + 1;
   u8 seq_size = sbp_obs->header.n_obs >> 4;
+  u16 stn_id = sbp_sender_to_rtcm_stn_id(sender_id);
+
+  if (0 == state->n_sbp_obs &&
+      epoch_timer_is_late(&state->epoch_timer,
+                          &state->epoch_timer.stream,
+                          &sbp_obs->header.t)) {
+    /* the epoch has already been flushed by sbp2rtcm_tick() */
+    gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_LATE, 1);
+    return;
+  }
 
   /* if sbp buffer is not empty, check that this observations belongs to the
    * sequence */
@@ -2173,18 +3213,26 @@ void sbp2rtcm_sbp_obs_cb(const u16 sender_id,
     double dt = sbp_diff_time(&sbp_obs->header.t, &state->sbp_header.t);
 
     if (dt < 0) {
-      fprintf(stderr,
-              "Discarding SBP obs with timestamp %.1f seconds in the past\n",
-              dt);
+      gnssc_diag_report(&state->diag,
+                        GNSSC_DIAG_OBS_IN_PAST,
+                        stn_id,
+                        (s32)lrint(-dt * SECS_MS),
+                        0,
+                        0,
+                        0);
+      gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_LATE, 1);
       return;
     }
     if (dt > 0) {
       /* observations belong to the next epoch, send out the current buffer
        * before processing this message */
-      fprintf(
-          stderr,
-          "SBP obs sequence ended prematurely, starting new one at dt=%.1f\n",
-          dt);
+      gnssc_diag_report(&state->diag,
+                        GNSSC_DIAG_OBS_SEQ_ENDED,
+                        stn_id,
+                        (s32)lrint(dt * SECS_MS),
+                        0,
+                        0,
+                        0);
 
       sbp_buffer_to_rtcm3(state);
     } else {
@@ -2193,24 +3241,26 @@ void sbp2rtcm_sbp_obs_cb(const u16 sender_id,
 
       if (seq_size != current_seq_size || seq_counter <= current_seq_counter) {
         /* sequence broken, send out current buffer and ignore this message */
-        fprintf(stderr,
-                "Ignoring SBP obs with invalid obs sequence: expected %d/%d "
-                "but got %d/%d\n",
-                current_seq_counter + 1,
-                current_seq_size,
-                seq_counter,
-                seq_size);
+        gnssc_diag_report(&state->diag,
+                          GNSSC_DIAG_OBS_SEQ_INVALID,
+                          stn_id,
+                          current_seq_counter + 1,
+                          current_seq_size,
+                          seq_counter,
+                          seq_size);
+        gnssc_stats_drop(state->stats, GNSSC_STATS_DROP_SEQ_INVALID, 1);
         sbp_buffer_to_rtcm3(state);
         return;
       }
       if (seq_counter != current_seq_counter + 1) {
         /* missed a packet, emit warning but still process this message */
-        fprintf(stderr,
-                "Missed an SBP obs packet, expected seq %d/%d but got %d/%d\n",
-                current_seq_counter + 1,
-                current_seq_size,
-                seq_counter,
-                seq_size);
+        gnssc_diag_report(&state->diag,
+                          GNSSC_DIAG_OBS_SEQ_MISSED,
+                          stn_id,
+                          current_seq_counter + 1,
+                          current_seq_size,
+                          seq_counter,
+                          seq_size);
       }
     }
   }
@@ -2218,6 +3268,7 @@ void sbp2rtcm_sbp_obs_cb(const u16 sender_id,
   /* number of observations in the incoming message */
   u8 n_meas =
       (len - sizeof(observation_header_t)) / sizeof(packed_obs_content_t);
+  gnssc_stats_obs(state->stats, n_meas, 0);
 
   for (u8 i = 0; i < n_meas; i++) {
     if ((0 == (sbp_obs->obs[i].flags & MSG_OBS_FLAGS_CODE_VALID)) ||
@@ -2230,19 +3281,57 @@ void sbp2rtcm_sbp_obs_cb(const u16 sender_id,
     state->sbp_obs_buffer[state->n_sbp_obs] = sbp_obs->obs[i];
     state->n_sbp_obs++;
     if (state->n_sbp_obs == MAX_OBS_PER_EPOCH) {
-      fprintf(
-          stderr,
-          "Reached max observations per epoch %u, ignoring the remaining %u "
-          "obs\n",
-          (u16)MAX_OBS_PER_EPOCH,
-          n_meas - i - 1);
+      gnssc_diag_report(&state->diag,
+                        GNSSC_DIAG_OBS_BUFFER_FULL,
+                        stn_id,
+                        MAX_OBS_PER_EPOCH,
+                        n_meas - i - 1,
+                        0,
+                        0);
+      gnssc_stats_drop(
+          state->stats, GNSSC_STATS_DROP_BUFFER_FULL, n_meas - i - 1);
       break;
     }
   }
   state->sbp_header = sbp_obs->header;
+  epoch_timer_input(&state->epoch_timer, &state->epoch_timer.stream);
 
   /* if sequence is complete, convert into RTCM */
   if (seq_counter == seq_size) {
     sbp_buffer_to_rtcm3(state);
   }
 }
+
+void sbp2rtcm_sbp_obs_cb(const u16 sender_id,
+                         const u8 len,
+                         const u8 msg[],
+                         struct rtcm3_out_state *state) {
+  u64 start_ns = gnssc_stats_now(state->stats);
+  add_sbp_obs_to_buffer(sender_id, len, msg, state);
+  gnssc_stats_msg_done(state->stats, SBP_MSG_OBS, false, start_ns);
+}
+
+void sbp2rtcm_tick(u64 now_ms, struct rtcm3_out_state *state) {
+  struct rtcm3_epoch_timer *timer = &state->epoch_timer;
+
+  timer->now_ms = now_ms;
+  gnssc_diag_set_time(&state->diag, now_ms);
+
+  if (state->n_sbp_obs > 0 &&
+      epoch_timer_expired(
+          timer, &timer->stream, timer->stream.last_input_ms)) {
+    sbp_buffer_to_rtcm3(state);
+    timer->stream.last_epoch_forced = true;
+    timer->n_forced_flushes++;
+  }
+}
+
+void sbp2rtcm_set_flush_timeout(u32 timeout_ms,
+                                struct rtcm3_out_state *state) {
+  state->epoch_timer.timeout_ms = timeout_ms;
+}
+
+void sbp2rtcm_set_stats(struct gnssc_stats *stats,
+                        struct rtcm3_out_state *state) {
+  state->stats = stats;
+}
@@ -32,6 +32,12 @@
 /* message type range reserved for MSM */
 #define MSM_MSG_TYPE_MIN 1070
 #define MSM_MSG_TYPE_MAX 1229
+/* bit offset of the reference station id DF003, same in all observation
+ * messages */
+#define RTCM_STN_ID_OFFSET 12
+/* bit offset of the epoch time (DF004, DF034 or the MSM epoch time), same in
+ * all observation messages */
+#define RTCM_EPOCH_TIME_OFFSET 24
 /* bit offset of the multiple message flag, regardless of MSM type */
 #define MSM_MULTIPLE_BIT_OFFSET 54
 
@@ -236,7 +242,10 @@ void rtcm3_to_sbp(const rtcm_obs_message *rtcm_obs,
                   msg_obs_t *new_sbp_obs,
                   struct rtcm3_sbp_state *state);
 
-u16 encode_rtcm3_frame(const void *rtcm_msg, u16 message_type, u8 *frame);
+u16 encode_rtcm3_frame(const void *rtcm_msg,
+                       u16 message_type,
+                       u8 *frame,
+                       struct rtcm3_out_state *state);
 
 void add_gps_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
                            struct rtcm3_sbp_state *state);
@@ -244,6 +253,10 @@ void add_gps_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
 void add_glo_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
                            struct rtcm3_sbp_state *state);
 
+bool gps_obs_message(u16 msg_num);
+
+bool glo_obs_message(u16 msg_num);
+
 void add_obs_to_buffer(const rtcm_obs_message *new_rtcm_obs,
                        gps_time_t *obs_time,
                        struct rtcm3_sbp_state *state);
@@ -265,13 +278,22 @@ void compute_glo_time(u32 tod_ms,
 uint32_t compute_glo_tod_ms(uint32_t gps_tow_ms,
                             const struct rtcm3_out_state *state);
 
-void sbp_buffer_to_msm(const struct rtcm3_out_state *state);
+void sbp_buffer_to_msm(struct rtcm3_out_state *state);
+
+void sbp_buffer_to_legacy_rtcm3(struct rtcm3_out_state *state);
 
 void beidou_tow_to_gps_tow(u32 *tow_ms);
 
 void gps_tow_to_beidou_tow(u32 *tow_ms);
 
-void send_observations(struct rtcm3_sbp_state *state);
+void send_observations(struct rtcm3_station_buffer *station,
+                       struct rtcm3_sbp_state *state);
+
+void send_sbp_msg(u16 msg_id,
+                  u8 length,
+                  u8 *buffer,
+                  u16 sender_id,
+                  struct rtcm3_sbp_state *state);
 
 bool no_1230_received(struct rtcm3_sbp_state *state);
 
@@ -281,11 +303,11 @@ void send_sbp_log_message(const uint8_t level,
                           const uint8_t *message,
                           const uint16_t length,
                           const uint16_t stn_id,
-                          const struct rtcm3_sbp_state *state);
+                          struct rtcm3_sbp_state *state);
 
 void send_MSM_warning(const uint8_t *frame, struct rtcm3_sbp_state *state);
 
-void send_buffer_full_error(const struct rtcm3_sbp_state *state);
+void send_buffer_full_error(struct rtcm3_sbp_state *state);
 
 void send_unsupported_code_warning(const unsupported_code_t unsupported_code,
                                    struct rtcm3_sbp_state *state);
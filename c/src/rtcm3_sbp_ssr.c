@@ -113,11 +113,11 @@ void rtcm3_ssr_orbit_clock_to_sbp(rtcm_msg_orbit_clock *msg_orbit_clock,
     sbp_orbit_clock->c2 = msg_orbit_clock->clock[sat_count].c2;
     length += sizeof(sbp_orbit_clock->c2);
 
-    state->cb_rtcm_to_sbp(SBP_MSG_SSR_ORBIT_CLOCK,
-                          length,
-                          (u8 *)sbp_orbit_clock,
-                          0,
-                          state->context);
+    send_sbp_msg(SBP_MSG_SSR_ORBIT_CLOCK,
+                 length,
+                 (u8 *)sbp_orbit_clock,
+                 0,
+                 state);
   }
 }
 
@@ -164,11 +164,11 @@ void rtcm3_ssr_code_bias_to_sbp(rtcm_msg_code_bias *msg_code_biases,
           msg_code_biases->sats[sat_count].signals[sig_count].code_bias;
       length += sizeof(sbp_code_bias->biases[sig_count].value);
     }
-    state->cb_rtcm_to_sbp(SBP_MSG_SSR_CODE_BIASES,
-                          length,
-                          (u8 *)sbp_code_bias,
-                          0,
-                          state->context);
+    send_sbp_msg(SBP_MSG_SSR_CODE_BIASES,
+                 length,
+                 (u8 *)sbp_code_bias,
+                 0,
+                 state);
   }
 }
 
@@ -249,10 +249,10 @@ void rtcm3_ssr_phase_bias_to_sbp(rtcm_msg_phase_bias *msg_phase_biases,
           msg_phase_biases->sats[sat_count].signals[sig_count].phase_bias;
       length += sizeof(sbp_phase_bias->biases[sig_count].bias);
     }
-    state->cb_rtcm_to_sbp(SBP_MSG_SSR_PHASE_BIASES,
-                          length,
-                          (u8 *)sbp_phase_bias,
-                          0,
-                          state->context);
+    send_sbp_msg(SBP_MSG_SSR_PHASE_BIASES,
+                 length,
+                 (u8 *)sbp_phase_bias,
+                 0,
+                 state);
   }
 }
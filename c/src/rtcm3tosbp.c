@@ -15,11 +15,17 @@
    well in embedded and cloud environments; likewise for live
    vs. pre-recorded data.  Note that by default it sets the time to
    the current system time, which may not be suitable for pre-recorded
-   data.  */
+   data.
+
+   With -t FILE the decode, convert, send and callback stages are traced
+   into FILE as Chrome trace events, this needs a library built with the
+   GNSSC_TRACE CMake option. */
 #include <assert.h>
+#include <errno.h>
 #include <gnss-converters/rtcm3_sbp.h>
 #include <libsbp/edc.h>
 #include <math.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,8 +39,48 @@
 #define FIFO_SIZE (1 << 14)
 #define BUFFER_SIZE (FIFO_SIZE - RTCM3_MSG_OVERHEAD - RTCM3_MAX_MSG_LEN)
 #define SBP_PREAMBLE 0x55
+/* longest wait for input before the flush timeout is checked again */
+#define TICK_INTERVAL_MS 100
+/* records drained to the trace file after every read */
+#define TRACE_RING_SIZE (1 << 16)
 
 static struct rtcm3_sbp_state state;
+static struct gnssc_trace trace;
+static gnssc_trace_record_t trace_records[TRACE_RING_SIZE];
+
+static u64 monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000 + (u64)ts.tv_nsec / 1000000;
+}
+
+static u64 monotonic_ns(void *context) {
+  (void)context;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000 + (u64)ts.tv_nsec;
+}
+
+/* Read from stdin, running rtcm2sbp_tick() while waiting so that the last
+ * epoch of a stalled stream is still flushed on its timeout */
+static ssize_t read_with_tick(uint8_t *buf, size_t len) {
+  struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+  for (;;) {
+    int ready = poll(&pfd, 1, TICK_INTERVAL_MS);
+    rtcm2sbp_tick(monotonic_ms(), &state);
+    if (ready > 0) {
+      return read(STDIN_FILENO, buf, len);
+    }
+    if (ready < 0 && EINTR != errno) {
+      return -1;
+    }
+  }
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "usage: %s [-t trace.json] < rtcm > sbp\n", prog);
+  fprintf(stderr, "  -t FILE  write a Chrome trace of the conversion stages\n");
+}
 
 static void update_obs_time(const msg_obs_t *msg) {
   gps_time_t obs_time;
@@ -121,10 +167,28 @@ static bool verify_crc(uint8_t *buf, uint16_t buf_len) {
 }
 
 int main(int argc, char **argv) {
-  (void)(argc); /* todo: accept arguments */
-  (void)(argv); /* todo: accept arguments */
   assert(FIFO_SIZE > RTCM3_MSG_OVERHEAD + RTCM3_MAX_MSG_LEN);
 
+  FILE *trace_file = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "ht:")) != -1) {
+    switch (opt) {
+      case 't':
+        trace_file = fopen(optarg, "w");
+        if (NULL == trace_file) {
+          fprintf(stderr, "Cannot open trace file %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'h':
+        usage(argv[0]);
+        return EXIT_SUCCESS;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
   /* set time from systime, account for UTC<->GPS leap second difference */
   time_t ct_utc_unix = time(NULL);
   gps_time_t noleapsec = time2gps_t(ct_utc_unix);
@@ -138,6 +202,17 @@ int main(int argc, char **argv) {
   rtcm2sbp_init(&state, cb_rtcm_to_sbp, cb_base_obs_invalid, NULL);
   rtcm2sbp_set_gps_time(&current_time, &state);
   rtcm2sbp_set_leap_second((s8)rint(gps_utc_offset), &state);
+  gnssc_diag_set_sink(&state.diag, gnssc_diag_stderr_sink, NULL);
+
+  if (NULL != trace_file) {
+#ifndef GNSSC_TRACE
+    fprintf(stderr, "Built without GNSSC_TRACE, the trace will be empty\n");
+#endif
+    gnssc_trace_init(
+        &trace, trace_records, TRACE_RING_SIZE, monotonic_ns, NULL);
+    rtcm2sbp_set_trace(&trace, &state);
+    gnssc_trace_json_begin(trace_file);
+  }
 
   uint8_t fifo_buf[FIFO_SIZE] = {0};
   fifo_t fifo;
@@ -145,7 +220,7 @@ int main(int argc, char **argv) {
 
   uint8_t inbuf[BUFFER_SIZE];
   ssize_t numread;
-  while ((numread = read(STDIN_FILENO, inbuf, BUFFER_SIZE)) > 0) {
+  while ((numread = read_with_tick(inbuf, BUFFER_SIZE)) > 0) {
     ssize_t numwritten = fifo_write(&fifo, inbuf, numread);
     if (numwritten != numread) {
       fprintf(stderr,
@@ -191,6 +266,18 @@ int main(int argc, char **argv) {
               numremoved);
     }
     assert(numremoved == index);
+
+    if (NULL != trace_file) {
+      gnssc_trace_write_json(&trace, trace_file);
+    }
+  }
+
+  if (NULL != trace_file) {
+    gnssc_trace_json_end(trace_file);
+    fclose(trace_file);
+    if (trace.n_overwritten > 0) {
+      fprintf(stderr, "%u trace records overwritten\n", trace.n_overwritten);
+    }
   }
   return 0;
 }
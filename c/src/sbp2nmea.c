@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* This is a stand-alone tool that takes Swift Binary Protocol (SBP) from a
+   file or stdin and writes NMEA on stdout. It is meant for bulk conversion
+   of recorded logs: a file is mapped into memory and framed in one pass,
+   stdin is read in large blocks, and the sentences of each epoch are
+   written with a single fwrite() into a large output buffer.
+
+   The sentences are sent every epoch unless set otherwise with -r, e.g.
+   "-r GSA=10 -r HDT=0" for GSA at every tenth epoch and no HDT. Observations
+   from the base station sender id given with -b are not used for GSA.
+
+   With several files, or with -o, each FILE is converted into FILE.nmea,
+   next to it or in the directory given with -o. The files are spread over
+   -j worker threads, each running its own converter state, so the output of
+   a file does not depend on the others or on the number of workers. Files
+   that would be converted into the same output, e.g. files of the same name
+   in different directories with -o, are refused before any conversion. The
+   total sentence rate is reported on stderr. */
+#include <assert.h>
+#include <fcntl.h>
+#include <gnss-converters/sbp_nmea.h>
+#include <inttypes.h>
+#include <libsbp/edc.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <swiftnav/constants.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SBP_PREAMBLE 0x55
+/* preamble, message type, sender id and length */
+#define SBP_HEADER_LEN 6
+#define SBP_CRC_LEN 2
+#define SBP_MAX_PAYLOAD_LEN 255
+#define SBP_MAX_FRAME_LEN (SBP_HEADER_LEN + SBP_MAX_PAYLOAD_LEN + SBP_CRC_LEN)
+/* block size when reading a stream */
+#define READ_BLOCK_SIZE (1 << 16)
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+/* a few epochs of every sentence type, GSA once per talker */
+#define BATCH_SIZE 4096
+#define DEFAULT_SOLN_FREQ 10.0f
+#define MAX_WORKERS 256
+/* longest solution and output period, longer ones overflow the time of week
+ * arithmetic of the rate check */
+#define WEEK_MS ((u64)WEEK_SECS * SECS_MS)
+
+static const char *const nmea_names[SBP2NMEA_NMEA_CNT] = {
+    [SBP2NMEA_NMEA_GGA] = "GGA",
+    [SBP2NMEA_NMEA_RMC] = "RMC",
+    [SBP2NMEA_NMEA_VTG] = "VTG",
+    [SBP2NMEA_NMEA_HDT] = "HDT",
+    [SBP2NMEA_NMEA_GLL] = "GLL",
+    [SBP2NMEA_NMEA_ZDA] = "ZDA",
+    [SBP2NMEA_NMEA_GSA] = "GSA",
+};
+
+/* Command line settings, the same for every conversion */
+typedef struct {
+  int rate[SBP2NMEA_NMEA_CNT];
+  float soln_freq;
+  u16 base_id;
+  /* NULL to write the outputs next to the inputs */
+  const char *out_dir;
+} settings_t;
+
+/* One conversion, from SBP in a file or stream to NMEA in out */
+typedef struct {
+  sbp2nmea_t state;
+  sbp2nmea_batch_t batch;
+  char batch_buf[BATCH_SIZE];
+  FILE *out;
+  u64 n_sentences;
+  u32 n_crc_errors;
+} converter_t;
+
+/* An input file of the bulk mode and its result */
+typedef struct {
+  const char *path;
+  /* NULL if the path of the output is too long */
+  char *out_path;
+  u64 n_sentences;
+  u32 n_crc_errors;
+  bool failed;
+} job_t;
+
+/* Hands out the jobs to the workers in order */
+typedef struct {
+  const settings_t *settings;
+  job_t *jobs;
+  size_t n_jobs;
+  size_t next_job;
+  pthread_mutex_t lock;
+} pool_t;
+
+static u64 monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000 + (u64)ts.tv_nsec;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [-r NMEA=RATE]... [-f HZ] [-b ID] [file] > nmea\n"
+          "       %s [-r NMEA=RATE]... [-f HZ] [-b ID] [-j N] [-o DIR] "
+          "file...\n",
+          prog,
+          prog);
+  fprintf(stderr,
+          "  -r NMEA=RATE  send GGA, RMC, VTG, HDT, GLL, ZDA or GSA every\n"
+          "                RATE solutions, 0 disables it (default 1)\n");
+  fprintf(stderr,
+          "  -f HZ         solution frequency of the log (default %.0f)\n",
+          (double)DEFAULT_SOLN_FREQ);
+  fprintf(stderr,
+          "  -b ID         sender id of the base station (default 0)\n");
+  fprintf(stderr,
+          "  -j N          convert N files at a time (default one per CPU)\n");
+  fprintf(stderr,
+          "  -o DIR        write FILE.nmea into DIR instead of next to FILE\n");
+  fprintf(stderr, "  file          SBP log, stdin if not given\n");
+}
+
+/* Parse "NMEA=RATE", returns false if it is not one */
+static bool parse_rate(const char *arg, settings_t *settings) {
+  const char *sep = strchr(arg, '=');
+  if (NULL == sep || '\0' == sep[1]) {
+    return false;
+  }
+  char *end;
+  long rate = strtol(sep + 1, &end, 10);
+  if ('\0' != *end || rate < 0 || rate > INT32_MAX) {
+    return false;
+  }
+  for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; id++) {
+    if (strlen(nmea_names[id]) == (size_t)(sep - arg) &&
+        0 == strncasecmp(arg, nmea_names[id], (size_t)(sep - arg))) {
+      settings->rate[id] = (int)rate;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Write the sentences of an epoch. Write errors show on the stream. */
+static void cb_batch(const char *sentences, size_t len, void *context) {
+  converter_t *conv = (converter_t *)context;
+  for (const char *p = sentences;
+       NULL != (p = memchr(p, '\n', len - (size_t)(p - sentences)));
+       p++) {
+    conv->n_sentences++;
+  }
+  fwrite(sentences, 1, len, conv->out);
+}
+
+/* Every state here has a batch, and the batch hands a sentence too long for
+ * it straight to cb_batch. So this only writes the sentences of a state
+ * without a batch. */
+static void cb_sentence(const char *sentence,
+                        size_t len,
+                        sbp2nmea_nmea_id_t id,
+                        void *context) {
+  (void)id;
+  cb_batch(sentence, len, context);
+}
+
+static void converter_init(converter_t *conv,
+                           const settings_t *settings,
+                           FILE *out) {
+  sbp2nmea_init_v2(&conv->state, cb_sentence, conv);
+  sbp2nmea_soln_freq_set(&conv->state, settings->soln_freq);
+  sbp2nmea_base_id_set(&conv->state, settings->base_id);
+  for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; id++) {
+    sbp2nmea_rate_set(&conv->state, settings->rate[id], id);
+  }
+  sbp2nmea_batch_init(
+      &conv->batch, conv->batch_buf, sizeof(conv->batch_buf), cb_batch);
+  sbp2nmea_set_batch(&conv->state, &conv->batch);
+  conv->out = out;
+  conv->n_sentences = 0;
+  conv->n_crc_errors = 0;
+}
+
+static void dispatch(converter_t *conv,
+                     u16 msg_type,
+                     u16 sender_id,
+                     const u8 *payload,
+                     u8 len) {
+  sbp2nmea_t *state = &conv->state;
+  /* sbp2nmea() copies the whole message, so a short payload is padded with
+   * zeroes. The union keeps the messages aligned. */
+  union {
+    sbp2nmea_msg_t msg;
+    u8 raw[SBP_MAX_PAYLOAD_LEN];
+  } buf;
+  memset(&buf, 0, sizeof(buf));
+  memcpy(buf.raw, payload, len);
+
+  switch (msg_type) {
+    case SBP_MSG_GPS_TIME:
+      sbp2nmea(state, &buf, SBP2NMEA_SBP_GPS_TIME);
+      break;
+    case SBP_MSG_UTC_TIME:
+      sbp2nmea(state, &buf, SBP2NMEA_SBP_UTC_TIME);
+      break;
+    case SBP_MSG_POS_LLH:
+      sbp2nmea(state, &buf, SBP2NMEA_SBP_POS_LLH);
+      break;
+    case SBP_MSG_VEL_NED:
+      sbp2nmea(state, &buf, SBP2NMEA_SBP_VEL_NED);
+      break;
+    case SBP_MSG_DOPS:
+      sbp2nmea(state, &buf, SBP2NMEA_SBP_DOPS);
+      break;
+    case SBP_MSG_AGE_CORRECTIONS:
+      sbp2nmea(state, &buf, SBP2NMEA_SBP_AGE_CORR);
+      break;
+    case SBP_MSG_BASELINE_HEADING:
+      sbp2nmea(state, &buf, SBP2NMEA_SBP_HDG);
+      break;
+    case SBP_MSG_OBS:
+      if (sender_id != sbp2nmea_base_id_get(state) &&
+          len >= sizeof(observation_header_t)) {
+        u8 num_obs = (u8)((len - sizeof(observation_header_t)) /
+                          sizeof(packed_obs_content_t));
+        sbp2nmea_obs(state, (const msg_obs_t *)&buf, num_obs);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/* Convert the complete frames in data. Returns the number of bytes used, the
+ * rest is the start of a frame that continues after the end of data. */
+static size_t process_block(converter_t *conv, const u8 *data, size_t len) {
+  size_t index = 0;
+  while (index + SBP_HEADER_LEN + SBP_CRC_LEN <= len) {
+    const u8 *frame = &data[index];
+    if (SBP_PREAMBLE != frame[0]) {
+      /* skip to the next candidate */
+      const u8 *next = memchr(frame + 1, SBP_PREAMBLE, len - index - 1);
+      index = (NULL == next) ? len : (size_t)(next - data);
+      continue;
+    }
+
+    u8 payload_len = frame[5];
+    size_t frame_len = SBP_HEADER_LEN + payload_len + SBP_CRC_LEN;
+    if (index + frame_len > len) {
+      break;
+    }
+
+    /* CRC does not cover preamble */
+    u16 crc = crc16_ccitt(frame + 1, SBP_HEADER_LEN - 1 + payload_len, 0);
+    u16 frame_crc = (u16)(frame[SBP_HEADER_LEN + payload_len] |
+                          (frame[SBP_HEADER_LEN + payload_len + 1] << 8));
+    if (crc != frame_crc) {
+      conv->n_crc_errors++;
+      index++;
+      continue;
+    }
+
+    u16 msg_type = (u16)(frame[1] | (frame[2] << 8));
+    u16 sender_id = (u16)(frame[3] | (frame[4] << 8));
+    dispatch(conv, msg_type, sender_id, frame + SBP_HEADER_LEN, payload_len);
+    index += frame_len;
+  }
+  return index;
+}
+
+/* Map the file into memory and convert it in one go. Returns false if it
+ * cannot be mapped, e.g. because it is a pipe. */
+static bool process_file(converter_t *conv, int fd) {
+  struct stat st;
+  if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+  if (0 == st.st_size) {
+    return true;
+  }
+
+  size_t size = (size_t)st.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == data) {
+    return false;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+  process_block(conv, (const u8 *)data, size);
+  munmap(data, size);
+  return true;
+}
+
+/* Returns false on a read error */
+static bool process_stream(converter_t *conv, int fd) {
+  const size_t size = READ_BLOCK_SIZE + SBP_MAX_FRAME_LEN;
+  u8 *buf = malloc(size);
+  if (NULL == buf) {
+    return false;
+  }
+  size_t len = 0;
+  ssize_t numread;
+  while ((numread = read(fd, &buf[len], size - len)) > 0) {
+    len += (size_t)numread;
+    size_t used = process_block(conv, buf, len);
+    /* keep the start of a frame for the next block */
+    memmove(buf, &buf[used], len - used);
+    len -= used;
+  }
+  free(buf);
+  return 0 == numread;
+}
+
+/* Convert everything in fd, returns false on a read or write error */
+static bool convert(converter_t *conv, int fd) {
+  bool ok = process_file(conv, fd) || process_stream(conv, fd);
+  sbp2nmea_flush(&conv->state);
+  return ok && 0 == fflush(conv->out) && !ferror(conv->out);
+}
+
+/* FILE.nmea, in the output directory if there is one */
+static bool output_path(const settings_t *settings,
+                        const char *path,
+                        char out_path[PATH_MAX]) {
+  int len;
+  if (NULL == settings->out_dir) {
+    len = snprintf(out_path, PATH_MAX, "%s.nmea", path);
+  } else {
+    const char *name = strrchr(path, '/');
+    name = (NULL == name) ? path : name + 1;
+    len = snprintf(
+        out_path, PATH_MAX, "%s/%s.nmea", settings->out_dir, name);
+  }
+  return len > 0 && len < PATH_MAX;
+}
+
+static void run_job(const settings_t *settings,
+                    job_t *job,
+                    converter_t *conv,
+                    char *out_buf) {
+  job->failed = true;
+  if (NULL == job->out_path) {
+    return;
+  }
+
+  int fd = open(job->path, O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  FILE *out = fopen(job->out_path, "wb");
+  if (NULL == out) {
+    close(fd);
+    return;
+  }
+  setvbuf(out, out_buf, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+  converter_init(conv, settings, out);
+  bool ok = convert(conv, fd);
+  close(fd);
+  ok = (0 == fclose(out)) && ok;
+
+  job->n_sentences = conv->n_sentences;
+  job->n_crc_errors = conv->n_crc_errors;
+  job->failed = !ok;
+}
+
+static int compare_out_paths(const void *a, const void *b) {
+  const job_t *job_a = *(const job_t *const *)a;
+  const job_t *job_b = *(const job_t *const *)b;
+  return strcmp(job_a->out_path, job_b->out_path);
+}
+
+/* Two jobs with the same output would write it at the same time, returns
+ * false and reports them if there are any */
+static bool out_paths_unique(job_t *jobs, size_t n_jobs) {
+  job_t **sorted = malloc(n_jobs * sizeof(job_t *));
+  if (NULL == sorted) {
+    fprintf(stderr, "Cannot allocate %zu jobs\n", n_jobs);
+    return false;
+  }
+  size_t n_sorted = 0;
+  for (size_t i = 0; i < n_jobs; i++) {
+    if (NULL != jobs[i].out_path) {
+      sorted[n_sorted++] = &jobs[i];
+    }
+  }
+  qsort(sorted, n_sorted, sizeof(job_t *), compare_out_paths);
+
+  bool unique = true;
+  for (size_t i = 1; i < n_sorted; i++) {
+    if (0 == strcmp(sorted[i - 1]->out_path, sorted[i]->out_path)) {
+      fprintf(stderr,
+              "%s and %s would both be converted into %s\n",
+              sorted[i - 1]->path,
+              sorted[i]->path,
+              sorted[i]->out_path);
+      unique = false;
+    }
+  }
+  free(sorted);
+  return unique;
+}
+
+static void *worker(void *arg) {
+  pool_t *pool = (pool_t *)arg;
+  converter_t *conv = malloc(sizeof(converter_t));
+  char *out_buf = malloc(OUTPUT_BUFFER_SIZE);
+
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    size_t i = pool->next_job++;
+    pthread_mutex_unlock(&pool->lock);
+    if (i >= pool->n_jobs) {
+      break;
+    }
+    if (NULL == conv || NULL == out_buf) {
+      pool->jobs[i].failed = true;
+      continue;
+    }
+    run_job(pool->settings, &pool->jobs[i], conv, out_buf);
+  }
+
+  free(out_buf);
+  free(conv);
+  return NULL;
+}
+
+static void free_jobs(job_t *jobs, size_t n_jobs) {
+  for (size_t i = 0; i < n_jobs; i++) {
+    free(jobs[i].out_path);
+  }
+  free(jobs);
+}
+
+/* Convert every file in paths into its own output, returns the exit code */
+static int run_bulk(const settings_t *settings,
+                    char **paths,
+                    size_t n_paths,
+                    long n_workers) {
+  job_t *jobs = calloc(n_paths, sizeof(job_t));
+  pthread_t threads[MAX_WORKERS];
+  if (NULL == jobs) {
+    fprintf(stderr, "Cannot allocate %zu jobs\n", n_paths);
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < n_paths; i++) {
+    char out_path[PATH_MAX];
+    jobs[i].path = paths[i];
+    if (output_path(settings, paths[i], out_path)) {
+      jobs[i].out_path = strdup(out_path);
+    }
+  }
+  if (!out_paths_unique(jobs, n_paths)) {
+    free_jobs(jobs, n_paths);
+    return EXIT_FAILURE;
+  }
+  if ((size_t)n_workers > n_paths) {
+    n_workers = (long)n_paths;
+  }
+
+  pool_t pool = {
+      .settings = settings, .jobs = jobs, .n_jobs = n_paths, .next_job = 0};
+  pthread_mutex_init(&pool.lock, NULL);
+  u64 start_ns = monotonic_ns();
+  long n_started = 0;
+  for (; n_started < n_workers; n_started++) {
+    if (0 != pthread_create(&threads[n_started], NULL, worker, &pool)) {
+      break;
+    }
+  }
+  if (0 == n_started) {
+    /* run the jobs on this thread */
+    worker(&pool);
+  }
+  for (long i = 0; i < n_started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  double seconds = (double)(monotonic_ns() - start_ns) * 1e-9;
+  pthread_mutex_destroy(&pool.lock);
+
+  /* the report is in the order of the inputs */
+  u64 n_sentences = 0;
+  size_t n_failed = 0;
+  for (size_t i = 0; i < n_paths; i++) {
+    const job_t *job = &jobs[i];
+    if (job->failed) {
+      fprintf(stderr, "%s: conversion failed\n", job->path);
+      n_failed++;
+    } else if (job->n_crc_errors > 0) {
+      fprintf(stderr,
+              "%s: %u frames with a bad CRC skipped\n",
+              job->path,
+              job->n_crc_errors);
+    }
+    n_sentences += job->n_sentences;
+  }
+  fprintf(stderr,
+          "%zu files, %" PRIu64 " sentences in %.3f s, %.0f sentences/s\n",
+          n_paths - n_failed,
+          n_sentences,
+          seconds,
+          seconds > 0 ? (double)n_sentences / seconds : 0.0);
+
+  free_jobs(jobs, n_paths);
+  return 0 == n_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Convert a single file or stdin to stdout, returns the exit code */
+static int run_single(const settings_t *settings, const char *path) {
+  static converter_t conv;
+  static char out_buf[OUTPUT_BUFFER_SIZE];
+
+  int fd = STDIN_FILENO;
+  if (NULL != path) {
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "Cannot open %s\n", path);
+      return EXIT_FAILURE;
+    }
+  }
+
+  setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+  converter_init(&conv, settings, stdout);
+  bool ok = convert(&conv, fd);
+  if (STDIN_FILENO != fd) {
+    close(fd);
+  }
+
+  if (conv.n_crc_errors > 0) {
+    fprintf(stderr, "%u frames with a bad CRC skipped\n", conv.n_crc_errors);
+  }
+  if (!ok) {
+    fprintf(stderr, "Conversion of %s failed\n", path ? path : "stdin");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+  settings_t settings = {
+      .soln_freq = DEFAULT_SOLN_FREQ, .base_id = 0, .out_dir = NULL};
+  for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; id++) {
+    settings.rate[id] = 1;
+  }
+  long n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+  int opt;
+  while ((opt = getopt(argc, argv, "hr:f:b:j:o:")) != -1) {
+    switch (opt) {
+      case 'r':
+        if (!parse_rate(optarg, &settings)) {
+          fprintf(stderr, "Invalid rate %s\n", optarg);
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'f': {
+        char *end;
+        settings.soln_freq = strtof(optarg, &end);
+        /* the solution period is used in whole milliseconds */
+        double period_ms = 1.0 / settings.soln_freq * 1e3;
+        if ('\0' != *end || !(settings.soln_freq > 0.0f) ||
+            !(period_ms >= 1.0) || period_ms > (double)WEEK_MS) {
+          fprintf(stderr, "Invalid solution frequency %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      }
+      case 'b': {
+        char *end;
+        long base_id = strtol(optarg, &end, 0);
+        if ('\0' != *end || base_id < 0 || base_id > UINT16_MAX) {
+          fprintf(stderr, "Invalid base station id %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+        settings.base_id = (u16)base_id;
+        break;
+      }
+      case 'j': {
+        char *end;
+        n_workers = strtol(optarg, &end, 10);
+        if ('\0' != *end || n_workers < 1 || n_workers > MAX_WORKERS) {
+          fprintf(stderr, "Invalid number of workers %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      }
+      case 'o':
+        settings.out_dir = optarg;
+        break;
+      case 'h':
+        usage(argv[0]);
+        return EXIT_SUCCESS;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  /* same period as in check_nmea_rate() */
+  u32 soln_period_ms = (u32)(1.0 / settings.soln_freq * 1e3);
+  for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; id++) {
+    if ((u64)settings.rate[id] * soln_period_ms > WEEK_MS) {
+      fprintf(stderr,
+              "Rate %d of %s is longer than a week at %g Hz\n",
+              settings.rate[id],
+              nmea_names[id],
+              (double)settings.soln_freq);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (n_workers < 1) {
+    n_workers = 1;
+  } else if (n_workers > MAX_WORKERS) {
+    n_workers = MAX_WORKERS;
+  }
+
+  int n_files = argc - optind;
+  if (n_files > 1 || (n_files > 0 && NULL != settings.out_dir)) {
+    return run_bulk(&settings, &argv[optind], (size_t)n_files, n_workers);
+  }
+  if (NULL != settings.out_dir) {
+    fprintf(stderr, "-o needs input files\n");
+    return EXIT_FAILURE;
+  }
+  return run_single(&settings, n_files > 0 ? argv[optind] : NULL);
+}
@@ -14,14 +14,20 @@
  * and writes RTCM3 on stdout. */
 
 #include <assert.h>
+#include <errno.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <gnss-converters/rtcm3_sbp.h>
 #include <libsbp/sbp.h>
 
+/* longest wait for input before the flush timeout is checked again */
+#define TICK_INTERVAL_MS 100
+
 /* Write the RTCM frame to STDOUT. */
 static void cb_sbp_to_rtcm(u8 *buffer, u16 n, void *context) {
   (void)(context);
@@ -33,8 +39,22 @@ static void cb_sbp_to_rtcm(u8 *buffer, u16 n, void *context) {
   }
 }
 
+static u64 monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000 + (u64)ts.tv_nsec / 1000000;
+}
+
+/* Read from stdin, returning nothing if no input comes within
+ * TICK_INTERVAL_MS so that the main loop runs sbp2rtcm_tick() on a stalled
+ * stream as well */
 static s32 sbp_read_stdin(u8 *buff, u32 n, void *context) {
   (void)context;
+  struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+  int ready = poll(&pfd, 1, TICK_INTERVAL_MS);
+  if (0 == ready || (ready < 0 && EINTR == errno)) {
+    return 0;
+  }
   ssize_t read_bytes = read(STDIN_FILENO, buff, n);
   if (read_bytes < 0) {
     fprintf(stderr, "Read failure at %d, %s. Aborting!\n", __LINE__, __FILE__);
@@ -68,6 +88,7 @@ int main(int argc, char **argv) {
   struct rtcm3_out_state state;
   sbp2rtcm_init(&state, cb_sbp_to_rtcm, NULL);
   sbp2rtcm_set_leap_second(18, &state); /* TODO */
+  gnssc_diag_set_sink(&state.diag, gnssc_diag_stderr_sink, NULL);
 
   sbp_msg_callbacks_node_t sbp_base_pos_callback_node;
   sbp_msg_callbacks_node_t sbp_glo_biases_callback_node;
@@ -99,6 +120,7 @@ int main(int argc, char **argv) {
                         &sbp_ephemeris_glo_callback_node);
 
   while (!feof(stdin)) {
+    sbp2rtcm_tick(monotonic_ms(), &state);
     sbp_process(&sbp_state, &sbp_read_stdin);
   }
   return 0;
@@ -12,6 +12,7 @@
 
 #include "sbp_nmea_internal.h"
 
+#include <assert.h>
 #include <math.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -23,6 +24,9 @@
 #include <swiftnav/constants.h>
 #include <swiftnav/gnss_time.h>
 
+_Static_assert(MAX_SATS >= 2 && MAX_SATS <= 256,
+               "GNSSC_MAX_SATS must be between 2 and 256");
+
 struct nmea_meta_entry {
   uint8_t tow_mask;
   void (*send)(const sbp2nmea_t *);
@@ -83,6 +87,12 @@ static double sbp_gpsdifftime(const sbp_gps_time_t *sbp_end,
   return gpsdifftime(&end, &begin);
 }
 
+/* Inputs a sentence needs from the current epoch. All of them are compared
+ * with the UTC time, which every sentence needs. */
+static uint8_t nmea_input_mask(sbp2nmea_nmea_id_t nmea_id) {
+  return nmea_meta[nmea_id].tow_mask | (1 << SBP2NMEA_SBP_UTC_TIME);
+}
+
 static bool nmea_ready(const sbp2nmea_t *state, sbp2nmea_nmea_id_t nmea_id) {
   if (state->nmea_state[nmea_id].last_tow ==
       get_tow(state, SBP2NMEA_SBP_UTC_TIME)) {
@@ -112,26 +122,70 @@ static bool nmea_ready(const sbp2nmea_t *state, sbp2nmea_nmea_id_t nmea_id) {
 
   /* check that the time stamps of the component messages match that of the UTC
    * time message */
-  for (sbp2nmea_sbp_id_t sbp_id = 0; sbp_id < SBP2NMEA_SBP_CNT; ++sbp_id) {
-    if (nmea_meta[nmea_id].tow_mask & (1 << sbp_id)) {
-      if (get_tow(state, sbp_id) != get_tow(state, SBP2NMEA_SBP_UTC_TIME)) {
-        return false;
+  const uint8_t input_mask = nmea_input_mask(nmea_id);
+  return (state->epoch_mask & input_mask) == input_mask;
+}
+
+static void batch_flush(const sbp2nmea_t *state) {
+  sbp2nmea_batch_t *batch = state->batch;
+  if (batch->len > 0) {
+    batch->cb_batch(batch->buf, batch->len, state->context);
+    batch->len = 0;
+  }
+}
+
+/* True if a sentence due at the current epoch has not been sent yet */
+static bool nmea_pending(const sbp2nmea_t *state, u32 tow) {
+  for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; ++id) {
+    if (state->nmea_state[id].last_tow != tow &&
+        check_nmea_rate(state->nmea_state[id].rate, tow, state->soln_freq)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Update the inputs of the current epoch for a new message of type sbp_id.
+ * Returns the inputs that have just become part of the epoch, the UTC time
+ * starting an epoch brings in all of those that arrived ahead of it. */
+static uint8_t update_epoch_mask(sbp2nmea_t *state,
+                                 sbp2nmea_sbp_id_t sbp_id,
+                                 u32 prev_tow) {
+  const u32 tow = get_tow(state, SBP2NMEA_SBP_UTC_TIME);
+  const uint8_t prev_mask = state->epoch_mask;
+
+  if (SBP2NMEA_SBP_UTC_TIME == sbp_id) {
+    if (tow == prev_tow) {
+      return 0;
+    }
+    uint8_t mask = 0;
+    for (sbp2nmea_sbp_id_t id = 0; id < SBP2NMEA_SBP_CNT; ++id) {
+      if (get_tow(state, id) == tow) {
+        mask |= (uint8_t)(1 << id);
       }
     }
+    state->epoch_mask = mask;
+    return mask;
   }
 
-  return true;
+  if (get_tow(state, sbp_id) == tow) {
+    state->epoch_mask |= (uint8_t)(1 << sbp_id);
+  } else {
+    state->epoch_mask &= (uint8_t)~(1 << sbp_id);
+  }
+  return state->epoch_mask & (uint8_t)~prev_mask;
 }
 
-/* Send all the NMEA messages that have become ready to send */
-static void check_nmea_send(sbp2nmea_t *state) {
+/* Send the NMEA messages with an id in candidates (a bit mask) that have
+ * become ready to send */
+static void check_nmea_send(sbp2nmea_t *state, uint8_t candidates) {
   const u32 tow = get_tow(state, SBP2NMEA_SBP_UTC_TIME);
   const float freq = state->soln_freq;
 
   /* Send each NMEA message if all its component SBP messages have been received
    * and current time matches the send rate */
   for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; ++id) {
-    if (!nmea_ready(state, id)) {
+    if (!(candidates & (1 << id)) || !nmea_ready(state, id)) {
       continue;
     }
 
@@ -142,13 +196,41 @@ static void check_nmea_send(sbp2nmea_t *state) {
     nmea_meta[id].send(state);
     state->nmea_state[id].last_tow = tow;
   }
+
+  if (NULL != state->batch && !nmea_pending(state, tow)) {
+    batch_flush(state);
+  }
 }
 
 void sbp2nmea(sbp2nmea_t *state,
               const void *sbp_msg,
               sbp2nmea_sbp_id_t sbp_id) {
+  const u32 prev_tow = get_tow(state, SBP2NMEA_SBP_UTC_TIME);
   memcpy(sbp2nmea_msg_get(state, sbp_id), sbp_msg, sbp_meta[sbp_id].msg_size);
-  check_nmea_send(state);
+  if (SBP2NMEA_SBP_UTC_TIME == sbp_id) {
+    nmea_utc_fields_update(&state->utc_fields, sbp_msg);
+  }
+
+  const uint8_t new_inputs = update_epoch_mask(state, sbp_id, prev_tow);
+  if (0 == new_inputs) {
+    return;
+  }
+
+  const u32 tow = get_tow(state, SBP2NMEA_SBP_UTC_TIME);
+  if (NULL != state->batch && state->batch->tow != tow) {
+    /* the previous epoch is over even if some of its sentences are missing */
+    batch_flush(state);
+    state->batch->tow = tow;
+  }
+
+  /* only the sentences needing one of the new inputs can have become ready */
+  uint8_t candidates = 0;
+  for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; ++id) {
+    if (nmea_input_mask(id) & new_inputs) {
+      candidates |= (uint8_t)(1 << id);
+    }
+  }
+  check_nmea_send(state, candidates);
 }
 
 void sbp2nmea_base_id_set(sbp2nmea_t *state, const uint16_t base_sender_id) {
@@ -165,6 +247,10 @@ const sbp_gnss_signal_t *sbp2nmea_nav_sids_get(const sbp2nmea_t *state) {
   return state->nav_sids;
 }
 
+const sbp2nmea_sv_set_t *sbp2nmea_nav_svs_get(const sbp2nmea_t *state) {
+  return state->nav_svs;
+}
+
 static void unpack_obs_header(const observation_header_t *header,
                               sbp_gps_time_t *obs_time,
                               u8 *total,
@@ -184,6 +270,7 @@ void sbp2nmea_obs(sbp2nmea_t *state,
   /* Count zero means it's the first message in a sequence */
   if (count == 0) {
     state->num_obs = 0;
+    memset(state->nav_svs, 0, sizeof(state->nav_svs));
   } else if ((fabs(sbp_gpsdifftime(&obs_time, &state->obs_time)) >
               FLOAT_EQUALITY_EPS) ||
              (state->obs_time.wn != obs_time.wn) ||
@@ -195,17 +282,65 @@ void sbp2nmea_obs(sbp2nmea_t *state,
   state->obs_time = obs_time;
 
   for (int i = 0; i < num_obs; i++) {
-    if (!(sbp_obs->obs[i].flags & OBSERVATION_VALID)) {
+    if (sbp_obs->obs[i].flags & OBSERVATION_VALID) {
+      continue;
+    }
+    nmea_sv_set_add(state->nav_svs, sbp_obs->obs[i].sid);
+    /* the last entry stays unused so that num_obs cannot wrap */
+    if (state->num_obs < MAX_SATS - 1) {
       state->nav_sids[state->num_obs] = sbp_obs->obs[i].sid;
       state->num_obs++;
     }
   }
 
-  check_nmea_send(state);
+  /* the observations only complete the GSA sentence */
+  check_nmea_send(state, 1 << SBP2NMEA_NMEA_GSA);
+}
+
+void sbp2nmea_output(const sbp2nmea_t *state,
+                     const char *sentence,
+                     size_t len,
+                     sbp2nmea_nmea_id_t id) {
+  sbp2nmea_batch_t *batch = state->batch;
+  if (NULL != batch) {
+    if (batch->len + len > batch->size) {
+      batch_flush(state);
+    }
+    if (len > batch->size) {
+      batch->cb_batch(sentence, len, state->context);
+      return;
+    }
+    memcpy(batch->buf + batch->len, sentence, len);
+    batch->len += len;
+    return;
+  }
+
+  if (NULL != state->cb_sentence) {
+    state->cb_sentence(sentence, len, id, state->context);
+  } else {
+    state->cb_sbp_to_nmea(sentence);
+  }
 }
 
 void sbp2nmea_to_str(const sbp2nmea_t *state, char *sentence) {
-  state->cb_sbp_to_nmea(sentence);
+  static const char *const types[SBP2NMEA_NMEA_CNT] = {
+      [SBP2NMEA_NMEA_GGA] = "GGA",
+      [SBP2NMEA_NMEA_RMC] = "RMC",
+      [SBP2NMEA_NMEA_VTG] = "VTG",
+      [SBP2NMEA_NMEA_HDT] = "HDT",
+      [SBP2NMEA_NMEA_GLL] = "GLL",
+      [SBP2NMEA_NMEA_ZDA] = "ZDA",
+      [SBP2NMEA_NMEA_GSA] = "GSA",
+  };
+  size_t len = strlen(sentence);
+  /* the type follows the "$" and the two character talker id, sentences of
+   * other types are given SBP2NMEA_NMEA_CNT */
+  sbp2nmea_nmea_id_t id = SBP2NMEA_NMEA_GGA;
+  while (id < SBP2NMEA_NMEA_CNT &&
+         (len < 6 || 0 != memcmp(&sentence[3], types[id], 3))) {
+    id++;
+  }
+  sbp2nmea_output(state, sentence, len, id);
 }
 
 void *sbp2nmea_msg_get(const sbp2nmea_t *state, sbp2nmea_sbp_id_t id) {
@@ -224,3 +359,41 @@ void sbp2nmea_init(sbp2nmea_t *state, void (*cb_sbp_to_nmea)(u8 msg_id[])) {
   memset(state, 0, sizeof(*state));
   state->cb_sbp_to_nmea = cb_sbp_to_nmea;
 }
+
+void sbp2nmea_init_v2(sbp2nmea_t *state,
+                      void (*cb_sentence)(const char *sentence,
+                                          size_t len,
+                                          sbp2nmea_nmea_id_t id,
+                                          void *context),
+                      void *context) {
+  memset(state, 0, sizeof(*state));
+  state->cb_sentence = cb_sentence;
+  state->context = context;
+}
+
+void sbp2nmea_batch_init(sbp2nmea_batch_t *batch,
+                         char buf[],
+                         size_t size,
+                         void (*cb_batch)(const char *batch,
+                                          size_t len,
+                                          void *context)) {
+  assert(NULL != cb_batch);
+  batch->buf = buf;
+  batch->size = size;
+  batch->len = 0;
+  batch->tow = TOW_INVALID;
+  batch->cb_batch = cb_batch;
+}
+
+void sbp2nmea_set_batch(sbp2nmea_t *state, sbp2nmea_batch_t *batch) {
+  if (NULL != state->batch) {
+    sbp2nmea_flush(state);
+  }
+  state->batch = batch;
+}
+
+void sbp2nmea_flush(sbp2nmea_t *state) {
+  if (NULL != state->batch) {
+    batch_flush(state);
+  }
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "gnss-converters/sbp_nmea_hub.h"
+#include "sbp_nmea_internal.h"
+
+#include <assert.h>
+#include <string.h>
+
+static int gcd(int a, int b) {
+  while (0 != b) {
+    int r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+static u32 hub_tow(const sbp2nmea_hub_t *hub) {
+  const msg_utc_time_t *utc_time =
+      sbp2nmea_msg_get(&hub->in, SBP2NMEA_SBP_UTC_TIME);
+  return utc_time->tow;
+}
+
+/* format each sentence type only as often as some subscriber wants it */
+static void update_rate(sbp2nmea_hub_t *hub, sbp2nmea_nmea_id_t id) {
+  int rate = 0;
+  for (u8 i = 0; i < SBP2NMEA_HUB_MAX_SUBSCRIBERS; i++) {
+    const sbp2nmea_hub_subscriber_t *sub = &hub->subscribers[i];
+    if (NULL != sub->cb_sentence && sub->rate[id] > 0) {
+      rate = gcd(rate, sub->rate[id]);
+    }
+  }
+  sbp2nmea_rate_set(&hub->in, rate, id);
+}
+
+static void cache_sentence(sbp2nmea_hub_t *hub,
+                           const char *sentence,
+                           size_t len,
+                           sbp2nmea_nmea_id_t id,
+                           u32 tow) {
+  /* there is no slot for the types the converter does not generate */
+  if (id >= SBP2NMEA_NMEA_CNT) {
+    return;
+  }
+  if (hub->cache_tow != tow) {
+    hub->cache_tow = tow;
+    hub->cache_len = 0;
+    memset(hub->cache_sentence_len, 0, sizeof(hub->cache_sentence_len));
+  }
+
+  /* the GSA sentences of an epoch are formatted one after the other, so
+   * they are contiguous in the cache */
+  bool append = hub->cache_sentence_len[id] > 0;
+  if (append && hub->cache_offset[id] + hub->cache_sentence_len[id] !=
+                    hub->cache_len) {
+    hub->n_uncached++;
+    return;
+  }
+  if (hub->cache_len + len > SBP2NMEA_HUB_CACHE_SIZE) {
+    hub->n_uncached++;
+    return;
+  }
+
+  memcpy(&hub->cache[hub->cache_len], sentence, len);
+  if (!append) {
+    hub->cache_offset[id] = hub->cache_len;
+  }
+  hub->cache_sentence_len[id] += (uint16_t)len;
+  hub->cache_len += (uint16_t)len;
+}
+
+/* output of the input state, formatted once and passed to the subscribers.
+ * Sentences of the caller given to sbp2nmea_to_str() on the input state may
+ * be of a type the converter does not generate, those have no rate and go to
+ * every subscriber. */
+static void hub_sentence_cb(const char *sentence,
+                            size_t len,
+                            sbp2nmea_nmea_id_t id,
+                            void *context) {
+  sbp2nmea_hub_t *hub = (sbp2nmea_hub_t *)context;
+  const u32 tow = hub_tow(hub);
+  const bool generated = id < SBP2NMEA_NMEA_CNT;
+  if (generated) {
+    hub->n_formatted++;
+  }
+  cache_sentence(hub, sentence, len, id, tow);
+
+  for (u8 i = 0; i < SBP2NMEA_HUB_MAX_SUBSCRIBERS; i++) {
+    const sbp2nmea_hub_subscriber_t *sub = &hub->subscribers[i];
+    if (NULL != sub->cb_sentence &&
+        (!generated ||
+         check_nmea_rate(sub->rate[id], tow, hub->in.soln_freq))) {
+      sub->cb_sentence(sentence, len, id, sub->context);
+    }
+  }
+}
+
+void sbp2nmea_hub_init(sbp2nmea_hub_t *hub) {
+  memset(hub, 0, sizeof(*hub));
+  sbp2nmea_init_v2(&hub->in, hub_sentence_cb, hub);
+  hub->cache_tow = TOW_INVALID;
+}
+
+int sbp2nmea_hub_subscribe(sbp2nmea_hub_t *hub,
+                           void (*cb_sentence)(const char *sentence,
+                                               size_t len,
+                                               sbp2nmea_nmea_id_t id,
+                                               void *context),
+                           void *context) {
+  assert(NULL != cb_sentence);
+  for (u8 i = 0; i < SBP2NMEA_HUB_MAX_SUBSCRIBERS; i++) {
+    sbp2nmea_hub_subscriber_t *sub = &hub->subscribers[i];
+    if (NULL == sub->cb_sentence) {
+      memset(sub, 0, sizeof(*sub));
+      sub->cb_sentence = cb_sentence;
+      sub->context = context;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void sbp2nmea_hub_unsubscribe(sbp2nmea_hub_t *hub, int subscriber) {
+  assert(subscriber >= 0 && subscriber < SBP2NMEA_HUB_MAX_SUBSCRIBERS);
+  memset(&hub->subscribers[subscriber], 0, sizeof(sbp2nmea_hub_subscriber_t));
+  for (sbp2nmea_nmea_id_t id = 0; id < SBP2NMEA_NMEA_CNT; id++) {
+    update_rate(hub, id);
+  }
+}
+
+void sbp2nmea_hub_rate_set(sbp2nmea_hub_t *hub,
+                           int subscriber,
+                           int rate,
+                           sbp2nmea_nmea_id_t id) {
+  assert(subscriber >= 0 && subscriber < SBP2NMEA_HUB_MAX_SUBSCRIBERS);
+  assert(NULL != hub->subscribers[subscriber].cb_sentence);
+  assert(id < SBP2NMEA_NMEA_CNT);
+  hub->subscribers[subscriber].rate[id] = rate;
+  update_rate(hub, id);
+}
+
+void sbp2nmea_hub(sbp2nmea_hub_t *hub,
+                  const void *sbp_msg,
+                  sbp2nmea_sbp_id_t sbp_id) {
+  sbp2nmea(&hub->in, sbp_msg, sbp_id);
+}
+
+void sbp2nmea_hub_obs(sbp2nmea_hub_t *hub,
+                      const msg_obs_t *sbp_obs,
+                      uint8_t num_obs) {
+  sbp2nmea_obs(&hub->in, sbp_obs, num_obs);
+}
+
+size_t sbp2nmea_hub_get(const sbp2nmea_hub_t *hub,
+                        sbp2nmea_nmea_id_t id,
+                        const char **sentences) {
+  if (id >= SBP2NMEA_NMEA_CNT || hub->cache_tow != hub_tow(hub) ||
+      0 == hub->cache_sentence_len[id]) {
+    *sentences = NULL;
+    return 0;
+  }
+  *sentences = &hub->cache[hub->cache_offset[id]];
+  return hub->cache_sentence_len[id];
+}
@@ -23,6 +23,22 @@
 #define MSG_OBS_HEADER_SEQ_SHIFT 4u
 #define MSG_OBS_HEADER_SEQ_MASK ((1 << 4u) - 1)
 
+/* Add the satellite of sid to the set of its talker id in svs, unsupported
+ * constellations are ignored */
+void nmea_sv_set_add(sbp2nmea_sv_set_t svs[SBP2NMEA_TALKER_CNT],
+                     sbp_gnss_signal_t sid);
+
+/* Format the UTC time fields of the sentences for a new UTC time message */
+void nmea_utc_fields_update(sbp2nmea_utc_fields_t *fields,
+                            const msg_utc_time_t *sbp_utc_time);
+
+/* Output a sentence of len characters and type id through the callbacks of
+ * the state or into its batch */
+void sbp2nmea_output(const sbp2nmea_t *state,
+                     const char *sentence,
+                     size_t len,
+                     sbp2nmea_nmea_id_t id);
+
 void get_utc_time_string(bool time,
                          bool date,
                          bool trunc_date,
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "gnss-converters/stats.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+static const char *const drop_names[GNSSC_STATS_DROP_COUNT] = {
+    [GNSSC_STATS_DROP_NO_TIME] = "NO_TIME",
+    [GNSSC_STATS_DROP_INVALID_TIME] = "INVALID_TIME",
+    [GNSSC_STATS_DROP_MSM_ACTIVE] = "MSM_ACTIVE",
+    [GNSSC_STATS_DROP_DECIMATED] = "DECIMATED",
+    [GNSSC_STATS_DROP_LATE] = "LATE",
+    [GNSSC_STATS_DROP_SEQ_INVALID] = "SEQ_INVALID",
+    [GNSSC_STATS_DROP_BUFFER_FULL] = "BUFFER_FULL",
+    [GNSSC_STATS_DROP_UNSUPPORTED_CODE] = "UNSUPPORTED_CODE",
+    [GNSSC_STATS_DROP_QUEUE_FULL] = "QUEUE_FULL",
+};
+
+/* The sequence counter is odd while an update is in progress. The fences
+ * pair with the ones in gnssc_stats_snapshot() so that a reader seeing the
+ * same even count before and after its copy has not overlapped an update. */
+static void write_begin(struct gnssc_stats *stats) {
+  u32 seq = __atomic_load_n(&stats->seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(struct gnssc_stats *stats) {
+  u32 seq = __atomic_load_n(&stats->seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static u8 hist_bin(u64 time_ns) {
+  if (0 == time_ns) {
+    return 0;
+  }
+  u8 bin = (u8)(63 - __builtin_clzll(time_ns));
+  return bin < GNSSC_STATS_HIST_BINS ? bin : GNSSC_STATS_HIST_BINS - 1;
+}
+
+void gnssc_stats_init(struct gnssc_stats *stats,
+                      u64 (*clock_ns)(void *context),
+                      void *context) {
+  memset(stats, 0, sizeof(*stats));
+  stats->clock_ns = clock_ns;
+  stats->clock_context = context;
+}
+
+void gnssc_stats_clear(struct gnssc_stats *stats) {
+  write_begin(stats);
+  memset(stats->drops, 0, sizeof(stats->drops));
+  stats->obs_in = 0;
+  stats->obs_out = 0;
+  stats->n_other_msgs = 0;
+  stats->n_msg_types = 0;
+  memset(stats->msgs, 0, sizeof(stats->msgs));
+  write_end(stats);
+}
+
+bool gnssc_stats_snapshot(const struct gnssc_stats *stats,
+                          struct gnssc_stats *out) {
+  for (u8 i = 0; i < GNSSC_STATS_SNAPSHOT_RETRIES; i++) {
+    u32 seq = __atomic_load_n(&stats->seq, __ATOMIC_ACQUIRE);
+    memcpy(out, stats, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (0 == (seq & 1) &&
+        seq == __atomic_load_n(&stats->seq, __ATOMIC_RELAXED)) {
+      out->seq = seq;
+      return true;
+    }
+  }
+  return false;
+}
+
+const gnssc_msg_stats_t *gnssc_stats_msg(const struct gnssc_stats *stats,
+                                         u16 msg_num) {
+  for (u16 i = 0; i < stats->n_msg_types && i < GNSSC_STATS_MAX_MSG_TYPES;
+       i++) {
+    if (stats->msgs[i].msg_num == msg_num) {
+      return &stats->msgs[i];
+    }
+  }
+  return NULL;
+}
+
+const char *gnssc_stats_drop_name(gnssc_stats_drop_t drop) {
+  if (drop >= GNSSC_STATS_DROP_COUNT) {
+    return "UNKNOWN";
+  }
+  return drop_names[drop];
+}
+
+u64 gnssc_stats_now(const struct gnssc_stats *stats) {
+  if (NULL == stats || NULL == stats->clock_ns) {
+    return 0;
+  }
+  return stats->clock_ns(stats->clock_context);
+}
+
+void gnssc_stats_msg_done(struct gnssc_stats *stats,
+                          u16 msg_num,
+                          bool decode_error,
+                          u64 start_ns) {
+  if (NULL == stats) {
+    return;
+  }
+
+  /* read the clock before taking the block so that the time spent in it is
+   * not part of the update */
+  u64 time_ns = 0;
+  if (NULL != stats->clock_ns) {
+    u64 now_ns = stats->clock_ns(stats->clock_context);
+    time_ns = now_ns > start_ns ? now_ns - start_ns : 0;
+  }
+
+  write_begin(stats);
+  gnssc_msg_stats_t *msg = (gnssc_msg_stats_t *)gnssc_stats_msg(stats, msg_num);
+  if (NULL == msg && stats->n_msg_types < GNSSC_STATS_MAX_MSG_TYPES) {
+    msg = &stats->msgs[stats->n_msg_types++];
+    msg->msg_num = msg_num;
+  }
+  if (NULL == msg) {
+    stats->n_other_msgs++;
+  } else {
+    msg->count++;
+    if (decode_error) {
+      msg->decode_errors++;
+    }
+    if (NULL != stats->clock_ns) {
+      msg->time_hist[hist_bin(time_ns)]++;
+    }
+  }
+  write_end(stats);
+}
+
+void gnssc_stats_drop(struct gnssc_stats *stats,
+                      gnssc_stats_drop_t drop,
+                      u32 count) {
+  if (NULL == stats) {
+    return;
+  }
+  assert(drop < GNSSC_STATS_DROP_COUNT);
+
+  write_begin(stats);
+  stats->drops[drop] += count;
+  write_end(stats);
+}
+
+void gnssc_stats_obs(struct gnssc_stats *stats, u32 obs_in, u32 obs_out) {
+  if (NULL == stats) {
+    return;
+  }
+
+  write_begin(stats);
+  stats->obs_in += obs_in;
+  stats->obs_out += obs_out;
+  write_end(stats);
+}
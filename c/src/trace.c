@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2019 Swift Navigation Inc.
+ * Contact: Swift Navigation <dev@swiftnav.com>
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "gnss-converters/trace.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+/* deepest nesting tracked, one bit of open_levels per level */
+#define TRACE_MAX_DEPTH 31
+
+static const char *const stage_names[GNSSC_TRACE_STAGE_COUNT] = {
+    [GNSSC_TRACE_DECODE] = "decode",
+    [GNSSC_TRACE_CONVERT] = "convert",
+    [GNSSC_TRACE_SEND_OBS] = "send_observations",
+    [GNSSC_TRACE_CALLBACK] = "callback",
+};
+
+void gnssc_trace_init(struct gnssc_trace *trace,
+                      gnssc_trace_record_t records[],
+                      u32 size,
+                      u64 (*clock_ns)(void *context),
+                      void *context) {
+  assert(size > 0 && 0 == (size & (size - 1)) && NULL != clock_ns);
+  trace->clock_ns = clock_ns;
+  trace->clock_context = context;
+  trace->records = records;
+  trace->size = size;
+  trace->head = 0;
+  trace->tail = 0;
+  trace->n_overwritten = 0;
+  trace->depth = 0;
+  trace->open_levels = 0;
+}
+
+void gnssc_trace_record(struct gnssc_trace *trace,
+                        gnssc_trace_stage_t stage,
+                        gnssc_trace_phase_t phase,
+                        u16 msg_num) {
+  if (NULL == trace) {
+    return;
+  }
+  if (trace->head - trace->tail >= trace->size) {
+    trace->tail++;
+    trace->n_overwritten++;
+  }
+
+  if (GNSSC_TRACE_EXIT == phase && trace->depth > 0) {
+    trace->depth--;
+  }
+  gnssc_trace_record_t *record =
+      &trace->records[trace->head & (trace->size - 1)];
+  record->time_ns = trace->clock_ns(trace->clock_context);
+  record->msg_num = msg_num;
+  record->stage = (u8)stage;
+  record->phase = (u8)phase;
+  record->depth = trace->depth;
+  if (GNSSC_TRACE_ENTRY == phase && trace->depth < TRACE_MAX_DEPTH) {
+    trace->depth++;
+  }
+  trace->head++;
+}
+
+bool gnssc_trace_next(struct gnssc_trace *trace, gnssc_trace_record_t *record) {
+  while (trace->head != trace->tail) {
+    *record = trace->records[trace->tail & (trace->size - 1)];
+    trace->tail++;
+    u32 level = 1u << record->depth;
+    if (GNSSC_TRACE_ENTRY == record->phase) {
+      trace->open_levels |= level;
+      return true;
+    }
+    if (0 != (trace->open_levels & level)) {
+      trace->open_levels &= ~level;
+      return true;
+    }
+    /* the entry was overwritten, an exit on its own would unbalance the
+     * Chrome trace */
+  }
+  return false;
+}
+
+const char *gnssc_trace_stage_name(gnssc_trace_stage_t stage) {
+  if (stage >= GNSSC_TRACE_STAGE_COUNT) {
+    return "unknown";
+  }
+  return stage_names[stage];
+}
+
+void gnssc_trace_json_begin(FILE *file) { fprintf(file, "[\n"); }
+
+u32 gnssc_trace_write_json(struct gnssc_trace *trace, FILE *file) {
+  u32 n_written = 0;
+  gnssc_trace_record_t record;
+  while (gnssc_trace_next(trace, &record)) {
+    /* every event ends with a comma, gnssc_trace_json_end() closes the array
+     * with a metadata event */
+    fprintf(file,
+            "{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%" PRIu64
+            ".%03u,\"pid\":0,\"tid\":0,\"args\":{\"msg\":%u}},\n",
+            gnssc_trace_stage_name((gnssc_trace_stage_t)record.stage),
+            GNSSC_TRACE_ENTRY == record.phase ? "B" : "E",
+            record.time_ns / 1000,
+            (unsigned)(record.time_ns % 1000),
+            (unsigned)record.msg_num);
+    n_written++;
+  }
+  return n_written;
+}
+
+void gnssc_trace_json_end(FILE *file) {
+  fprintf(file,
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+          "\"args\":{\"name\":\"gnss-converters\"}}\n]\n");
+}
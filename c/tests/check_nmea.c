@@ -12,12 +12,16 @@
 
 #include <assert.h>
 #include <check.h>
+#include <gnss-converters/nmea_sbp.h>
 #include <gnss-converters/sbp_nmea.h>
+#include <gnss-converters/sbp_nmea_hub.h>
 #include <libsbp/sbp.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <swiftnav/signal.h>
+#include "../src/nmea_format.h"
 #include "../src/sbp_nmea_internal.h"
 
 #include "check_suites.h"
@@ -411,6 +415,622 @@ START_TEST(test_nmea_time_string) {
 }
 END_TEST
 
+START_TEST(test_nmea_utc_fields) {
+  sbp2nmea_utc_fields_t fields;
+  memset(&fields, 0, sizeof(fields));
+  msg_utc_time_t msg_time = {.flags = 1,
+                             .year = 2019,
+                             .month = 12,
+                             .day = 31,
+                             .hours = 23,
+                             .minutes = 59,
+                             .seconds = 59,
+                             .ns = 800000000};
+
+  nmea_utc_fields_update(&fields, &msg_time);
+  ck_assert_str_eq(fields.time, "235959.80");
+  ck_assert_str_eq(fields.date, "311219");
+  ck_assert_str_eq(fields.date_long, "31,12,2019");
+
+  /* the next epoch only changes the fraction */
+  msg_time.ns = 900000000;
+  nmea_utc_fields_update(&fields, &msg_time);
+  ck_assert_str_eq(fields.time, "235959.90");
+  ck_assert_str_eq(fields.date_long, "31,12,2019");
+
+  /* rounding to the next day and year */
+  msg_time.ns = 999999999;
+  nmea_utc_fields_update(&fields, &msg_time);
+  ck_assert_str_eq(fields.time, "000000.00");
+  ck_assert_str_eq(fields.date, "010120");
+  ck_assert_str_eq(fields.date_long, "01,01,2020");
+
+  /* empty fields in between do not leave stale digits */
+  msg_time.flags = 0;
+  nmea_utc_fields_update(&fields, &msg_time);
+  ck_assert_uint_eq(fields.rounded.flags, 0);
+  msg_time = (msg_utc_time_t){
+      .flags = 1, .year = 2020, .month = 2, .day = 3, .hours = 4};
+  nmea_utc_fields_update(&fields, &msg_time);
+  ck_assert_str_eq(fields.time, "040000.00");
+  ck_assert_str_eq(fields.date, "030220");
+  ck_assert_str_eq(fields.date_long, "03,02,2020");
+}
+END_TEST
+
+static bool check_fmt_fixed(double value, u8 decimals, u8 width) {
+  char expected[64];
+  char buf[64];
+  nmea_fmt_t fmt;
+  snprintf(expected, sizeof(expected), "%0*.*f", width, decimals, value);
+  nmea_fmt_init(&fmt, buf, sizeof(buf) - 1);
+  nmea_fmt_fixed(&fmt, value, decimals, width);
+  *fmt.p = '\0';
+  if (strcmp(expected, buf)) {
+    fprintf(stderr, "expected %s, got %s\n", expected, buf);
+    return false;
+  }
+  return true;
+}
+
+START_TEST(test_nmea_format) {
+  const double values[] = {0.0,
+                           -0.0,
+                           0.05,
+                           0.15,
+                           0.25,
+                           -0.04,
+                           0.125,
+                           2.675,
+                           9.995,
+                           59.99999999,
+                           99.95,
+                           1e-10,
+                           -1e-10,
+                           123456789.5,
+                           4503599627370495.5,
+                           1e300,
+                           -1e300,
+                           INFINITY,
+                           -INFINITY,
+                           NAN};
+  for (u8 i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    for (u8 decimals = 0; decimals <= NMEA_FMT_MAX_DECIMALS; decimals++) {
+      ck_assert(check_fmt_fixed(values[i], decimals, 0));
+      ck_assert(check_fmt_fixed(values[i], decimals, 10));
+    }
+  }
+
+  u32 seed = 1;
+  for (u32 i = 0; i < 100000; i++) {
+    seed = seed * 1103515245 + 12345;
+    double value = (double)(s32)seed / (double)(1 + (seed >> 8) % 100000);
+    u8 decimals = (u8)(i % (NMEA_FMT_MAX_DECIMALS + 1));
+    ck_assert(check_fmt_fixed(value, decimals, (u8)(i % 12)));
+  }
+
+  char buf[16];
+  nmea_fmt_t fmt;
+  nmea_fmt_init(&fmt, buf, sizeof(buf) - 1);
+  nmea_fmt_uint(&fmt, 7, 2);
+  nmea_fmt_char(&fmt, ',');
+  nmea_fmt_uint(&fmt, 4294967295u, 0);
+  nmea_fmt_char(&fmt, ',');
+  *fmt.p = '\0';
+  ck_assert_str_eq(buf, "07,4294967295,");
+
+  /* output beyond the end of the buffer is dropped */
+  nmea_fmt_init(&fmt, buf, 4);
+  nmea_fmt_str(&fmt, "$GPGGA,");
+  ck_assert_uint_eq(nmea_fmt_len(&fmt), 4);
+
+  nmea_fmt_init(&fmt, buf, sizeof(buf) - 1);
+  nmea_fmt_deg_min(&fmt, -15.9999999996, 2);
+  *fmt.p = '\0';
+  ck_assert_str_eq(buf, "1600.0000000");
+}
+END_TEST
+
+START_TEST(test_nmea_checksum) {
+  const char *body = gpgga_truth[0];
+  size_t body_len = strcspn(body, "*");
+  char sentence[128 + NMEA_FMT_SUFFIX_LEN];
+  nmea_fmt_t fmt;
+  nmea_fmt_init(&fmt, sentence, 128);
+  for (size_t i = 0; i < body_len; i++) {
+    nmea_fmt_char(&fmt, body[i]);
+  }
+  size_t len = nmea_fmt_finish(&fmt);
+  ck_assert_uint_eq(len, strlen(body) + 2);
+  ck_assert_uint_eq(len, strlen(sentence));
+  ck_assert(0 == strncmp(sentence, body, strlen(body)));
+  ck_assert_str_eq(sentence + strlen(body), "\r\n");
+
+  /* the checksum of an empty body */
+  nmea_fmt_init(&fmt, sentence, 128);
+  nmea_fmt_str(&fmt, "$");
+  ck_assert_uint_eq(nmea_fmt_finish(&fmt), 6);
+  ck_assert_str_eq(sentence, "$*00\r\n");
+}
+END_TEST
+
+/* Output collected by the sentence and batch callbacks */
+typedef struct {
+  char text[2048];
+  size_t len;
+  u32 n_calls;
+  /* bit mask of the sentence types */
+  u32 ids;
+} nmea_sink_t;
+
+static void sink_sentence(const char *sentence,
+                          size_t len,
+                          sbp2nmea_nmea_id_t id,
+                          void *context) {
+  nmea_sink_t *sink = context;
+  ck_assert_uint_eq(len, strlen(sentence));
+  ck_assert(0 == strncmp(sentence + len - 2, "\r\n", 2));
+  ck_assert(sink->len + len <= sizeof(sink->text));
+  memcpy(sink->text + sink->len, sentence, len);
+  sink->len += len;
+  sink->n_calls++;
+  sink->ids |= 1u << id;
+}
+
+static void sink_batch(const char *batch, size_t len, void *context) {
+  nmea_sink_t *sink = context;
+  ck_assert(sink->len + len <= sizeof(sink->text));
+  memcpy(sink->text + sink->len, batch, len);
+  sink->len += len;
+  sink->n_calls++;
+}
+
+static void feed_state(void *target,
+                       const void *sbp_msg,
+                       sbp2nmea_sbp_id_t sbp_id) {
+  sbp2nmea((sbp2nmea_t *)target, sbp_msg, sbp_id);
+}
+
+static void feed_hub(void *target,
+                     const void *sbp_msg,
+                     sbp2nmea_sbp_id_t sbp_id) {
+  sbp2nmea_hub((sbp2nmea_hub_t *)target, sbp_msg, sbp_id);
+}
+
+static void nmea_feed_epoch_to(void (*feed)(void *target,
+                                            const void *sbp_msg,
+                                            sbp2nmea_sbp_id_t sbp_id),
+                               void *target,
+                               u32 tow) {
+  msg_utc_time_t utc = {.flags = 1,
+                        .tow = tow,
+                        .year = 2019,
+                        .month = 5,
+                        .day = 6,
+                        .hours = 12,
+                        .seconds = (u8)(tow / 1000 % 60),
+                        .ns = tow % 1000 * 1000000};
+  msg_pos_llh_t pos = {.tow = tow,
+                       .lat = 37.7709,
+                       .lon = -122.4031,
+                       .height = 10.5,
+                       .n_sats = 12,
+                       .flags = 4};
+  msg_vel_ned_t vel = {.tow = tow, .n = 1000, .e = 1000, .flags = 1};
+  msg_dops_t dops = {.tow = tow, .pdop = 150, .hdop = 90, .vdop = 120};
+  msg_age_corrections_t age = {.tow = tow, .age = 12};
+
+  feed(target, &utc, SBP2NMEA_SBP_UTC_TIME);
+  feed(target, &pos, SBP2NMEA_SBP_POS_LLH);
+  feed(target, &vel, SBP2NMEA_SBP_VEL_NED);
+  feed(target, &dops, SBP2NMEA_SBP_DOPS);
+  feed(target, &age, SBP2NMEA_SBP_AGE_CORR);
+}
+
+static void nmea_feed_epoch(sbp2nmea_t *state, u32 tow) {
+  nmea_feed_epoch_to(feed_state, state, tow);
+}
+
+static void nmea_rates_set(sbp2nmea_t *state) {
+  sbp2nmea_soln_freq_set(state, 10);
+  sbp2nmea_rate_set(state, 1, SBP2NMEA_NMEA_GGA);
+  sbp2nmea_rate_set(state, 1, SBP2NMEA_NMEA_RMC);
+  sbp2nmea_rate_set(state, 1, SBP2NMEA_NMEA_VTG);
+  sbp2nmea_rate_set(state, 1, SBP2NMEA_NMEA_GLL);
+  sbp2nmea_rate_set(state, 1, SBP2NMEA_NMEA_ZDA);
+}
+
+START_TEST(test_nmea_v2_callback) {
+  static nmea_sink_t sink;
+  static nmea_sink_t batch_sink;
+  memset(&sink, 0, sizeof(sink));
+  memset(&batch_sink, 0, sizeof(batch_sink));
+
+  sbp2nmea_t state;
+  sbp2nmea_init_v2(&state, sink_sentence, &sink);
+  nmea_rates_set(&state);
+  nmea_feed_epoch(&state, 1000);
+  nmea_feed_epoch(&state, 1100);
+  ck_assert_uint_eq(sink.n_calls, 10);
+  ck_assert_uint_eq(sink.ids,
+                    (1u << SBP2NMEA_NMEA_GGA) | (1u << SBP2NMEA_NMEA_RMC) |
+                        (1u << SBP2NMEA_NMEA_VTG) | (1u << SBP2NMEA_NMEA_GLL) |
+                        (1u << SBP2NMEA_NMEA_ZDA));
+
+  /* one call per epoch, with the same sentences */
+  char buf[1024];
+  sbp2nmea_batch_t batch;
+  sbp2nmea_batch_init(&batch, buf, sizeof(buf), sink_batch);
+  sbp2nmea_init_v2(&state, sink_sentence, &batch_sink);
+  nmea_rates_set(&state);
+  sbp2nmea_set_batch(&state, &batch);
+  nmea_feed_epoch(&state, 1000);
+  ck_assert_uint_eq(batch_sink.n_calls, 1);
+  nmea_feed_epoch(&state, 1100);
+  ck_assert_uint_eq(batch_sink.n_calls, 2);
+  ck_assert_uint_eq(batch_sink.len, sink.len);
+  ck_assert(0 == memcmp(batch_sink.text, sink.text, sink.len));
+
+  /* a batch too small for an epoch is handed over when full */
+  memset(&batch_sink, 0, sizeof(batch_sink));
+  sbp2nmea_batch_init(&batch, buf, 100, sink_batch);
+  sbp2nmea_init_v2(&state, sink_sentence, &batch_sink);
+  nmea_rates_set(&state);
+  sbp2nmea_set_batch(&state, &batch);
+  nmea_feed_epoch(&state, 1000);
+  nmea_feed_epoch(&state, 1100);
+  ck_assert_uint_gt(batch_sink.n_calls, 2);
+  ck_assert_uint_eq(batch_sink.len, sink.len);
+  ck_assert(0 == memcmp(batch_sink.text, sink.text, sink.len));
+
+  /* the heading never arrives, so the epoch is only handed over when the
+   * next one starts or on a flush */
+  memset(&batch_sink, 0, sizeof(batch_sink));
+  sbp2nmea_batch_init(&batch, buf, sizeof(buf), sink_batch);
+  sbp2nmea_init_v2(&state, sink_sentence, &batch_sink);
+  nmea_rates_set(&state);
+  sbp2nmea_rate_set(&state, 1, SBP2NMEA_NMEA_HDT);
+  sbp2nmea_set_batch(&state, &batch);
+  nmea_feed_epoch(&state, 1000);
+  ck_assert_uint_eq(batch_sink.n_calls, 0);
+  nmea_feed_epoch(&state, 1100);
+  ck_assert_uint_eq(batch_sink.n_calls, 1);
+  sbp2nmea_flush(&state);
+  ck_assert_uint_eq(batch_sink.n_calls, 2);
+  ck_assert_uint_eq(batch_sink.len, sink.len);
+  ck_assert(0 == memcmp(batch_sink.text, sink.text, sink.len));
+
+  /* a sentence of the caller is given the id of its type */
+  memset(&sink, 0, sizeof(sink));
+  sbp2nmea_init_v2(&state, sink_sentence, &sink);
+  char gsa[] = "$GNGSA,A,1,,,,,,,,,,,,,,,*2E\r\n";
+  sbp2nmea_to_str(&state, gsa);
+  ck_assert_uint_eq(sink.n_calls, 1);
+  ck_assert_uint_eq(sink.ids, 1u << SBP2NMEA_NMEA_GSA);
+  ck_assert_uint_eq(sink.len, strlen(gsa));
+}
+END_TEST
+
+START_TEST(test_nmea_readiness) {
+  static nmea_sink_t sink;
+  memset(&sink, 0, sizeof(sink));
+
+  sbp2nmea_t state;
+  sbp2nmea_init_v2(&state, sink_sentence, &sink);
+  nmea_rates_set(&state);
+
+  /* the inputs arrive ahead of the UTC time which completes all sentences */
+  const u32 tow = 1000;
+  msg_pos_llh_t pos = {.tow = tow, .lat = 37.7709, .flags = 4};
+  msg_vel_ned_t vel = {.tow = tow, .flags = 1};
+  msg_dops_t dops = {.tow = tow, .hdop = 90};
+  msg_age_corrections_t age = {.tow = tow, .age = 12};
+  msg_utc_time_t utc = {.flags = 1, .tow = tow, .year = 2019, .month = 5};
+  sbp2nmea(&state, &pos, SBP2NMEA_SBP_POS_LLH);
+  sbp2nmea(&state, &vel, SBP2NMEA_SBP_VEL_NED);
+  ck_assert_uint_eq(sink.n_calls, 0);
+  sbp2nmea(&state, &utc, SBP2NMEA_SBP_UTC_TIME);
+  /* RMC, VTG, GLL, ZDA, GGA still waits for the DOPS and the age of
+   * corrections */
+  ck_assert_uint_eq(sink.n_calls, 4);
+  ck_assert_uint_eq(sink.ids & (1u << SBP2NMEA_NMEA_GGA), 0);
+  sbp2nmea(&state, &age, SBP2NMEA_SBP_AGE_CORR);
+  ck_assert_uint_ne(state.epoch_mask & (1u << SBP2NMEA_SBP_AGE_CORR), 0);
+  ck_assert_uint_eq(sink.n_calls, 4);
+
+  /* an input of another epoch leaves the epoch, so the last input of GGA
+   * does not complete it */
+  age.tow = tow - 100;
+  sbp2nmea(&state, &age, SBP2NMEA_SBP_AGE_CORR);
+  ck_assert_uint_eq(state.epoch_mask & (1u << SBP2NMEA_SBP_AGE_CORR), 0);
+  sbp2nmea(&state, &dops, SBP2NMEA_SBP_DOPS);
+  ck_assert_uint_eq(sink.n_calls, 4);
+  ck_assert_uint_eq(sink.ids & (1u << SBP2NMEA_NMEA_GGA), 0);
+  age.tow = tow;
+  sbp2nmea(&state, &age, SBP2NMEA_SBP_AGE_CORR);
+  ck_assert_uint_eq(sink.n_calls, 5);
+
+  /* repeated messages do not repeat the sentences */
+  sbp2nmea(&state, &age, SBP2NMEA_SBP_AGE_CORR);
+  sbp2nmea(&state, &utc, SBP2NMEA_SBP_UTC_TIME);
+  ck_assert_uint_eq(sink.n_calls, 5);
+
+  /* the next epoch drops the inputs of this one */
+  nmea_feed_epoch(&state, tow + 100);
+  ck_assert_uint_eq(sink.n_calls, 10);
+  ck_assert_uint_eq(state.epoch_mask,
+                    (1u << SBP2NMEA_SBP_UTC_TIME) |
+                        (1u << SBP2NMEA_SBP_POS_LLH) |
+                        (1u << SBP2NMEA_SBP_VEL_NED) |
+                        (1u << SBP2NMEA_SBP_DOPS) |
+                        (1u << SBP2NMEA_SBP_AGE_CORR));
+}
+END_TEST
+
+START_TEST(test_nmea_gsa_svs) {
+  static nmea_sink_t sink;
+  memset(&sink, 0, sizeof(sink));
+
+  sbp2nmea_t state;
+  sbp2nmea_init_v2(&state, sink_sentence, &sink);
+  sbp2nmea_soln_freq_set(&state, 10);
+  sbp2nmea_rate_set(&state, 1, SBP2NMEA_NMEA_GSA);
+
+  /* 14 GPS satellites in descending order with a second signal for each,
+   * and one GLONASS satellite */
+  const u32 tow = 1000;
+  u8 buf[sizeof(msg_obs_t) + 29 * sizeof(packed_obs_content_t)] = {0};
+  msg_obs_t *obs = (msg_obs_t *)buf;
+  obs->header.t.tow = tow;
+  obs->header.t.wn = 2000;
+  obs->header.n_obs = 1 << MSG_OBS_HEADER_SEQ_SHIFT;
+  for (u8 i = 0; i < 14; i++) {
+    obs->obs[2 * i].sid.sat = (u8)(14 - i);
+    obs->obs[2 * i].sid.code = CODE_GPS_L1CA;
+    obs->obs[2 * i + 1].sid.sat = (u8)(14 - i);
+    obs->obs[2 * i + 1].sid.code = CODE_GPS_L2CM;
+  }
+  obs->obs[28].sid.sat = 6;
+  obs->obs[28].sid.code = CODE_GLO_L1OF;
+  sbp2nmea_obs(&state, obs, 29);
+  ck_assert_uint_eq(sbp2nmea_num_obs_get(&state), 29);
+
+  msg_gps_time_t gps_time = {.tow = tow, .wn = 2000};
+  msg_dops_t dops = {.tow = tow, .pdop = 150, .hdop = 90, .vdop = 120};
+  msg_utc_time_t utc = {.flags = 1, .tow = tow, .year = 2019, .month = 5};
+  sbp2nmea(&state, &gps_time, SBP2NMEA_SBP_GPS_TIME);
+  sbp2nmea(&state, &dops, SBP2NMEA_SBP_DOPS);
+  sbp2nmea(&state, &utc, SBP2NMEA_SBP_UTC_TIME);
+
+  /* each satellite once, the lowest GSA_MAX_SV ids in ascending order */
+  ck_assert_uint_eq(sink.n_calls, 2);
+  sink.text[sink.len] = '\0';
+  ck_assert_str_eq(sink.text,
+                   "$GNGSA,A,1,01,02,03,04,05,06,07,08,09,10,11,12,,,*03\r\n"
+                   "$GNGSA,A,1,70,,,,,,,,,,,,,,*07\r\n");
+
+  /* a new sequence starts with empty sets */
+  memset(&sink, 0, sizeof(sink));
+  obs->header.t.tow = tow + 100;
+  obs->obs[0].sid.sat = 30;
+  sbp2nmea_obs(&state, obs, 1);
+  gps_time.tow = tow + 100;
+  dops.tow = tow + 100;
+  utc.tow = tow + 100;
+  sbp2nmea(&state, &gps_time, SBP2NMEA_SBP_GPS_TIME);
+  sbp2nmea(&state, &dops, SBP2NMEA_SBP_DOPS);
+  sbp2nmea(&state, &utc, SBP2NMEA_SBP_UTC_TIME);
+  sink.text[sink.len] = '\0';
+  ck_assert_str_eq(sink.text, "$GPGSA,A,1,30,,,,,,,,,,,,,,*1D\r\n");
+}
+END_TEST
+
+START_TEST(test_nmea_hub) {
+  static sbp2nmea_hub_t hub;
+  static nmea_sink_t sink_a;
+  static nmea_sink_t sink_b;
+  static nmea_sink_t sink_single;
+  memset(&sink_a, 0, sizeof(sink_a));
+  memset(&sink_b, 0, sizeof(sink_b));
+  memset(&sink_single, 0, sizeof(sink_single));
+
+  sbp2nmea_hub_init(&hub);
+  sbp2nmea_soln_freq_set(&hub.in, 10);
+  int a = sbp2nmea_hub_subscribe(&hub, sink_sentence, &sink_a);
+  int b = sbp2nmea_hub_subscribe(&hub, sink_sentence, &sink_b);
+  ck_assert_int_ge(a, 0);
+  ck_assert_int_ge(b, 0);
+  sbp2nmea_hub_rate_set(&hub, a, 1, SBP2NMEA_NMEA_GGA);
+  sbp2nmea_hub_rate_set(&hub, a, 2, SBP2NMEA_NMEA_RMC);
+  sbp2nmea_hub_rate_set(&hub, b, 1, SBP2NMEA_NMEA_GGA);
+  sbp2nmea_hub_rate_set(&hub, b, 1, SBP2NMEA_NMEA_ZDA);
+
+  /* the same profile as subscriber a on a state of its own */
+  sbp2nmea_t state;
+  sbp2nmea_init_v2(&state, sink_sentence, &sink_single);
+  sbp2nmea_soln_freq_set(&state, 10);
+  sbp2nmea_rate_set(&state, 1, SBP2NMEA_NMEA_GGA);
+  sbp2nmea_rate_set(&state, 2, SBP2NMEA_NMEA_RMC);
+
+  for (u32 tow = 1000; tow < 1400; tow += 100) {
+    nmea_feed_epoch_to(feed_hub, &hub, tow);
+    nmea_feed_epoch(&state, tow);
+  }
+
+  /* GGA every epoch, RMC every other one */
+  ck_assert_uint_eq(sink_a.n_calls, 6);
+  ck_assert_uint_eq(sink_a.len, sink_single.len);
+  ck_assert(0 == memcmp(sink_a.text, sink_single.text, sink_a.len));
+  ck_assert_uint_eq(sink_b.n_calls, 8);
+  ck_assert_uint_eq(sink_b.ids,
+                    (1u << SBP2NMEA_NMEA_GGA) | (1u << SBP2NMEA_NMEA_ZDA));
+  /* the GGA shared by both subscribers is formatted once per epoch */
+  ck_assert_uint_eq(hub.n_formatted, 4 + 2 + 4);
+
+  const char *sentences;
+  size_t len = sbp2nmea_hub_get(&hub, SBP2NMEA_NMEA_GGA, &sentences);
+  ck_assert_uint_gt(len, 0);
+  ck_assert(0 == memcmp(sentences, sink_b.text + sink_b.len - len, len));
+  ck_assert_uint_eq(sbp2nmea_hub_get(&hub, SBP2NMEA_NMEA_VTG, &sentences), 0);
+
+  /* a sentence of the caller of a type the converter does not generate goes
+   * to every subscriber and is not cached */
+  char txt[] = "$GPTXT,01,01,02,hub*32\r\n";
+  sbp2nmea_to_str(&hub.in, txt);
+  ck_assert_uint_eq(sink_a.n_calls, 7);
+  ck_assert_uint_eq(sink_b.n_calls, 9);
+  ck_assert(0 ==
+            memcmp(sink_b.text + sink_b.len - strlen(txt), txt, strlen(txt)));
+  ck_assert_uint_eq(hub.n_formatted, 4 + 2 + 4);
+  ck_assert_uint_eq(sbp2nmea_hub_get(&hub, SBP2NMEA_NMEA_CNT, &sentences), 0);
+  ck_assert_ptr_eq(sentences, NULL);
+
+  /* without subscribers nothing is formatted */
+  sbp2nmea_hub_unsubscribe(&hub, a);
+  sbp2nmea_hub_unsubscribe(&hub, b);
+  nmea_feed_epoch_to(feed_hub, &hub, 1400);
+  ck_assert_uint_eq(hub.n_formatted, 4 + 2 + 4);
+}
+END_TEST
+
+/* SBP messages produced by nmea2sbp, the last one of each type */
+typedef struct {
+  msg_pos_llh_t pos;
+  msg_vel_ned_t vel;
+  msg_utc_time_t utc;
+  msg_dops_t dops;
+  u32 n_pos;
+  u32 n_vel;
+  u32 n_utc;
+  u32 n_dops;
+} sbp_sink_t;
+
+static void sink_sbp(
+    u16 msg_id, u8 length, u8 *buffer, u16 sender_id, void *context) {
+  sbp_sink_t *sink = context;
+  ck_assert_uint_eq(sender_id, 0x42);
+  switch (msg_id) {
+    case SBP_MSG_POS_LLH:
+      ck_assert_uint_eq(length, sizeof(sink->pos));
+      memcpy(&sink->pos, buffer, length);
+      sink->n_pos++;
+      break;
+    case SBP_MSG_VEL_NED:
+      ck_assert_uint_eq(length, sizeof(sink->vel));
+      memcpy(&sink->vel, buffer, length);
+      sink->n_vel++;
+      break;
+    case SBP_MSG_UTC_TIME:
+      ck_assert_uint_eq(length, sizeof(sink->utc));
+      memcpy(&sink->utc, buffer, length);
+      sink->n_utc++;
+      break;
+    case SBP_MSG_DOPS:
+      ck_assert_uint_eq(length, sizeof(sink->dops));
+      memcpy(&sink->dops, buffer, length);
+      sink->n_dops++;
+      break;
+    default:
+      ck_abort_msg("Unexpected SBP message %u", msg_id);
+      break;
+  }
+}
+
+START_TEST(test_nmea_to_sbp) {
+  static nmea_sink_t nmea;
+  static sbp_sink_t sbp;
+  memset(&nmea, 0, sizeof(nmea));
+  memset(&sbp, 0, sizeof(sbp));
+
+  /* the NMEA of two epochs of sbp2nmea, with GGA last */
+  sbp2nmea_t state;
+  sbp2nmea_init_v2(&state, sink_sentence, &nmea);
+  nmea_rates_set(&state);
+  nmea_feed_epoch(&state, 1000);
+  nmea_feed_epoch(&state, 1100);
+
+  nmea2sbp_t conv;
+  nmea2sbp_init(&conv, sink_sbp, &sbp);
+  nmea2sbp_set_sender_id(&conv, 0x42);
+  /* the sentences may be split anywhere */
+  for (size_t i = 0; i < nmea.len; i += 7) {
+    nmea2sbp_decode(&conv, nmea.text + i, MIN(7, nmea.len - i));
+  }
+
+  ck_assert_uint_eq(conv.n_no_date, 0);
+  ck_assert_uint_eq(conv.n_checksum_errors, 0);
+  ck_assert_uint_eq(conv.n_invalid, 0);
+  ck_assert_uint_eq(sbp.n_utc, 2);
+  ck_assert_uint_eq(sbp.n_vel, 2);
+  ck_assert_uint_eq(sbp.n_pos, 2);
+
+  /* Monday 2019-05-06 12:00:01.1 UTC */
+  const u32 tow = (DAY_SECS + 12 * HOUR_SECS + 1 + 18) * SECS_MS + 100;
+  ck_assert_uint_eq(sbp.utc.tow, tow);
+  ck_assert_uint_eq(sbp.utc.year, 2019);
+  ck_assert_uint_eq(sbp.utc.month, 5);
+  ck_assert_uint_eq(sbp.utc.day, 6);
+  ck_assert_uint_eq(sbp.utc.hours, 12);
+  ck_assert_uint_eq(sbp.utc.seconds, 1);
+  ck_assert_uint_eq(sbp.utc.ns, 100000000);
+
+  ck_assert_uint_eq(sbp.pos.tow, tow);
+  ck_assert_uint_eq(sbp.pos.flags, 4);
+  ck_assert_uint_eq(sbp.pos.n_sats, 12);
+  ck_assert(fabs(sbp.pos.lat - 37.7709) < 1e-9);
+  ck_assert(fabs(sbp.pos.lon + 122.4031) < 1e-9);
+  ck_assert(fabs(sbp.pos.height - 10.5) < 1e-9);
+
+  /* VTG of the same epoch does not repeat the velocity of RMC */
+  ck_assert_uint_eq(sbp.vel.tow, tow);
+  ck_assert_uint_eq(sbp.vel.flags, 1);
+  ck_assert_int_lt(abs(sbp.vel.n - 1000), 10);
+  ck_assert_int_lt(abs(sbp.vel.e - 1000), 10);
+
+  /* one MSG_DOPS for the GSA sentences of all talkers */
+  const char gsa[] =
+      "$GPGSA,A,3,01,02,,,,,,,,,,,1.5,0.9,1.2*3F\r\n"
+      "$GLGSA,A,3,70,,,,,,,,,,,,1.5,0.9,1.2*27\r\n";
+  nmea2sbp_decode(&conv, gsa, strlen(gsa));
+  ck_assert_uint_eq(conv.n_checksum_errors, 0);
+  ck_assert_uint_eq(sbp.n_dops, 1);
+  ck_assert_uint_eq(sbp.dops.tow, tow);
+  ck_assert_uint_eq(sbp.dops.pdop, 150);
+  ck_assert_uint_eq(sbp.dops.hdop, 90);
+  ck_assert_uint_eq(sbp.dops.vdop, 120);
+  ck_assert_uint_eq(sbp.dops.flags, 4);
+
+  /* without a course only a stationary velocity is known */
+  const char moving[] =
+      "$GPRMC,120002.00,A,3746.25400,N,12224.18600,W,1.94,,060519,,,A*59\r\n";
+  nmea2sbp_decode(&conv, moving, strlen(moving));
+  ck_assert_uint_eq(sbp.n_vel, 3);
+  ck_assert_uint_eq(sbp.vel.flags, 0);
+  ck_assert_int_eq(sbp.vel.n, 0);
+  ck_assert_int_eq(sbp.vel.e, 0);
+  const char stationary[] =
+      "$GPRMC,120003.00,A,3746.25400,N,12224.18600,W,0.00,,060519,,,A*54\r\n";
+  nmea2sbp_decode(&conv, stationary, strlen(stationary));
+  ck_assert_uint_eq(sbp.n_vel, 4);
+  ck_assert_uint_eq(sbp.vel.flags, 1);
+  ck_assert_int_eq(sbp.vel.n, 0);
+  ck_assert_int_eq(sbp.vel.e, 0);
+
+  /* a corrupted sentence is dropped */
+  const char bad[] = "$GPRMC,120002.00,A,,,,,0.0,0.0,060519,,,A*00\r\n";
+  nmea2sbp_decode(&conv, bad, strlen(bad));
+  ck_assert_uint_eq(conv.n_checksum_errors, 1);
+  ck_assert_uint_eq(sbp.n_utc, 4);
+
+  /* nothing before the date of the first RMC sentence */
+  nmea2sbp_init(&conv, sink_sbp, &sbp);
+  nmea2sbp_set_sender_id(&conv, 0x42);
+  nmea2sbp_decode(&conv, gsa, strlen(gsa));
+  ck_assert_uint_eq(conv.n_no_date, 2);
+  ck_assert_uint_eq(sbp.n_dops, 1);
+}
+END_TEST
+
 Suite *nmea_suite(void) {
   Suite *s = suite_create("NMEA");
 
@@ -424,6 +1044,14 @@ Suite *nmea_suite(void) {
   tcase_add_test(tc_nmea, test_nmea_gpzda);
   tcase_add_test(tc_nmea, test_nmea_gsa);
   tcase_add_test(tc_nmea, test_nmea_time_string);
+  tcase_add_test(tc_nmea, test_nmea_utc_fields);
+  tcase_add_test(tc_nmea, test_nmea_format);
+  tcase_add_test(tc_nmea, test_nmea_checksum);
+  tcase_add_test(tc_nmea, test_nmea_v2_callback);
+  tcase_add_test(tc_nmea, test_nmea_readiness);
+  tcase_add_test(tc_nmea, test_nmea_gsa_svs);
+  tcase_add_test(tc_nmea, test_nmea_hub);
+  tcase_add_test(tc_nmea, test_nmea_to_sbp);
   suite_add_tcase(s, tc_nmea);
 
   return s;
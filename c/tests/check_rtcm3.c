@@ -18,11 +18,15 @@
 
 #include <libsbp/observation.h>
 #include <libsbp/sbp.h>
+#include <rtcm3/bits.h>
 #include <rtcm3/decode.h>
 #include <rtcm3/encode.h>
 #include <swiftnav/gnss_time.h>
 #include <swiftnav/sid_set.h>
 
+#include <gnss-converters/rtcm3_fanout.h>
+#include <gnss-converters/rtcm3_pool.h>
+
 #include "check_rtcm3.h"
 #include "check_suites.h"
 #include "config.h"
@@ -1220,6 +1224,949 @@ START_TEST(test_sbp_to_msm_roundtrip) {
 }
 END_TEST
 
+/* GPS epoch with 20 satellites and 4 signals, 80 cells do not fit in one MSM */
+#define SPLIT_TEST_NUM_SATS 20
+#define SPLIT_TEST_NUM_OBS (SPLIT_TEST_NUM_SATS * 4)
+
+static packed_obs_content_t split_test_data[SPLIT_TEST_NUM_OBS];
+static u8 n_split_frames;
+static u8 prev_multiple_bit;
+static u16 n_split_obs;
+
+static void rtcm_split_cb(u8 *buffer, u16 length, void *context) {
+  (void)context;
+
+  /* every message before this one must have announced more to follow */
+  if (n_split_frames > 0) {
+    ck_assert_uint_eq(prev_multiple_bit, 1);
+  }
+  prev_multiple_bit = rtcm_getbitu(&buffer[3], MSM_MULTIPLE_BIT_OFFSET, 1);
+  n_split_frames++;
+
+  rtcm2sbp_decode_frame(buffer, length, &state);
+}
+
+static void sbp_split_cb(
+    u16 msg_id, u8 length, u8 *buffer, u16 sender_id, void *context) {
+  (void)sender_id;
+  (void)context;
+
+  ck_assert_uint_eq(msg_id, SBP_MSG_OBS);
+  u8 num_obs = (length - 11) / 17;
+  msg_obs_t *sbp_obs = (msg_obs_t *)buffer;
+
+  for (u8 i = 0; i < num_obs; i++) {
+    packed_obs_content_t *converted_obs = &sbp_obs->obs[i];
+    packed_obs_content_t *orig_obs = NULL;
+    for (u8 j = 0; j < SPLIT_TEST_NUM_OBS; j++) {
+      if (split_test_data[j].sid.code == converted_obs->sid.code &&
+          split_test_data[j].sid.sat == converted_obs->sid.sat) {
+        orig_obs = &split_test_data[j];
+        break;
+      }
+    }
+    ck_assert_ptr_ne(orig_obs, NULL);
+    ck_assert_uint_eq(orig_obs->P, converted_obs->P);
+    ck_assert_uint_eq(orig_obs->L.i, converted_obs->L.i);
+    ck_assert_uint_eq(orig_obs->L.f, converted_obs->L.f);
+    ck_assert_uint_eq(orig_obs->cn0, converted_obs->cn0);
+    ck_assert_uint_eq(orig_obs->flags, converted_obs->flags);
+    n_split_obs++;
+  }
+}
+
+START_TEST(test_sbp_to_msm_split) {
+  current_time.wn = 2022;
+  current_time.tow = 210853;
+  sbp2rtcm_init(&out_state, rtcm_split_cb, NULL);
+  rtcm2sbp_init(&state, sbp_split_cb, NULL, NULL);
+  sbp2rtcm_set_leap_second(18, &out_state);
+  rtcm2sbp_set_leap_second(18, &state);
+  rtcm2sbp_set_gps_time(&current_time, &state);
+
+  /* reuse the L1 and L2 observations of GPS 8 from the roundtrip data for
+   * every satellite, the P codes share the frequencies of the C/A codes */
+  const code_t codes[] = {
+      CODE_GPS_L1CA, CODE_GPS_L2CM, CODE_GPS_L1P, CODE_GPS_L2P};
+  u16 n = 0;
+  for (u8 sat = 1; sat <= SPLIT_TEST_NUM_SATS; sat++) {
+    for (u8 c = 0; c < ARRAY_SIZE(codes); c++) {
+      bool l2 = (CODE_GPS_L2CM == codes[c] || CODE_GPS_L2P == codes[c]);
+      split_test_data[n] = l2 ? sbp_test_data[10] : sbp_test_data[0];
+      split_test_data[n].sid.sat = sat;
+      split_test_data[n].sid.code = codes[c];
+      n++;
+    }
+  }
+
+  memcpy(out_state.sbp_obs_buffer, split_test_data, sizeof(split_test_data));
+  out_state.n_sbp_obs = SPLIT_TEST_NUM_OBS;
+
+  n_split_frames = 0;
+  n_split_obs = 0;
+  sbp_buffer_to_msm(&out_state);
+
+  /* the epoch needs more than one message, the last one ends the epoch */
+  ck_assert_uint_gt(n_split_frames, 1);
+  ck_assert_uint_eq(prev_multiple_bit, 0);
+  /* and all the observations come back out of the decoder */
+  ck_assert_uint_eq(n_split_obs, SPLIT_TEST_NUM_OBS);
+  ck_assert_uint_eq(gnssc_diag_count(&out_state.diag, GNSSC_DIAG_MSM_SAT_LIMIT),
+                    0);
+}
+END_TEST
+
+static u8 ref_frames[RTCM3_FANOUT_BUFFER_SIZE];
+static u16 ref_length;
+
+static void rtcm_reference_cb(u8 *buffer, u16 length, void *context) {
+  (void)context;
+  ck_assert_uint_le(ref_length + length, sizeof(ref_frames));
+  memcpy(&ref_frames[ref_length], buffer, length);
+  ref_length += length;
+}
+
+/* feed the roundtrip test data as one SBP observation sequence */
+static void feed_sbp_test_epoch(struct rtcm3_out_state *out,
+                                struct rtcm3_fanout *fanout) {
+  const u8 n_total = ARRAY_SIZE(sbp_test_data);
+  const u8 n_msgs = (n_total + MAX_OBS_IN_SBP - 1) / MAX_OBS_IN_SBP;
+  for (u8 i = 0; i < n_msgs; i++) {
+    u8 buffer[SBP_FRAMING_MAX_PAYLOAD_SIZE];
+    msg_obs_t *msg = (msg_obs_t *)buffer;
+    msg->header.t.wn = 2022;
+    msg->header.t.tow = 210853000;
+    msg->header.t.ns_residual = 0;
+    msg->header.n_obs = (n_msgs << 4) | i;
+    u8 n_obs = 0;
+    for (u8 j = i * MAX_OBS_IN_SBP; j < n_total && n_obs < MAX_OBS_IN_SBP;
+         j++) {
+      msg->obs[n_obs++] = sbp_test_data[j];
+    }
+    u8 len = sizeof(observation_header_t) + n_obs * sizeof(*msg->obs);
+    if (NULL != out) {
+      sbp2rtcm_sbp_obs_cb(0x1234, len, buffer, out);
+    }
+    if (NULL != fanout) {
+      rtcm3_fanout_sbp_obs_cb(0x1234, len, buffer, fanout);
+    }
+  }
+}
+
+START_TEST(test_sbp_to_rtcm_fanout) {
+  static struct rtcm3_fanout fanout;
+  rtcm3_fanout_init(&fanout, NULL, NULL);
+  sbp2rtcm_set_leap_second(18, &fanout.in);
+
+  const u8 *frames = NULL;
+  ck_assert_uint_eq(rtcm3_fanout_get(&fanout, MSM5, &frames), 0);
+
+  feed_sbp_test_epoch(NULL, &fanout);
+  ck_assert_uint_eq(rtcm3_fanout_epoch(&fanout), 1);
+
+  const msm_enum profiles[] = {MSM_UNKNOWN, MSM4, MSM5};
+  for (u8 i = 0; i < ARRAY_SIZE(profiles); i++) {
+    /* reference output from a converter configured for this profile only */
+    sbp2rtcm_init(&out_state, rtcm_reference_cb, NULL);
+    sbp2rtcm_set_leap_second(18, &out_state);
+    sbp2rtcm_set_rtcm_out_mode(profiles[i], &out_state);
+    ref_length = 0;
+    feed_sbp_test_epoch(&out_state, NULL);
+
+    /* several clients asking for the same profile */
+    for (u8 client = 0; client < 3; client++) {
+      u16 length = rtcm3_fanout_get(&fanout, profiles[i], &frames);
+      ck_assert_uint_gt(length, 0);
+      ck_assert_uint_eq(length, ref_length);
+      ck_assert_mem_eq(frames, ref_frames, length);
+    }
+  }
+  /* each profile was encoded only once */
+  ck_assert_uint_eq(fanout.n_encodes, ARRAY_SIZE(profiles));
+
+  /* no encoder for MSM7 */
+  ck_assert_uint_eq(rtcm3_fanout_get(&fanout, MSM7, &frames), 0);
+
+  /* a new epoch invalidates the cache */
+  feed_sbp_test_epoch(NULL, &fanout);
+  ck_assert_uint_eq(rtcm3_fanout_epoch(&fanout), 2);
+  ck_assert_uint_gt(rtcm3_fanout_get(&fanout, MSM5, &frames), 0);
+  ck_assert_uint_eq(fanout.n_encodes, ARRAY_SIZE(profiles) + 1);
+}
+END_TEST
+
+/* decode the 1004 message captured by rtcm_reference_cb */
+static void decode_legacy_reference(rtcm_obs_message *msg) {
+  ck_assert_uint_gt(ref_length, 0);
+  ck_assert_uint_eq(rtcm_getbitu(ref_frames, 24, 12), 1004);
+  ck_assert_int_eq(rtcm3_decode_1004(&ref_frames[3], msg), RC_OK);
+}
+
+START_TEST(test_sbp_to_legacy_unsorted) {
+  /* the GPS L1 and L2 observations of the test data */
+  const u8 n_gps_obs = 15;
+  sbp2rtcm_init(&out_state, rtcm_reference_cb, NULL);
+  sbp2rtcm_set_leap_second(18, &out_state);
+  out_state.sbp_header.t.wn = 2022;
+  out_state.sbp_header.t.tow = 210853000;
+
+  memcpy(out_state.sbp_obs_buffer,
+         sbp_test_data,
+         n_gps_obs * sizeof(*sbp_test_data));
+  out_state.n_sbp_obs = n_gps_obs;
+  ref_length = 0;
+  sbp_buffer_to_legacy_rtcm3(&out_state);
+  rtcm_obs_message sorted;
+  decode_legacy_reference(&sorted);
+  ck_assert_uint_eq(sorted.header.n_sat, 10);
+
+  /* same observations with the L2 ones first and the order reversed */
+  for (u8 i = 0; i < n_gps_obs; i++) {
+    out_state.sbp_obs_buffer[i] = sbp_test_data[n_gps_obs - 1 - i];
+  }
+  out_state.n_sbp_obs = n_gps_obs;
+  ref_length = 0;
+  sbp_buffer_to_legacy_rtcm3(&out_state);
+  rtcm_obs_message unsorted;
+  decode_legacy_reference(&unsorted);
+  ck_assert_uint_eq(unsorted.header.n_sat, sorted.header.n_sat);
+
+  for (u8 i = 0; i < sorted.header.n_sat; i++) {
+    const rtcm_sat_data *sat = &sorted.sats[i];
+    bool found = false;
+    for (u8 j = 0; j < unsorted.header.n_sat; j++) {
+      if (unsorted.sats[j].svId != sat->svId) {
+        continue;
+      }
+      for (u8 f = L1_FREQ; f <= L2_FREQ; f++) {
+        const rtcm_freq_data *a = &sat->obs[f];
+        const rtcm_freq_data *b = &unsorted.sats[j].obs[f];
+        ck_assert_uint_eq(a->code, b->code);
+        ck_assert_uint_eq(a->flags.valid_pr, b->flags.valid_pr);
+        ck_assert_uint_eq(a->flags.valid_cp, b->flags.valid_cp);
+        ck_assert(a->pseudorange == b->pseudorange);
+        ck_assert(a->carrier_phase == b->carrier_phase);
+        ck_assert(a->cnr == b->cnr);
+      }
+      found = true;
+    }
+    ck_assert(found);
+  }
+
+  /* an L2 observation without L1 does not make it into 1004 */
+  out_state.sbp_obs_buffer[0] = sbp_test_data[10];
+  out_state.n_sbp_obs = 1;
+  ref_length = 0;
+  sbp_buffer_to_legacy_rtcm3(&out_state);
+  ck_assert_uint_eq(ref_length, 0);
+}
+END_TEST
+
+#define STN_TEST_EPOCHS 600
+
+static u16 stn_msg_types[STN_TEST_EPOCHS];
+static u16 n_stn_msgs;
+static u16 stn_test_epoch;
+static u16 stn_msgs_in_epoch;
+
+static void rtcm_station_cb(u8 *buffer, u16 length, void *context) {
+  (void)context;
+  ck_assert_uint_gt(length, 0);
+  ck_assert_uint_lt(n_stn_msgs, STN_TEST_EPOCHS);
+  stn_msg_types[n_stn_msgs++] = rtcm_getbitu(buffer, 24, 12);
+  /* at most one scheduled station message per epoch */
+  ck_assert_uint_eq(stn_msgs_in_epoch++, 0);
+}
+
+static u16 count_stn_msgs(u16 msg_num) {
+  u16 count = 0;
+  for (u16 i = 0; i < n_stn_msgs; i++) {
+    if (stn_msg_types[i] == msg_num) {
+      count++;
+    }
+  }
+  return count;
+}
+
+START_TEST(test_sbp_to_rtcm_station_schedule) {
+  sbp2rtcm_init(&out_state, rtcm_station_cb, NULL);
+  out_state.send_msm_obs = false;
+  sbp2rtcm_set_leap_second(18, &out_state);
+  sbp2rtcm_set_rcv_ant_descriptors("ANT", "RCV", &out_state);
+
+  ck_assert(sbp2rtcm_set_station_msg_interval(1006, 10000, &out_state));
+  ck_assert(sbp2rtcm_set_station_msg_interval(1230, 30000, &out_state));
+  ck_assert(sbp2rtcm_set_station_msg_interval(
+      1008, RTCM3_STN_MSG_INTERVAL_OFF, &out_state));
+  ck_assert(sbp2rtcm_set_station_msg_interval(
+      1033, RTCM3_STN_MSG_INTERVAL_OFF, &out_state));
+  ck_assert(!sbp2rtcm_set_station_msg_interval(1004, 1000, &out_state));
+
+  msg_base_pos_ecef_t base_pos = {
+      .x = -2704376.0, .y = -4263209.0, .z = 3884633.0};
+  msg_glo_biases_t glo_biases = {.mask = 0xF, .l1ca_bias = 100};
+
+  n_stn_msgs = 0;
+  /* 60 seconds of 10 Hz epochs with the station info arriving every epoch */
+  for (stn_test_epoch = 0; stn_test_epoch < STN_TEST_EPOCHS;
+       stn_test_epoch++) {
+    stn_msgs_in_epoch = 0;
+    sbp2rtcm_base_pos_ecef_cb(
+        0x1234, sizeof(base_pos), (const u8 *)&base_pos, &out_state);
+    sbp2rtcm_glo_biases_cb(
+        0x1234, sizeof(glo_biases), (const u8 *)&glo_biases, &out_state);
+    /* nothing is sent on the station message input */
+    ck_assert_uint_eq(stn_msgs_in_epoch, 0);
+
+    u8 buffer[SBP_FRAMING_MAX_PAYLOAD_SIZE];
+    msg_obs_t *msg = (msg_obs_t *)buffer;
+    msg->header.t.wn = 2022;
+    msg->header.t.tow = 210853000 + stn_test_epoch * 100;
+    msg->header.t.ns_residual = 0;
+    msg->header.n_obs = 1 << 4;
+    msg->obs[0] = sbp_test_data[0];
+    sbp2rtcm_sbp_obs_cb(0x1234,
+                        sizeof(observation_header_t) + sizeof(*msg->obs),
+                        buffer,
+                        &out_state);
+  }
+
+  /* both are due on the first epoch, 1230 goes out one epoch later */
+  ck_assert_uint_eq(stn_msg_types[0], 1006);
+  ck_assert_uint_eq(stn_msg_types[1], 1230);
+  ck_assert_uint_eq(count_stn_msgs(1006), 6);
+  ck_assert_uint_eq(count_stn_msgs(1230), 2);
+  ck_assert_uint_eq(n_stn_msgs, 8);
+}
+END_TEST
+
+static u16 n_flush_frames;
+
+static void rtcm_count_cb(u8 *buffer, u16 length, void *context) {
+  (void)buffer;
+  (void)context;
+  if (length > 0) {
+    n_flush_frames++;
+  }
+}
+
+/* feed one message of an SBP observation sequence with a single observation */
+static void feed_sbp_seq_msg(u32 tow_ms, u8 seq_counter, u8 seq_size) {
+  u8 buffer[SBP_FRAMING_MAX_PAYLOAD_SIZE];
+  msg_obs_t *msg = (msg_obs_t *)buffer;
+  msg->header.t.wn = 2022;
+  msg->header.t.tow = tow_ms;
+  msg->header.t.ns_residual = 0;
+  msg->header.n_obs = (seq_size << 4) | seq_counter;
+  msg->obs[0] = sbp_test_data[seq_counter];
+  sbp2rtcm_sbp_obs_cb(0x1234,
+                      sizeof(observation_header_t) + sizeof(*msg->obs),
+                      buffer,
+                      &out_state);
+}
+
+START_TEST(test_sbp_to_rtcm_flush_timeout) {
+  sbp2rtcm_init(&out_state, rtcm_count_cb, NULL);
+  sbp2rtcm_set_leap_second(18, &out_state);
+  const struct rtcm3_epoch_timer *timer = &out_state.epoch_timer;
+  n_flush_frames = 0;
+
+  /* two complete epochs at 1 Hz */
+  sbp2rtcm_tick(10000, &out_state);
+  feed_sbp_seq_msg(210853000, 0, 1);
+  sbp2rtcm_tick(11000, &out_state);
+  feed_sbp_seq_msg(210854000, 0, 1);
+  ck_assert_uint_eq(n_flush_frames, 2);
+  ck_assert_uint_eq(timer->stream.epoch_period_ms, 1000);
+
+  /* the second message of the next epoch is lost */
+  sbp2rtcm_tick(12000, &out_state);
+  feed_sbp_seq_msg(210855000, 0, 2);
+  sbp2rtcm_tick(12499, &out_state);
+  ck_assert_uint_eq(n_flush_frames, 2);
+  sbp2rtcm_tick(12500, &out_state);
+  ck_assert_uint_eq(n_flush_frames, 3);
+  ck_assert_uint_eq(timer->n_forced_flushes, 1);
+
+  /* and when it does arrive late it is not sent as a second epoch */
+  feed_sbp_seq_msg(210855000, 1, 2);
+  ck_assert_uint_eq(n_flush_frames, 3);
+  ck_assert_uint_eq(timer->n_late_msgs, 1);
+
+  /* the following epochs are not affected */
+  sbp2rtcm_tick(13000, &out_state);
+  feed_sbp_seq_msg(210856000, 0, 1);
+  ck_assert_uint_eq(n_flush_frames, 4);
+
+  /* with a fixed timeout */
+  sbp2rtcm_set_flush_timeout(100, &out_state);
+  feed_sbp_seq_msg(210857000, 0, 2);
+  sbp2rtcm_tick(13100, &out_state);
+  ck_assert_uint_eq(n_flush_frames, 5);
+  ck_assert_uint_eq(timer->n_forced_flushes, 2);
+}
+END_TEST
+
+static u8 timeout_n_epochs;
+static u32 timeout_epoch_tow;
+static u8 timeout_gps_obs;
+static u8 timeout_glo_obs;
+
+static void sbp_timeout_cb(
+    u16 msg_id, u8 length, u8 *buffer, u16 sender_id, void *context) {
+  (void)sender_id;
+  (void)context;
+  if (SBP_MSG_OBS != msg_id) {
+    return;
+  }
+  const msg_obs_t *msg = (const msg_obs_t *)buffer;
+  if (0 == (msg->header.n_obs & 0x0F)) {
+    timeout_n_epochs++;
+    timeout_epoch_tow = msg->header.t.tow;
+  }
+  u8 n_obs = (length - sizeof(observation_header_t)) / sizeof(*msg->obs);
+  for (u8 j = 0; j < n_obs; j++) {
+    if (CODE_GLO_L1OF == msg->obs[j].sid.code ||
+        CODE_GLO_L2OF == msg->obs[j].sid.code) {
+      timeout_glo_obs++;
+    } else {
+      timeout_gps_obs++;
+    }
+  }
+}
+
+/* encode the GPS and GLO test data as legacy 1004 and 1012 frames of the
+ * given sender and time, returns the length of the 1004 frame */
+static u16 encode_legacy_test_epoch(u16 sender_id, u32 tow_ms) {
+  sbp2rtcm_init(&out_state, rtcm_reference_cb, NULL);
+  sbp2rtcm_set_leap_second(18, &out_state);
+  for (u8 i = 0; i < ARRAY_SIZE(sbp_test_data); i++) {
+    if (CODE_GLO_L1OF == sbp_test_data[i].sid.code) {
+      sbp2rtcm_set_glo_fcn(sbp_test_data[i].sid, 8, &out_state);
+    }
+  }
+  out_state.sender_id = sender_id;
+  out_state.sbp_header.t.wn = 2022;
+  out_state.sbp_header.t.tow = tow_ms;
+  memcpy(out_state.sbp_obs_buffer, sbp_test_data, sizeof(sbp_test_data));
+  out_state.n_sbp_obs = ARRAY_SIZE(sbp_test_data);
+
+  ref_length = 0;
+  sbp_buffer_to_legacy_rtcm3(&out_state);
+  u16 gps_length = ((ref_frames[1] & 0x3) << 8 | ref_frames[2]) + 6;
+  ck_assert_uint_lt(gps_length, ref_length);
+  return gps_length;
+}
+
+START_TEST(test_rtcm_flush_timeout) {
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_init(&state, sbp_timeout_cb, NULL, NULL);
+  rtcm2sbp_set_gps_time(&t, &state);
+  rtcm2sbp_set_leap_second(18, &state);
+  const struct rtcm3_epoch_timer *timer = &state.epoch_timer;
+  timeout_n_epochs = 0;
+  timeout_gps_obs = 0;
+  timeout_glo_obs = 0;
+
+  /* the 1012 frame of the epoch is held up, the GPS part goes out on the
+   * default timeout and not before */
+  rtcm2sbp_tick(10000, &state);
+  u16 gps_length = encode_legacy_test_epoch(0x1001, 210853000);
+  rtcm2sbp_decode_frame(ref_frames, gps_length, &state);
+  rtcm2sbp_tick(10000 + RTCM3_EPOCH_TIMEOUT_DEFAULT_MS - 1, &state);
+  ck_assert_uint_eq(timeout_n_epochs, 0);
+  ck_assert_uint_eq(timer->n_forced_flushes, 0);
+  rtcm2sbp_tick(10000 + RTCM3_EPOCH_TIMEOUT_DEFAULT_MS, &state);
+  ck_assert_uint_eq(timeout_n_epochs, 1);
+  ck_assert_uint_eq(timeout_epoch_tow, 210853000);
+  ck_assert_uint_gt(timeout_gps_obs, 0);
+  ck_assert_uint_eq(timeout_glo_obs, 0);
+  ck_assert_uint_eq(timer->n_forced_flushes, 1);
+
+  /* when it does arrive it is not sent as a second epoch */
+  rtcm2sbp_decode_frame(
+      &ref_frames[gps_length], ref_length - gps_length, &state);
+  ck_assert_uint_eq(timeout_n_epochs, 1);
+  ck_assert_uint_eq(timer->n_late_msgs, 1);
+
+  /* with nothing pending the ticks send nothing */
+  rtcm2sbp_tick(20000, &state);
+  ck_assert_uint_eq(timeout_n_epochs, 1);
+  ck_assert_uint_eq(timer->n_forced_flushes, 1);
+}
+END_TEST
+
+#define STATION_TEST_SENDERS 2
+
+static u16 station_senders[STATION_TEST_SENDERS];
+static u8 station_epochs[STATION_TEST_SENDERS];
+static u8 station_gps_obs[STATION_TEST_SENDERS];
+static u8 station_glo_obs[STATION_TEST_SENDERS];
+
+static void sbp_station_cb(
+    u16 msg_id, u8 length, u8 *buffer, u16 sender_id, void *context) {
+  (void)context;
+  if (SBP_MSG_OBS != msg_id) {
+    return;
+  }
+  u8 i = 0;
+  while (i < STATION_TEST_SENDERS && 0 != station_senders[i] &&
+         station_senders[i] != sender_id) {
+    i++;
+  }
+  ck_assert_uint_lt(i, STATION_TEST_SENDERS);
+  station_senders[i] = sender_id;
+
+  const msg_obs_t *msg = (const msg_obs_t *)buffer;
+  if (0 == (msg->header.n_obs & 0x0F)) {
+    station_epochs[i]++;
+  }
+  u8 n_obs = (length - sizeof(observation_header_t)) / sizeof(*msg->obs);
+  for (u8 j = 0; j < n_obs; j++) {
+    if (CODE_GLO_L1OF == msg->obs[j].sid.code ||
+        CODE_GLO_L2OF == msg->obs[j].sid.code) {
+      station_glo_obs[i]++;
+    } else {
+      station_gps_obs[i]++;
+    }
+  }
+}
+
+START_TEST(test_rtcm_interleaved_stations) {
+  u8 frames_a[RTCM3_FANOUT_BUFFER_SIZE];
+  u8 frames_b[RTCM3_FANOUT_BUFFER_SIZE];
+  u16 gps_length_a = encode_legacy_test_epoch(0x1001, 210853000);
+  u16 length_a = ref_length;
+  memcpy(frames_a, ref_frames, ref_length);
+  u16 gps_length_b = encode_legacy_test_epoch(0x1002, 210853000);
+  u16 length_b = ref_length;
+  memcpy(frames_b, ref_frames, ref_length);
+
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_init(&state, sbp_station_cb, NULL, NULL);
+  rtcm2sbp_set_gps_time(&t, &state);
+  rtcm2sbp_set_leap_second(18, &state);
+  memset(station_senders, 0, sizeof(station_senders));
+  memset(station_epochs, 0, sizeof(station_epochs));
+  memset(station_gps_obs, 0, sizeof(station_gps_obs));
+  memset(station_glo_obs, 0, sizeof(station_glo_obs));
+
+  /* the GPS messages of both stations come before the GLO messages */
+  rtcm2sbp_decode_frame(frames_a, gps_length_a, &state);
+  rtcm2sbp_decode_frame(frames_b, gps_length_b, &state);
+  rtcm2sbp_decode_frame(
+      &frames_a[gps_length_a], length_a - gps_length_a, &state);
+  rtcm2sbp_decode_frame(
+      &frames_b[gps_length_b], length_b - gps_length_b, &state);
+
+  /* each station sends one complete epoch */
+  for (u8 i = 0; i < STATION_TEST_SENDERS; i++) {
+    ck_assert_uint_ne(station_senders[i], 0);
+    ck_assert_uint_eq(station_epochs[i], 1);
+    ck_assert_uint_gt(station_gps_obs[i], 0);
+    ck_assert_uint_gt(station_glo_obs[i], 0);
+  }
+  ck_assert_uint_eq(station_gps_obs[0], station_gps_obs[1]);
+  ck_assert_uint_eq(station_glo_obs[0], station_glo_obs[1]);
+
+  /* at 1 Hz and 5 Hz each station keeps its own epoch period */
+  for (u8 i = 1; i <= 2; i++) {
+    u16 gps_length = encode_legacy_test_epoch(0x1001, 210853000 + i * 1000);
+    rtcm2sbp_decode_frame(ref_frames, gps_length, &state);
+    rtcm2sbp_decode_frame(
+        &ref_frames[gps_length], ref_length - gps_length, &state);
+    gps_length = encode_legacy_test_epoch(0x1002, 210853000 + i * 200);
+    rtcm2sbp_decode_frame(ref_frames, gps_length, &state);
+    rtcm2sbp_decode_frame(
+        &ref_frames[gps_length], ref_length - gps_length, &state);
+  }
+  ck_assert_uint_eq(state.stations[0].epoch.epoch_period_ms, 1000);
+  ck_assert_uint_eq(state.stations[1].epoch.epoch_period_ms, 200);
+}
+END_TEST
+
+#define REORDER_TEST_EPOCHS 3
+
+static u8 reorder_n_epochs;
+static u32 reorder_epoch_tow[REORDER_TEST_EPOCHS];
+static u8 reorder_gps_obs[REORDER_TEST_EPOCHS];
+static u8 reorder_glo_obs[REORDER_TEST_EPOCHS];
+
+static void sbp_reorder_cb(
+    u16 msg_id, u8 length, u8 *buffer, u16 sender_id, void *context) {
+  (void)sender_id;
+  (void)context;
+  if (SBP_MSG_OBS != msg_id) {
+    return;
+  }
+  const msg_obs_t *msg = (const msg_obs_t *)buffer;
+  if (0 == (msg->header.n_obs & 0x0F)) {
+    ck_assert_uint_lt(reorder_n_epochs, REORDER_TEST_EPOCHS);
+    reorder_epoch_tow[reorder_n_epochs++] = msg->header.t.tow;
+  }
+  u8 epoch = reorder_n_epochs - 1;
+  u8 n_obs = (length - sizeof(observation_header_t)) / sizeof(*msg->obs);
+  for (u8 j = 0; j < n_obs; j++) {
+    if (CODE_GLO_L1OF == msg->obs[j].sid.code ||
+        CODE_GLO_L2OF == msg->obs[j].sid.code) {
+      reorder_glo_obs[epoch]++;
+    } else {
+      reorder_gps_obs[epoch]++;
+    }
+  }
+}
+
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+START_TEST(test_rtcm_reorder_window) {
+  static u8 frames[REORDER_TEST_EPOCHS][RTCM3_FANOUT_BUFFER_SIZE];
+  u16 gps_length[REORDER_TEST_EPOCHS];
+  u16 length[REORDER_TEST_EPOCHS];
+  for (u8 i = 0; i < REORDER_TEST_EPOCHS; i++) {
+    gps_length[i] = encode_legacy_test_epoch(0x1001, 210853000 + i * 1000);
+    length[i] = ref_length;
+    memcpy(frames[i], ref_frames, ref_length);
+  }
+
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_init(&state, sbp_reorder_cb, NULL, NULL);
+  rtcm2sbp_set_gps_time(&t, &state);
+  rtcm2sbp_set_leap_second(18, &state);
+  ck_assert(!rtcm2sbp_set_reorder_window(RTCM3_REORDER_MAX_EPOCHS, &state));
+  ck_assert(rtcm2sbp_set_reorder_window(2, &state));
+  reorder_n_epochs = 0;
+  memset(reorder_gps_obs, 0, sizeof(reorder_gps_obs));
+  memset(reorder_glo_obs, 0, sizeof(reorder_glo_obs));
+
+  /* the GLO message of each epoch arrives after the GPS one of the next */
+  rtcm2sbp_decode_frame(frames[0], gps_length[0], &state);
+  rtcm2sbp_decode_frame(frames[1], gps_length[1], &state);
+  rtcm2sbp_decode_frame(
+      &frames[0][gps_length[0]], length[0] - gps_length[0], &state);
+  ck_assert_uint_eq(state.n_reordered_msgs, 1);
+  ck_assert_uint_eq(reorder_n_epochs, 0);
+  rtcm2sbp_decode_frame(frames[2], gps_length[2], &state);
+  /* three epochs pending, the oldest one leaves the window */
+  ck_assert_uint_eq(reorder_n_epochs, 1);
+  rtcm2sbp_decode_frame(
+      &frames[1][gps_length[1]], length[1] - gps_length[1], &state);
+  rtcm2sbp_decode_frame(
+      &frames[2][gps_length[2]], length[2] - gps_length[2], &state);
+
+  /* a late message of an epoch already sent is dropped */
+  rtcm2sbp_decode_frame(
+      &frames[0][gps_length[0]], length[0] - gps_length[0], &state);
+  ck_assert_uint_eq(state.epoch_timer.n_late_msgs, 1);
+
+  /* disabling the window sends the rest */
+  ck_assert(rtcm2sbp_set_reorder_window(0, &state));
+  ck_assert_uint_eq(reorder_n_epochs, REORDER_TEST_EPOCHS);
+
+  for (u8 i = 0; i < REORDER_TEST_EPOCHS; i++) {
+    ck_assert_uint_eq(reorder_epoch_tow[i], 210853000 + i * 1000);
+    ck_assert_uint_gt(reorder_gps_obs[i], 0);
+    ck_assert_uint_gt(reorder_glo_obs[i], 0);
+    ck_assert_uint_eq(reorder_gps_obs[i], reorder_gps_obs[0]);
+    ck_assert_uint_eq(reorder_glo_obs[i], reorder_glo_obs[0]);
+  }
+}
+END_TEST
+#endif
+
+#define DECIMATION_TEST_EPOCHS 11
+
+START_TEST(test_rtcm_decimation) {
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_init(&state, sbp_reorder_cb, NULL, NULL);
+  rtcm2sbp_set_gps_time(&t, &state);
+  rtcm2sbp_set_leap_second(18, &state);
+  rtcm2sbp_set_decimation(1000, &state);
+  reorder_n_epochs = 0;
+  memset(reorder_gps_obs, 0, sizeof(reorder_gps_obs));
+  memset(reorder_glo_obs, 0, sizeof(reorder_glo_obs));
+
+  /* 5 Hz input, only the whole seconds are converted */
+  for (u8 i = 0; i < DECIMATION_TEST_EPOCHS; i++) {
+    u16 gps_length = encode_legacy_test_epoch(0x1001, 210853000 + i * 200);
+    rtcm2sbp_decode_frame(ref_frames, gps_length, &state);
+    rtcm2sbp_decode_frame(
+        &ref_frames[gps_length], ref_length - gps_length, &state);
+  }
+
+  ck_assert_uint_eq(reorder_n_epochs, 3);
+  ck_assert_uint_eq(state.n_decimated_frames, 2 * 8);
+  for (u8 i = 0; i < reorder_n_epochs; i++) {
+    ck_assert_uint_eq(reorder_epoch_tow[i], 210853000 + i * 1000);
+    ck_assert_uint_gt(reorder_gps_obs[i], 0);
+    ck_assert_uint_gt(reorder_glo_obs[i], 0);
+  }
+  ck_assert_uint_eq(reorder_epoch_tow[2], 210855000);
+}
+END_TEST
+
+#define PULL_TEST_EPOCHS 40
+
+static u16 push_legacy_test_epoch(u16 sender_id, u32 tow_ms) {
+  u16 gps_length = encode_legacy_test_epoch(sender_id, tow_ms);
+  rtcm2sbp_push(ref_frames, gps_length, &state);
+  return rtcm2sbp_push(
+      &ref_frames[gps_length], ref_length - gps_length, &state);
+}
+
+START_TEST(test_rtcm_pull) {
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_init(&state, NULL, NULL, NULL);
+  rtcm2sbp_set_gps_time(&t, &state);
+  rtcm2sbp_set_leap_second(18, &state);
+
+  struct rtcm2sbp_msg msg;
+  ck_assert(!rtcm2sbp_next(&msg, &state));
+
+  /* the 1012 frame completes the epoch and queues it */
+  u16 n_queued = push_legacy_test_epoch(0x1001, 210853000);
+  ck_assert_uint_gt(n_queued, 0);
+
+  u16 n_obs = 0;
+  for (u16 i = 0; i < n_queued; i++) {
+    ck_assert(rtcm2sbp_next(&msg, &state));
+    ck_assert_uint_eq(msg.msg_id, SBP_MSG_OBS);
+    ck_assert_uint_eq(msg.sender_id, 0x1001);
+    const msg_obs_t *obs = (const msg_obs_t *)msg.payload;
+    ck_assert_uint_eq(obs->header.t.tow, 210853000);
+    ck_assert_uint_eq(obs->header.n_obs >> 4, n_queued);
+    ck_assert_uint_eq(obs->header.n_obs & 0x0F, i);
+    n_obs += (msg.length - sizeof(observation_header_t)) / sizeof(*obs->obs);
+  }
+  ck_assert(!rtcm2sbp_next(&msg, &state));
+  ck_assert_uint_eq(n_obs, ARRAY_SIZE(sbp_test_data));
+
+  /* the GPS observations alone wait for the rest of the epoch */
+  u16 gps_length = encode_legacy_test_epoch(0x1001, 210854000);
+  ck_assert_uint_eq(rtcm2sbp_push(ref_frames, gps_length, &state), 0);
+
+  /* without reading the queue fills up, the oldest epochs are kept */
+  for (u8 i = 0; i < PULL_TEST_EPOCHS; i++) {
+    push_legacy_test_epoch(0x1001, 210855000 + i * 1000);
+  }
+  ck_assert_uint_gt(state.queue.n_dropped, 0);
+  ck_assert(rtcm2sbp_next(&msg, &state));
+  ck_assert_uint_eq(((const msg_obs_t *)msg.payload)->header.t.tow, 210854000);
+  while (rtcm2sbp_next(&msg, &state)) {
+  }
+
+  /* keeping an entry queued, the entries wrap around the end of the queue */
+  u32 n_dropped = state.queue.n_dropped;
+  u32 tow = 0;
+  n_obs = 0;
+  for (u8 i = 0; i <= PULL_TEST_EPOCHS; i++) {
+    push_legacy_test_epoch(0x1001, 210900000 + i * 1000);
+    while (state.queue.count > (i < PULL_TEST_EPOCHS ? 1 : 0) &&
+           rtcm2sbp_next(&msg, &state)) {
+      const msg_obs_t *obs = (const msg_obs_t *)msg.payload;
+      ck_assert_uint_ge(obs->header.t.tow, tow);
+      tow = obs->header.t.tow;
+      n_obs += (msg.length - sizeof(observation_header_t)) / sizeof(*obs->obs);
+    }
+  }
+  ck_assert_uint_lt(state.queue.wrap, RTCM3_SBP_QUEUE_SIZE);
+  ck_assert_uint_eq(state.queue.n_dropped, n_dropped);
+  ck_assert_uint_eq(tow, 210900000 + PULL_TEST_EPOCHS * 1000);
+  ck_assert_uint_eq(n_obs, (PULL_TEST_EPOCHS + 1) * ARRAY_SIZE(sbp_test_data));
+}
+END_TEST
+
+#define STATS_TEST_EPOCHS 5
+#define STATS_TEST_STEP_NS 1500
+
+static u64 stats_test_now_ns;
+
+static u64 stats_test_clock(void *context) {
+  (void)context;
+  stats_test_now_ns += STATS_TEST_STEP_NS;
+  return stats_test_now_ns;
+}
+
+START_TEST(test_rtcm_stats) {
+  struct gnssc_stats stats;
+  struct gnssc_stats snapshot;
+  gnssc_stats_init(&stats, stats_test_clock, NULL);
+  rtcm2sbp_init(&state, sbp_reorder_cb, NULL, NULL);
+  rtcm2sbp_set_stats(&stats, &state);
+  reorder_n_epochs = 0;
+
+  /* without a time nothing is decoded */
+  u16 gps_length = encode_legacy_test_epoch(0x1001, 210853000);
+  rtcm2sbp_decode_frame(ref_frames, gps_length, &state);
+  ck_assert(gnssc_stats_snapshot(&stats, &snapshot));
+  ck_assert_uint_eq(snapshot.drops[GNSSC_STATS_DROP_NO_TIME], 1);
+  ck_assert_uint_eq(snapshot.n_msg_types, 0);
+
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_set_gps_time(&t, &state);
+  rtcm2sbp_set_leap_second(18, &state);
+  rtcm2sbp_set_decimation(1000, &state);
+  for (u8 i = 0; i < STATS_TEST_EPOCHS; i++) {
+    gps_length = encode_legacy_test_epoch(0x1001, 210853000 + i * 500);
+    rtcm2sbp_decode_frame(ref_frames, gps_length, &state);
+    rtcm2sbp_decode_frame(
+        &ref_frames[gps_length], ref_length - gps_length, &state);
+  }
+
+  ck_assert(gnssc_stats_snapshot(&stats, &snapshot));
+  ck_assert_uint_eq(snapshot.seq % 2, 0);
+  ck_assert_uint_eq(snapshot.drops[GNSSC_STATS_DROP_DECIMATED], 2 * 2);
+  ck_assert_uint_eq(snapshot.n_msg_types, 2);
+  ck_assert_ptr_eq(gnssc_stats_msg(&snapshot, 1001), NULL);
+  const u16 msg_nums[] = {1004, 1012};
+  for (u8 i = 0; i < ARRAY_SIZE(msg_nums); i++) {
+    const gnssc_msg_stats_t *msg = gnssc_stats_msg(&snapshot, msg_nums[i]);
+    ck_assert_ptr_ne(msg, NULL);
+    ck_assert_uint_eq(msg->count, 3);
+    ck_assert_uint_eq(msg->decode_errors, 0);
+    /* 1500 ns falls in [2^10, 2^11) */
+    ck_assert_uint_eq(msg->time_hist[10], 3);
+  }
+  ck_assert_uint_eq(reorder_n_epochs, 3);
+  ck_assert_uint_eq(snapshot.obs_in, 3 * ARRAY_SIZE(sbp_test_data));
+  ck_assert_uint_eq(snapshot.obs_out, 3 * ARRAY_SIZE(sbp_test_data));
+
+  gnssc_stats_clear(&stats);
+  ck_assert(gnssc_stats_snapshot(&stats, &snapshot));
+  ck_assert_uint_eq(snapshot.obs_in, 0);
+  ck_assert_uint_eq(snapshot.drops[GNSSC_STATS_DROP_DECIMATED], 0);
+  ck_assert_ptr_eq(gnssc_stats_msg(&snapshot, 1004), NULL);
+  ck_assert_str_eq(gnssc_stats_drop_name(GNSSC_STATS_DROP_LATE), "LATE");
+}
+END_TEST
+
+#define TRACE_TEST_RING_SIZE 4
+
+START_TEST(test_rtcm_trace) {
+  static gnssc_trace_record_t records[TRACE_TEST_RING_SIZE];
+  struct gnssc_trace trace;
+  stats_test_now_ns = 0;
+  gnssc_trace_init(
+      &trace, records, TRACE_TEST_RING_SIZE, stats_test_clock, NULL);
+
+  /* a full ring overwrites the oldest records, the exit of the overwritten
+   * entry is dropped */
+  for (u8 i = 0; i <= TRACE_TEST_RING_SIZE; i++) {
+    gnssc_trace_record(&trace,
+                       GNSSC_TRACE_DECODE,
+                       i % 2 ? GNSSC_TRACE_EXIT : GNSSC_TRACE_ENTRY,
+                       1077);
+  }
+  ck_assert_uint_eq(trace.n_overwritten, 1);
+
+  FILE *file = tmpfile();
+  ck_assert_ptr_ne(file, NULL);
+  gnssc_trace_json_begin(file);
+  ck_assert_uint_eq(gnssc_trace_write_json(&trace, file),
+                    TRACE_TEST_RING_SIZE - 1);
+  ck_assert_uint_eq(gnssc_trace_write_json(&trace, file), 0);
+  gnssc_trace_json_end(file);
+
+  char line[128];
+  rewind(file);
+  ck_assert_ptr_ne(fgets(line, sizeof(line), file), NULL);
+  ck_assert_str_eq(line, "[\n");
+  ck_assert_ptr_ne(fgets(line, sizeof(line), file), NULL);
+  ck_assert_str_eq(line,
+                   "{\"name\":\"decode\",\"ph\":\"B\",\"ts\":4.500,"
+                   "\"pid\":0,\"tid\":0,\"args\":{\"msg\":1077}},\n");
+  fclose(file);
+
+  /* the hooks record the stages in nested pairs */
+  gnssc_trace_record_t ring[64];
+  gnssc_trace_init(&trace, ring, ARRAY_SIZE(ring), stats_test_clock, NULL);
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_init(&state, sbp_reorder_cb, NULL, NULL);
+  rtcm2sbp_set_gps_time(&t, &state);
+  rtcm2sbp_set_leap_second(18, &state);
+  rtcm2sbp_set_trace(&trace, &state);
+  reorder_n_epochs = 0;
+  for (u8 i = 0; i < 2; i++) {
+    u16 gps_length = encode_legacy_test_epoch(0x1001, 210853000 + i * 1000);
+    rtcm2sbp_decode_frame(ref_frames, gps_length, &state);
+  }
+#ifdef GNSSC_TRACE
+  u8 depth = 0;
+  gnssc_trace_record_t record;
+  while (gnssc_trace_next(&trace, &record)) {
+    depth += GNSSC_TRACE_ENTRY == record.phase ? 1 : -1;
+    ck_assert_uint_le(depth, 3);
+  }
+  ck_assert_uint_eq(depth, 0);
+  ck_assert_uint_gt(trace.head, 0);
+#else
+  ck_assert_uint_eq(trace.head, 0);
+#endif
+}
+END_TEST
+
+#define POOL_TEST_STATES 2
+
+static struct rtcm3_sbp_state pool_states[POOL_TEST_STATES];
+static struct rtcm2sbp_pool rtcm_pool;
+static struct rtcm3_out_state pool_out_states[POOL_TEST_STATES];
+static struct sbp2rtcm_pool out_pool;
+
+START_TEST(test_rtcm_pool) {
+  ck_assert(rtcm2sbp_pool_init(
+      &rtcm_pool, pool_states, POOL_TEST_STATES, sbp_reorder_cb, NULL));
+  gps_time_t t = {.wn = 2022, .tow = 210853};
+  rtcm2sbp_set_gps_time(&t, &rtcm_pool.config);
+  rtcm2sbp_set_leap_second(18, &rtcm_pool.config);
+  reorder_n_epochs = 0;
+  memset(reorder_gps_obs, 0, sizeof(reorder_gps_obs));
+  memset(reorder_glo_obs, 0, sizeof(reorder_glo_obs));
+
+  int context;
+  struct rtcm3_sbp_state *first = rtcm2sbp_pool_acquire(&rtcm_pool, &context);
+  struct rtcm3_sbp_state *second = rtcm2sbp_pool_acquire(&rtcm_pool, NULL);
+  ck_assert_ptr_eq(first, &pool_states[0]);
+  ck_assert_ptr_eq(second, &pool_states[1]);
+  ck_assert_ptr_eq(rtcm2sbp_pool_acquire(&rtcm_pool, NULL), NULL);
+  ck_assert_ptr_eq(first->context, &context);
+  ck_assert(first->leap_second_known);
+
+  /* an epoch left pending by the previous connection is not sent */
+  u16 gps_length = encode_legacy_test_epoch(0x1001, 210853000);
+  rtcm2sbp_decode_frame(ref_frames, gps_length, first);
+  rtcm2sbp_pool_release(&rtcm_pool, first);
+  first = rtcm2sbp_pool_acquire(&rtcm_pool, NULL);
+  ck_assert_ptr_eq(first, &pool_states[0]);
+  ck_assert(!first->stations[0].in_use);
+
+  for (u8 i = 1; i <= 2; i++) {
+    gps_length = encode_legacy_test_epoch(0x1001, 210853000 + i * 1000);
+    rtcm2sbp_decode_frame(ref_frames, gps_length, first);
+    rtcm2sbp_decode_frame(
+        &ref_frames[gps_length], ref_length - gps_length, first);
+  }
+  ck_assert_uint_eq(reorder_n_epochs, 2);
+  ck_assert_uint_eq(reorder_epoch_tow[0], 210854000);
+  ck_assert_uint_eq(reorder_epoch_tow[1], 210855000);
+  for (u8 i = 0; i < reorder_n_epochs; i++) {
+    ck_assert_uint_gt(reorder_gps_obs[i], 0);
+    ck_assert_uint_gt(reorder_glo_obs[i], 0);
+  }
+
+  /* the output states keep their configuration but not the pending epoch */
+  ck_assert(sbp2rtcm_pool_init(
+      &out_pool, pool_out_states, POOL_TEST_STATES, rtcm_reference_cb));
+  sbp2rtcm_set_leap_second(18, &out_pool.config);
+  sbp2rtcm_set_rtcm_out_mode(MSM4, &out_pool.config);
+  struct rtcm3_out_state *out = sbp2rtcm_pool_acquire(&out_pool, NULL);
+  ck_assert(out->leap_second_known);
+  ck_assert_int_eq(out->msm_type, MSM4);
+  out->n_sbp_obs = 3;
+  sbp2rtcm_pool_release(&out_pool, out);
+  out = sbp2rtcm_pool_acquire(&out_pool, NULL);
+  ck_assert_uint_eq(out->n_sbp_obs, 0);
+  ck_assert_int_eq(out->msm_type, MSM4);
+}
+END_TEST
+
 Suite *rtcm3_suite(void) {
   Suite *s = suite_create("RTCMv3");
 
@@ -1229,6 +2176,16 @@ Suite *rtcm3_suite(void) {
   tcase_add_test(tc_core, test_glo_day_rollover);
   tcase_add_test(tc_core, test_1012_first);
   tcase_add_test(tc_core, test_glo_5hz);
+  tcase_add_test(tc_core, test_rtcm_flush_timeout);
+  tcase_add_test(tc_core, test_rtcm_interleaved_stations);
+#if RTCM3_REORDER_MAX_EPOCHS > 0
+  tcase_add_test(tc_core, test_rtcm_reorder_window);
+#endif
+  tcase_add_test(tc_core, test_rtcm_decimation);
+  tcase_add_test(tc_core, test_rtcm_pull);
+  tcase_add_test(tc_core, test_rtcm_pool);
+  tcase_add_test(tc_core, test_rtcm_stats);
+  tcase_add_test(tc_core, test_rtcm_trace);
   suite_add_tcase(s, tc_core);
 
   TCase *tc_biases = tcase_create("Biases");
@@ -1283,6 +2240,11 @@ Suite *rtcm3_suite(void) {
   tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_rtcm_legacy);
   tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_rtcm_msm);
   tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_msm_roundtrip);
+  tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_msm_split);
+  tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_rtcm_fanout);
+  tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_rtcm_station_schedule);
+  tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_legacy_unsorted);
+  tcase_add_test(tc_sbp_to_rtcm, test_sbp_to_rtcm_flush_timeout);
   suite_add_tcase(s, tc_sbp_to_rtcm);
 
   return s;
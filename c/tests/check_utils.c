@@ -86,6 +86,37 @@ START_TEST(test_glo_time_conversion) {
 }
 END_TEST
 
+START_TEST(test_time_cache) {
+  gps_time_t rover_time = {.tow = 3 * SEC_IN_DAY + 7200, .wn = 1945};
+  rtcm2sbp_set_gps_time(&rover_time, &state);
+  u32 glo_tod_ms = (7200 + UTC_SU_OFFSET * SEC_IN_HOUR) * S_TO_MS;
+
+  gps_time_t first;
+  gps_time_t second;
+  compute_glo_time(glo_tod_ms, &first, &rover_time, &state);
+  compute_glo_time(glo_tod_ms, &second, &rover_time, &state);
+  ck_assert_uint_eq(second.wn, first.wn);
+  ck_assert_uint_eq((u32)rint(second.tow), (u32)rint(rover_time.tow + 18));
+
+  /* a new leap second is not served from the cache */
+  rtcm2sbp_set_leap_second(17, &state);
+  compute_glo_time(glo_tod_ms, &second, &rover_time, &state);
+  ck_assert_uint_eq((u32)rint(second.tow), (u32)rint(rover_time.tow + 17));
+
+  /* the week of a repeated GPS epoch time comes from the cache */
+  compute_gps_time(SEC_IN_WEEK * S_TO_MS - 500, &first, &rover_time, &state);
+  compute_gps_time(SEC_IN_WEEK * S_TO_MS - 500, &second, &rover_time, &state);
+  ck_assert_uint_eq(first.wn, rover_time.wn - 1);
+  ck_assert_uint_eq(second.wn, first.wn);
+  ck_assert(fabs(second.tow - first.tow) < 1e-9);
+
+  /* a new reference time is not served from the cache */
+  rover_time.wn++;
+  compute_gps_time(SEC_IN_WEEK * S_TO_MS - 500, &second, &rover_time, &state);
+  ck_assert_uint_eq(second.wn, first.wn + 1);
+}
+END_TEST
+
 START_TEST(test_msm_sid_conversion) {
   rtcm_msm_header header;
   /* GPS message */
@@ -279,55 +310,149 @@ START_TEST(test_msm_add_to_header) {
   rtcm_msm_header header;
   memset(&header, 0, sizeof(header));
   header.msg_num = 1074;
-  msm_add_to_header(&header, CODE_GPS_L1CA, 1);
-  msm_add_to_header(&header, CODE_GPS_L1CA, 2);
-  msm_add_to_header(&header, CODE_GPS_L1CA, 3);
-  msm_add_to_header(&header, CODE_GPS_L2CM, 1);
+  msm_add_to_header(&header, CODE_GPS_L1CA, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L1CA, 2, NULL);
+  msm_add_to_header(&header, CODE_GPS_L1CA, 3, NULL);
+  msm_add_to_header(&header, CODE_GPS_L2CM, 1, NULL);
 
   ck_assert_uint_eq(msm_get_num_satellites(&header), 3);
   ck_assert_uint_eq(msm_get_num_signals(&header), 2);
 
   /* invalid code, should get rejected */
-  ck_assert(!msm_add_to_header(&header, CODE_INVALID, 1));
+  ck_assert(!msm_add_to_header(&header, CODE_INVALID, 1, NULL));
   /* invalid PRN, should get rejected */
-  ck_assert(!msm_add_to_header(&header, CODE_GPS_L1CA, 50));
-
-  msm_add_to_header(&header, CODE_GPS_L1P, 1);
-  msm_add_to_header(&header, CODE_GPS_L2P, 1);
-  msm_add_to_header(&header, CODE_GPS_L2CL, 1);
-  msm_add_to_header(&header, CODE_GPS_L2CX, 1);
-  msm_add_to_header(&header, CODE_GPS_L5I, 1);
-  msm_add_to_header(&header, CODE_GPS_L5Q, 1);
-  msm_add_to_header(&header, CODE_GPS_L5X, 1);
-  msm_add_to_header(&header, CODE_GPS_L1CI, 1);
-  msm_add_to_header(&header, CODE_GPS_L1CQ, 1);
+  ck_assert(!msm_add_to_header(&header, CODE_GPS_L1CA, 50, NULL));
+
+  msm_add_to_header(&header, CODE_GPS_L1P, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L2P, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L2CL, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L2CX, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L5I, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L5Q, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L5X, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L1CI, 1, NULL);
+  msm_add_to_header(&header, CODE_GPS_L1CQ, 1, NULL);
   ck_assert_uint_eq(msm_get_num_signals(&header), 11);
 
-  ck_assert(msm_add_to_header(&header, CODE_GPS_L1CA, 4));
+  ck_assert(msm_add_to_header(&header, CODE_GPS_L1CA, 4, NULL));
   ck_assert_uint_eq(msm_get_num_satellites(&header), 4);
-  ck_assert(msm_add_to_header(&header, CODE_GPS_L1CA, 5));
+  ck_assert(msm_add_to_header(&header, CODE_GPS_L1CA, 5, NULL));
   ck_assert_uint_eq(msm_get_num_satellites(&header), 5);
 
   /* adding sixth satellite fails because cell mask holds only 64 items */
-  ck_assert(!msm_add_to_header(&header, CODE_GPS_L1CA, 6));
+  ck_assert(!msm_add_to_header(&header, CODE_GPS_L1CA, 6, NULL));
 
   /* can still add signals to existing satellites */
-  ck_assert(msm_add_to_header(&header, CODE_GPS_L1P, 5));
+  ck_assert(msm_add_to_header(&header, CODE_GPS_L1P, 5, NULL));
 
-  msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 1);
-  msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 2);
-  msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 3);
-  msm_add_to_cell_mask(&header, CODE_GPS_L2CM, 1);
+  msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 1, NULL);
+  msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 2, NULL);
+  msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 3, NULL);
+  msm_add_to_cell_mask(&header, CODE_GPS_L2CM, 1, NULL);
   ck_assert_uint_eq(msm_get_num_cells(&header), 4);
 
   /* satellite not in cell mask, should get rejected */
-  ck_assert(!msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 6));
+  ck_assert(!msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 6, NULL));
   /* signal not in cell mask, should get rejected */
-  ck_assert(!msm_add_to_cell_mask(&header, CODE_GPS_L1CX, 1));
+  ck_assert(!msm_add_to_cell_mask(&header, CODE_GPS_L1CX, 1, NULL));
   /* invalid code, should get rejected */
-  ck_assert(!msm_add_to_cell_mask(&header, CODE_INVALID, 1));
+  ck_assert(!msm_add_to_cell_mask(&header, CODE_INVALID, 1, NULL));
   /* invalid PRN, should get rejected */
-  ck_assert(!msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 50));
+  ck_assert(!msm_add_to_cell_mask(&header, CODE_GPS_L1CA, 50, NULL));
+}
+END_TEST
+
+static gnssc_diag_t last_diag;
+static u32 n_diag_delivered;
+
+static void diag_cb(const gnssc_diag_t *diag, void *context) {
+  (void)context;
+  last_diag = *diag;
+  n_diag_delivered++;
+}
+
+START_TEST(test_diagnostics) {
+  struct gnssc_diag diag;
+  gnssc_diag_init(&diag);
+  n_diag_delivered = 0;
+
+  /* without a sink the events are only counted */
+  gnssc_diag_report(&diag, GNSSC_DIAG_OBS_SEQ_MISSED, 1, 2, 3, 4, 3);
+  ck_assert_uint_eq(gnssc_diag_count(&diag, GNSSC_DIAG_OBS_SEQ_MISSED), 1);
+  ck_assert_uint_eq(n_diag_delivered, 0);
+
+  /* NULL diagnostics are ignored */
+  gnssc_diag_report(NULL, GNSSC_DIAG_OBS_SEQ_MISSED, 1, 2, 3, 4, 3);
+
+  gnssc_diag_set_sink(&diag, diag_cb, NULL);
+  gnssc_diag_set_rate_limit(&diag, GNSSC_DIAG_OBS_SEQ_MISSED, 1000, 2);
+  gnssc_diag_set_time(&diag, 5000);
+  for (u8 i = 0; i < 5; i++) {
+    gnssc_diag_report(&diag, GNSSC_DIAG_OBS_SEQ_MISSED, 1, 2, 3, 4, 3);
+  }
+  /* only the burst gets delivered, the rest is counted */
+  ck_assert_uint_eq(n_diag_delivered, 2);
+  ck_assert_uint_eq(gnssc_diag_count(&diag, GNSSC_DIAG_OBS_SEQ_MISSED), 6);
+
+  /* other events have their own limits */
+  gnssc_diag_report(&diag, GNSSC_DIAG_INVALID_GLO_PRN, 0, 40, 0, 0, 0);
+  ck_assert_uint_eq(n_diag_delivered, 3);
+  ck_assert_uint_eq(last_diag.event, GNSSC_DIAG_INVALID_GLO_PRN);
+
+  gnssc_diag_set_time(&diag, 5999);
+  gnssc_diag_report(&diag, GNSSC_DIAG_OBS_SEQ_MISSED, 1, 2, 3, 4, 3);
+  ck_assert_uint_eq(n_diag_delivered, 3);
+
+  /* new window, the suppressed count is reported with the next delivery */
+  gnssc_diag_set_time(&diag, 6000);
+  gnssc_diag_report(&diag, GNSSC_DIAG_OBS_SEQ_MISSED, 1, 2, 3, 4, 3);
+  ck_assert_uint_eq(n_diag_delivered, 4);
+  ck_assert_uint_eq(last_diag.suppressed, 4);
+  ck_assert_uint_eq(last_diag.stn_id, 1);
+  ck_assert_int_eq(last_diag.args[2], 4);
+
+  char buf[128];
+  gnssc_diag_to_str(&last_diag, buf, sizeof(buf));
+  ck_assert_str_eq(buf,
+                   "Missed an SBP obs packet, expected seq 2/3 "
+                   "but got 4/3");
+
+  /* rejected MSM header additions are reported to the given sink */
+  rtcm_msm_header header;
+  memset(&header, 0, sizeof(header));
+  header.msg_num = 1074;
+  header.stn_id = 7;
+  ck_assert(!msm_add_to_header(&header, CODE_GPS_L1CA, 50, &diag));
+  ck_assert_uint_eq(last_diag.event, GNSSC_DIAG_MSM_INVALID_PRN);
+  ck_assert_uint_eq(last_diag.stn_id, 7);
+  ck_assert_int_eq(last_diag.args[1], 50);
+}
+END_TEST
+
+START_TEST(test_diagnostics_no_time) {
+  struct gnssc_diag diag;
+  gnssc_diag_init(&diag);
+  gnssc_diag_set_sink(&diag, diag_cb, NULL);
+  n_diag_delivered = 0;
+
+  /* the default limits need a time, until then nothing is suppressed */
+  for (u8 i = 0; i < 5; i++) {
+    gnssc_diag_report(&diag, GNSSC_DIAG_OBS_BUFFER_FULL, 0, 100, 1, 0, 0);
+  }
+  ck_assert_uint_eq(n_diag_delivered, 5);
+  ck_assert_uint_eq(last_diag.suppressed, 0);
+
+  gnssc_diag_set_time(&diag, 0);
+  for (u8 i = 0; i < 5; i++) {
+    gnssc_diag_report(&diag, GNSSC_DIAG_OBS_BUFFER_FULL, 0, 100, 1, 0, 0);
+  }
+  ck_assert_uint_eq(n_diag_delivered, 5 + GNSSC_DIAG_DEFAULT_BURST);
+
+  /* resetting the counters forgets the time as well */
+  gnssc_diag_reset_counters(&diag);
+  gnssc_diag_report(&diag, GNSSC_DIAG_OBS_BUFFER_FULL, 0, 100, 1, 0, 0);
+  gnssc_diag_report(&diag, GNSSC_DIAG_OBS_BUFFER_FULL, 0, 100, 1, 0, 0);
+  ck_assert_uint_eq(n_diag_delivered, 5 + GNSSC_DIAG_DEFAULT_BURST + 2);
 }
 END_TEST
 
@@ -337,11 +462,14 @@ Suite *utils_suite(void) {
   TCase *tc_utils = tcase_create("Utilities");
   tcase_add_checked_fixture(tc_utils, utils_setup, NULL);
   tcase_add_test(tc_utils, test_compute_glo_time);
+  tcase_add_test(tc_utils, test_time_cache);
   tcase_add_test(tc_utils, test_glo_time_conversion);
   tcase_add_test(tc_utils, test_msm_sid_conversion);
   tcase_add_test(tc_utils, test_msm_code_prn_conversion);
   tcase_add_test(tc_utils, test_msm_glo_fcn);
   tcase_add_test(tc_utils, test_msm_add_to_header);
+  tcase_add_test(tc_utils, test_diagnostics);
+  tcase_add_test(tc_utils, test_diagnostics_no_time);
 
   suite_add_tcase(s, tc_utils);
 